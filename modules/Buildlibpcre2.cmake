@@ -4,7 +4,7 @@ CMAKE_MINIMUM_REQUIRED(VERSION 3.0.2)
 ExternalProject_Add(project_libpcre2
     URL http://sourceforge.net/projects/pcre/files/pcre2/10.20/pcre2-10.20.tar.gz
     PREFIX ${CMAKE_CURRENT_BINARY_DIR}/libpcre2
-    CONFIGURE_COMMAND cd <SOURCE_DIR> && ./configure --prefix=<INSTALL_DIR>
+    CONFIGURE_COMMAND cd <SOURCE_DIR> && ./configure --prefix=<INSTALL_DIR> --enable-jit
     BUILD_COMMAND cd <SOURCE_DIR> && make -j4
     INSTALL_COMMAND cd <SOURCE_DIR> && make install
 )
@@ -3,9 +3,9 @@ CMAKE_MINIMUM_REQUIRED(VERSION 3.0.2)
 
 ExternalProject_Add(project_librdkafka
     GIT_REPOSITORY https://github.com/edenhill/librdkafka.git
-    GIT_TAG 0.8.6
+    GIT_TAG v0.11.6
     PREFIX ${CMAKE_CURRENT_BINARY_DIR}/librdkafka
-    CONFIGURE_COMMAND cd <SOURCE_DIR> && ./configure --prefix=<INSTALL_DIR>
+    CONFIGURE_COMMAND cd <SOURCE_DIR> && ./configure --prefix=<INSTALL_DIR> --disable-ssl --disable-sasl
     BUILD_COMMAND cd <SOURCE_DIR> && make
     INSTALL_COMMAND cd <SOURCE_DIR> && make install
 )
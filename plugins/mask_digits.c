@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+/* Sample filter plugin, masks the digits of lines (e.g. card numbers and
+ * phone numbers) and drops the empty lines.
+ *
+ * args is the mask character, "*" by default. The lines without digits
+ * are passed on as they are, nothing is copied for them.
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logkafka/filter_plugin_abi.h"
+
+struct mask_digits {
+    char mask;
+    /* the rewritten lines of the last batch */
+    char *buf;
+    size_t buf_size;
+};
+
+static void *mask_digits_create(const char *args)
+{
+    struct mask_digits *md = (struct mask_digits *)calloc(1, sizeof(*md));
+    if (NULL == md) return NULL;
+
+    md->mask = (NULL != args && '\0' != args[0])? args[0]: '*';
+
+    return md;
+}
+
+static void mask_digits_destroy(void *instance)
+{
+    struct mask_digits *md = (struct mask_digits *)instance;
+
+    free(md->buf);
+    free(md);
+}
+
+static int has_digit(const char *data, size_t len)
+{
+    /* no early exit, the loop is vectorized by the compiler */
+    unsigned char found = 0;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        found |= (unsigned char)(data[i] - '0') < 10;
+    }
+
+    return found;
+}
+
+static int mask_digits_process(void *instance, const logkafka_line_t *lines,
+        size_t count, unsigned char *keep, logkafka_line_t *out)
+{
+    struct mask_digits *md = (struct mask_digits *)instance;
+    size_t total = 0, used = 0, i, k;
+
+    for (i = 0; i < count; ++i) {
+        total += lines[i].len;
+    }
+
+    if (total > md->buf_size) {
+        char *buf = (char *)realloc(md->buf, total);
+        if (NULL == buf) return -1;
+        md->buf = buf;
+        md->buf_size = total;
+    }
+
+    for (i = 0; i < count; ++i) {
+        const char *data = lines[i].data;
+        size_t len = lines[i].len;
+
+        if (0 == len) {
+            keep[i] = 0;
+            continue;
+        }
+
+        if (!has_digit(data, len)) continue;
+
+        char *dst = md->buf + used;
+        for (k = 0; k < len; ++k) {
+            dst[k] = (unsigned char)(data[k] - '0') < 10? md->mask: data[k];
+        }
+
+        out[i].data = dst;
+        out[i].len = len;
+        used += len;
+    }
+
+    return 0;
+}
+
+static const logkafka_filter_plugin_t mask_digits_plugin = {
+    LOGKAFKA_FILTER_PLUGIN_ABI_VERSION,
+    "mask_digits",
+    mask_digits_create,
+    mask_digits_destroy,
+    mask_digits_process
+};
+
+const logkafka_filter_plugin_t *logkafka_filter_plugin(void)
+{
+    return &mask_digits_plugin;
+}
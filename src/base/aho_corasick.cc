@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/aho_corasick.h"
+
+#include <cstring>
+#include <deque>
+
+namespace base {
+
+AhoCorasick::AhoCorasick()
+{/*{{{*/
+    memset(m_classes, 0, sizeof(m_classes));
+    m_class_num = 1;
+    m_state_num = 1;
+    m_next.assign(1, 0);
+    m_outputs.resize(1);
+    m_search_no = 0;
+}/*}}}*/
+
+bool AhoCorasick::init(const vector<string> &keywords)
+{/*{{{*/
+    /* class 0 is for the bytes not in any keyword */
+    memset(m_classes, 0, sizeof(m_classes));
+    m_class_num = 1;
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        for (size_t k = 0; k < keywords[i].length(); ++k) {
+            unsigned char c = keywords[i][k];
+            if (0 == m_classes[c]) m_classes[c] = m_class_num++;
+        }
+    }
+
+    /* trie, -1 for no transition yet */
+    m_state_num = 1;
+    m_next.assign(m_class_num, -1);
+    m_outputs.assign(1, vector<size_t>());
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        if (keywords[i].empty()) continue;
+
+        size_t state = 0;
+        for (size_t k = 0; k < keywords[i].length(); ++k) {
+            size_t cls = m_classes[(unsigned char)keywords[i][k]];
+            if (-1 == m_next[state * m_class_num + cls]) {
+                m_next[state * m_class_num + cls] = m_state_num++;
+                m_next.resize(m_state_num * m_class_num, -1);
+                m_outputs.resize(m_state_num);
+            }
+            state = m_next[state * m_class_num + cls];
+        }
+        m_outputs[state].push_back(i);
+    }
+
+    /* failure links in breadth-first order, the missing transitions are
+     * replaced with the ones of failure state, so no link is followed
+     * while searching */
+    vector<int32_t> fail(m_state_num, 0);
+    deque<size_t> queue;
+    for (size_t cls = 0; cls < m_class_num; ++cls) {
+        int32_t &next = m_next[cls];
+        if (-1 == next) {
+            next = 0;
+        } else {
+            fail[next] = 0;
+            queue.push_back(next);
+        }
+    }
+
+    while (!queue.empty()) {
+        size_t state = queue.front();
+        queue.pop_front();
+
+        const vector<size_t> &inherited = m_outputs[fail[state]];
+        m_outputs[state].insert(m_outputs[state].end(),
+                inherited.begin(), inherited.end());
+
+        for (size_t cls = 0; cls < m_class_num; ++cls) {
+            int32_t &next = m_next[state * m_class_num + cls];
+            int32_t fallback = m_next[fail[state] * m_class_num + cls];
+            if (-1 == next) {
+                next = fallback;
+            } else {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    m_found.assign(keywords.size(), 0);
+    m_search_no = 0;
+
+    return true;
+}/*}}}*/
+
+void AhoCorasick::search(const char *data, size_t len, vector<size_t> &ids)
+{/*{{{*/
+    if (isEmpty()) return;
+
+    ++m_search_no;
+
+    const unsigned char *p = (const unsigned char *)data;
+    const int32_t *next = &m_next[0];
+    size_t state = 0;
+    for (size_t i = 0; i < len; ++i) {
+        state = next[state * m_class_num + m_classes[p[i]]];
+        if (m_outputs[state].empty()) continue;
+
+        const vector<size_t> &outputs = m_outputs[state];
+        for (size_t k = 0; k < outputs.size(); ++k) {
+            if (m_found[outputs[k]] != m_search_no) {
+                m_found[outputs[k]] = m_search_no;
+                ids.push_back(outputs[k]);
+            }
+        }
+    }
+}/*}}}*/
+
+} // namespace base
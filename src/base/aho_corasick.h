@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_AHO_CORASICK_H_
+#define BASE_AHO_CORASICK_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+
+using namespace std;
+
+namespace base {
+
+/* Aho-Corasick automaton of a set of keywords, finds all keywords of one
+ * buffer in a single pass.
+ *
+ * The bytes are mapped to the classes of bytes appearing in keywords,
+ * the transitions are kept in one dense table of states x classes, so
+ * every byte costs one lookup. Not thread-safe.
+ * */
+class AhoCorasick : base::noncopyable
+{
+    public:
+        AhoCorasick();
+
+        /* The id of a keyword is its index, empty keywords never match */
+        bool init(const vector<string> &keywords);
+        bool isEmpty() const { return m_state_num <= 1; };
+
+        /* Append the ids of keywords found in data[0, len) to ids, each
+         * id once, in no particular order */
+        void search(const char *data, size_t len, vector<size_t> &ids);
+
+    private:
+        unsigned char m_classes[256];
+        size_t m_class_num;
+        size_t m_state_num;
+        vector<int32_t> m_next;
+        vector<vector<size_t> > m_outputs;
+
+        /* the keyword was found in the search of this number */
+        vector<size_t> m_found;
+        size_t m_search_no;
+};
+
+} // namespace base
+
+#endif // BASE_AHO_CORASICK_H_
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/arena.h"
+
+#include <algorithm>
+
+#include "base/scoped_lock.h"
+
+namespace base {
+
+ArenaPool::Arena::Arena(size_t size)
+{/*{{{*/
+    m_pool = NULL;
+    m_data = (char *)malloc(size);
+    m_size = NULL == m_data? 0: size;
+    m_used = 0;
+}/*}}}*/
+
+void ArenaPool::Arena::release()
+{/*{{{*/
+    /* the pool may go with its last arena */
+    ArenaPool *pool = m_pool;
+    m_pool = NULL;
+    pool->recycle(this);
+    pool->unref();
+}/*}}}*/
+
+ArenaPool::ArenaPool(size_t arena_bytes, size_t max_free)
+{/*{{{*/
+    m_arena_bytes = arena_bytes;
+    m_max_free = max_free;
+    m_allocated = 0;
+    m_reused = 0;
+}/*}}}*/
+
+ArenaPool::~ArenaPool()
+{/*{{{*/
+    for (size_t i = 0; i < m_free.size(); ++i) {
+        delete m_free[i];
+    }
+    m_free.clear();
+}/*}}}*/
+
+ArenaPool *ArenaPool::create(size_t arena_bytes, size_t max_free)
+{/*{{{*/
+    return new ArenaPool(arena_bytes, max_free);
+}/*}}}*/
+
+ArenaPool::Arena *ArenaPool::acquire(size_t size)
+{/*{{{*/
+    Arena *arena = NULL;
+
+    {
+        ScopedLock l(m_mutex);
+        for (size_t i = m_free.size(); i > 0; --i) {
+            if (m_free[i - 1]->size() >= size) {
+                arena = m_free[i - 1];
+                m_free.erase(m_free.begin() + i - 1);
+                break;
+            }
+        }
+    }
+
+    if (NULL != arena) {
+        __sync_add_and_fetch(&m_reused, 1);
+    } else {
+        arena = new Arena(max(size, m_arena_bytes));
+        if (0 == arena->size()) {
+            delete arena;
+            return NULL;
+        }
+        __sync_add_and_fetch(&m_allocated, 1);
+    }
+
+    ref();
+    arena->m_pool = this;
+
+    return arena;
+}/*}}}*/
+
+void ArenaPool::recycle(Arena *arena)
+{/*{{{*/
+    {
+        ScopedLock l(m_mutex);
+        if (m_free.size() < m_max_free) {
+            arena->m_used = 0;
+            arena->revive();
+            m_free.push_back(arena);
+            return;
+        }
+    }
+
+    delete arena;
+}/*}}}*/
+
+} // namespace base
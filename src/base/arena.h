@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_ARENA_H_
+#define BASE_ARENA_H_
+
+#include <cstdlib>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/ref_counted.h"
+
+using namespace std;
+
+namespace base {
+
+/* Pool of arenas, an arena is a block of memory allocated from by
+ * bumping, and is given back to the pool, not freed, once its last
+ * reference is dropped. Each arena in use holds one reference to the
+ * pool, so the pool outlives them.
+ *
+ * NOTE: acquire and Arena::alloc must be called by one thread, arenas
+ * can be released by any thread.
+ * */
+class ArenaPool: public RefCounted
+{
+    public:
+        class Arena: public RefCounted
+        {
+            public:
+                char *data() const { return m_data; };
+                size_t size() const { return m_size; };
+                size_t room() const { return m_size - m_used; };
+
+                /* the room for at most len bytes, NULL if not enough,
+                 * commit the bytes written then */
+                char *reserve(size_t len)
+                {
+                    return len <= room()? m_data + m_used: NULL;
+                };
+                void commit(size_t len) { m_used += len; };
+
+            protected:
+                virtual ~Arena() { free(m_data); };
+                virtual void release();
+
+            private:
+                friend class ArenaPool;
+                Arena(size_t size);
+
+                ArenaPool *m_pool;
+                char *m_data;
+                size_t m_size;
+                size_t m_used;
+        };
+
+    public:
+        /* the arenas are of at least arena_bytes, at most max_free of
+         * them are kept for reuse */
+        static ArenaPool *create(size_t arena_bytes, size_t max_free);
+
+        /* an empty arena of at least size bytes, the caller owns the
+         * returned reference, NULL on failure */
+        Arena *acquire(size_t size);
+
+        unsigned long getAllocated() const { return m_allocated; };
+        unsigned long getReused() const { return m_reused; };
+
+    protected:
+        ArenaPool(size_t arena_bytes, size_t max_free);
+        virtual ~ArenaPool();
+
+    private:
+        void recycle(Arena *arena);
+
+    private:
+        size_t m_arena_bytes;
+        size_t m_max_free;
+
+        Mutex m_mutex;
+        vector<Arena *> m_free;
+
+        volatile unsigned long m_allocated;
+        volatile unsigned long m_reused;
+};
+
+} // namespace base
+
+#endif // BASE_ARENA_H_
@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/delimiter_scanner.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace base {
+
+/* NOTE: scanFirst is constant initialized, so scanning from other static
+ * initializers is safe, the kernel is selected on the first call. */
+DelimiterScanner::ScanFunc DelimiterScanner::m_scan_func = &DelimiterScanner::scanFirst;
+DelimiterScanner::ScanStringFunc DelimiterScanner::m_scan_string_func =
+    &DelimiterScanner::scanStringFirst;
+const char *DelimiterScanner::m_impl_name = NULL;
+
+size_t DelimiterScanner::scanFirst(const char *buf, size_t len, char delimiter,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    m_scan_func = selectScanFunc(&m_impl_name);
+    return m_scan_func(buf, len, delimiter, positions, max_positions, scanned);
+}/*}}}*/
+
+size_t DelimiterScanner::scanStringFirst(const char *buf, size_t len,
+        const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    m_scan_string_func = selectScanStringFunc();
+    return m_scan_string_func(buf, len, delimiter, delimiter_len,
+            positions, max_positions, scanned);
+}/*}}}*/
+
+const char *DelimiterScanner::getImplName()
+{/*{{{*/
+    if (NULL == m_impl_name) {
+        m_scan_func = selectScanFunc(&m_impl_name);
+    }
+
+    return m_impl_name;
+}/*}}}*/
+
+DelimiterScanner::ScanFunc DelimiterScanner::selectScanFunc(const char **impl_name)
+{/*{{{*/
+#if defined(__x86_64__) || defined(__i386__)
+    if (isAvx2Supported()) {
+        *impl_name = "avx2";
+        return &scanAvx2;
+    }
+
+    if (isSse2Supported()) {
+        *impl_name = "sse2";
+        return &scanSse2;
+    }
+#endif
+
+    *impl_name = "scalar";
+    return &scanScalar;
+}/*}}}*/
+
+DelimiterScanner::ScanStringFunc DelimiterScanner::selectScanStringFunc()
+{/*{{{*/
+#if defined(__x86_64__) || defined(__i386__)
+    if (isAvx2Supported()) {
+        return &scanStringAvx2;
+    }
+
+    if (isSse2Supported()) {
+        return &scanStringSse2;
+    }
+#endif
+
+    return &scanStringScalar;
+}/*}}}*/
+
+size_t DelimiterScanner::scanScalar(const char *buf, size_t len, char delimiter,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    /* Branchless: always store the offset, only advance the counter
+     * when the byte is a delimiter. positions[n] may be overwritten
+     * by the next byte, so stop one byte after the array is full. */
+    for (i = 0; i < len; ++i) {
+        positions[n] = i;
+        n += (buf[i] == delimiter);
+        if (n == max_positions) {
+            ++i;
+            break;
+        }
+    }
+
+    *scanned = i;
+    return n;
+}/*}}}*/
+
+size_t DelimiterScanner::scanStringScalar(const char *buf, size_t len,
+        const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    while (i + delimiter_len <= len) {
+        const char *p = reinterpret_cast<const char *>(memchr(buf + i,
+                    delimiter[0], len - delimiter_len + 1 - i));
+        if (NULL == p) {
+            break;
+        }
+
+        size_t start = p - buf;
+        if (0 != memcmp(p + 1, delimiter + 1, delimiter_len - 1)) {
+            i = start + 1;
+            continue;
+        }
+
+        i = start + delimiter_len;
+        positions[n++] = i - 1;
+        if (n == max_positions) {
+            *scanned = i;
+            return n;
+        }
+    }
+
+    *scanned = len;
+    return n;
+}/*}}}*/
+
+#if defined(__x86_64__) || defined(__i386__)
+
+bool DelimiterScanner::isSse2Supported()
+{/*{{{*/
+#if defined(__x86_64__)
+    return true;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}/*}}}*/
+
+bool DelimiterScanner::isAvx2Supported()
+{/*{{{*/
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}/*}}}*/
+
+/* Verify the candidates of mask whose first and last bytes match, block
+ * starts at offset base. next is the offset where the next delimiter
+ * may start, candidates before it overlap the last found delimiter.
+ * Return false when positions is full, *scanned is set after the last
+ * stored delimiter then. */
+static inline bool verifyMask(unsigned int mask, size_t base,
+        const char *buf, const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t &n, size_t &next,
+        size_t *scanned)
+{/*{{{*/
+    while (0 != mask) {
+        size_t start = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if (start < next || 0 != memcmp(buf + start + 1, delimiter + 1,
+                    delimiter_len - 2)) {
+            continue;
+        }
+
+        next = start + delimiter_len;
+        positions[n++] = next - 1;
+        if (n == max_positions) {
+            *scanned = next;
+            return false;
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+/* Scan the tail which is shorter than one block with the scalar loop */
+static inline size_t scanStringTail(const char *buf, size_t len,
+        const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t n, size_t next,
+        size_t *scanned)
+{/*{{{*/
+    size_t tail_scanned = 0;
+    size_t m = DelimiterScanner::scanStringScalar(buf + next, len - next,
+            delimiter, delimiter_len,
+            positions + n, max_positions - n, &tail_scanned);
+    for (size_t k = n; k < n + m; ++k) {
+        positions[k] += next;
+    }
+    *scanned = next + tail_scanned;
+
+    return n + m;
+}/*}}}*/
+
+/* Emit the offsets of all set bits of mask, block starts at offset base.
+ * Return false when positions is full, *scanned is set after the last
+ * stored delimiter then. */
+static inline bool emitMask(unsigned int mask, size_t base,
+        size_t *positions, size_t max_positions, size_t &n, size_t *scanned)
+{/*{{{*/
+    while (0 != mask) {
+        size_t pos = base + __builtin_ctz(mask);
+        positions[n++] = pos;
+        if (n == max_positions) {
+            *scanned = pos + 1;
+            return false;
+        }
+        mask &= mask - 1;
+    }
+
+    return true;
+}/*}}}*/
+
+__attribute__((target("sse2")))
+size_t DelimiterScanner::scanSse2(const char *buf, size_t len, char delimiter,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    const __m128i needle = _mm_set1_epi8(delimiter);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (!emitMask(mask, i, positions, max_positions, n, scanned))
+            return n;
+    }
+
+    size_t tail_scanned = 0;
+    size_t m = scanScalar(buf + i, len - i, delimiter,
+            positions + n, max_positions - n, &tail_scanned);
+    for (size_t k = n; k < n + m; ++k) {
+        positions[k] += i;
+    }
+    *scanned = i + tail_scanned;
+
+    return n + m;
+}/*}}}*/
+
+__attribute__((target("avx2")))
+size_t DelimiterScanner::scanAvx2(const char *buf, size_t len, char delimiter,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    const __m256i needle = _mm256_set1_epi8(delimiter);
+
+    for (; i + 64 <= len; i += 64) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i + 32));
+        unsigned int mask_lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+        unsigned int mask_hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+        if (0 == (mask_lo | mask_hi))
+            continue;
+        if (!emitMask(mask_lo, i, positions, max_positions, n, scanned))
+            return n;
+        if (!emitMask(mask_hi, i + 32, positions, max_positions, n, scanned))
+            return n;
+    }
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (!emitMask(mask, i, positions, max_positions, n, scanned))
+            return n;
+    }
+
+    size_t tail_scanned = 0;
+    size_t m = scanScalar(buf + i, len - i, delimiter,
+            positions + n, max_positions - n, &tail_scanned);
+    for (size_t k = n; k < n + m; ++k) {
+        positions[k] += i;
+    }
+    *scanned = i + tail_scanned;
+
+    return n + m;
+}/*}}}*/
+
+__attribute__((target("sse2")))
+size_t DelimiterScanner::scanStringSse2(const char *buf, size_t len,
+        const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+    size_t next = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    const __m128i first = _mm_set1_epi8(delimiter[0]);
+    const __m128i last = _mm_set1_epi8(delimiter[delimiter_len - 1]);
+
+    for (; i + delimiter_len - 1 + 16 <= len; i += 16) {
+        __m128i block_first = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(buf + i));
+        __m128i block_last = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(buf + i + delimiter_len - 1));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(block_first, first),
+                    _mm_cmpeq_epi8(block_last, last)));
+        if (!verifyMask(mask, i, buf, delimiter, delimiter_len,
+                    positions, max_positions, n, next, scanned))
+            return n;
+    }
+
+    return scanStringTail(buf, len, delimiter, delimiter_len,
+            positions, max_positions, n, std::max(i, next), scanned);
+}/*}}}*/
+
+__attribute__((target("avx2")))
+size_t DelimiterScanner::scanStringAvx2(const char *buf, size_t len,
+        const char *delimiter, size_t delimiter_len,
+        size_t *positions, size_t max_positions, size_t *scanned)
+{/*{{{*/
+    size_t n = 0;
+    size_t i = 0;
+    size_t next = 0;
+
+    if (0 == max_positions) {
+        *scanned = 0;
+        return 0;
+    }
+
+    const __m256i first = _mm256_set1_epi8(delimiter[0]);
+    const __m256i last = _mm256_set1_epi8(delimiter[delimiter_len - 1]);
+
+    for (; i + delimiter_len - 1 + 32 <= len; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(buf + i));
+        __m256i block_last = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(buf + i + delimiter_len - 1));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(block_first, first),
+                    _mm256_cmpeq_epi8(block_last, last)));
+        if (!verifyMask(mask, i, buf, delimiter, delimiter_len,
+                    positions, max_positions, n, next, scanned))
+            return n;
+    }
+
+    return scanStringTail(buf, len, delimiter, delimiter_len,
+            positions, max_positions, n, std::max(i, next), scanned);
+}/*}}}*/
+
+#endif
+
+} // namespace base
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_DELIMITER_SCANNER_H_
+#define BASE_DELIMITER_SCANNER_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+namespace base {
+
+/* Find all delimiter positions of one buffer in a single pass.
+ *
+ * The kernel is picked once at startup: AVX2 or SSE2 on x86 cpus which
+ * support them, a branchless scalar loop elsewhere.
+ *
+ * Multi-byte delimiters are found by comparing the first and the last
+ * byte of delimiter with the whole block at once, only the candidates
+ * matching both are verified with memcmp.
+ * */
+class DelimiterScanner
+{
+    public:
+        typedef size_t (*ScanFunc)(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        typedef size_t (*ScanStringFunc)(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned);
+
+        /* Store the offsets of at most max_positions delimiters of
+         * buf[0, len) into positions, return the number of offsets stored.
+         * The scanning stops after the last stored delimiter when
+         * max_positions is reached, the length of scanned bytes is returned
+         * with scanned.
+         * */
+        static size_t scan(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned)
+        {
+            return m_scan_func(buf, len, delimiter,
+                    positions, max_positions, scanned);
+        };
+
+        /* Same as scan, but the delimiter is a byte string, the offset
+         * of its last byte is stored for each occurrence. The occurrences
+         * do not overlap.
+         * */
+        static size_t scanString(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned)
+        {
+            if (1 == delimiter_len) {
+                return m_scan_func(buf, len, delimiter[0],
+                        positions, max_positions, scanned);
+            }
+            return m_scan_string_func(buf, len, delimiter, delimiter_len,
+                    positions, max_positions, scanned);
+        };
+
+        static const char *getImplName();
+
+        static size_t scanScalar(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static size_t scanStringScalar(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned);
+#if defined(__x86_64__) || defined(__i386__)
+        static size_t scanSse2(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static size_t scanAvx2(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static size_t scanStringSse2(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static size_t scanStringAvx2(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static bool isSse2Supported();
+        static bool isAvx2Supported();
+#endif
+
+    private:
+        static ScanFunc selectScanFunc(const char **impl_name);
+        static ScanStringFunc selectScanStringFunc();
+        static size_t scanFirst(const char *buf, size_t len, char delimiter,
+                size_t *positions, size_t max_positions, size_t *scanned);
+        static size_t scanStringFirst(const char *buf, size_t len,
+                const char *delimiter, size_t delimiter_len,
+                size_t *positions, size_t max_positions, size_t *scanned);
+
+    private:
+        static const char *m_impl_name;
+        static ScanFunc m_scan_func;
+        static ScanStringFunc m_scan_string_func;
+};
+
+} // namespace base
+
+#endif // BASE_DELIMITER_SCANNER_H_
@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/io_uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "easylogging/easylogging++.h"
+
+namespace base {
+
+IOUring::IOUring()
+{/*{{{*/
+    m_ring_fd = -1;
+    memset(m_supported_ops, 0, sizeof(m_supported_ops));
+    m_sq_ptr = NULL;
+    m_sq_len = 0;
+    m_cq_ptr = NULL;
+    m_cq_len = 0;
+    m_sqes = NULL;
+    m_sqes_len = 0;
+    m_sq_head = m_sq_tail = m_sq_mask = m_sq_array = NULL;
+    m_cq_head = m_cq_tail = m_cq_mask = NULL;
+    m_cqes = NULL;
+    m_sqe_head = m_sqe_tail = 0;
+}/*}}}*/
+
+IOUring::~IOUring()
+{/*{{{*/
+    close();
+}/*}}}*/
+
+#ifdef BASE_HAVE_IO_URING
+
+bool IOUring::init(unsigned entries)
+{/*{{{*/
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    m_ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (m_ring_fd < 0) {
+        LWARNING << "Fail to setup io_uring, " << strerror(errno);
+        m_ring_fd = -1;
+        return false;
+    }
+
+    m_sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        m_sq_len = m_cq_len = std::max(m_sq_len, m_cq_len);
+    }
+
+    m_sq_ptr = mmap(NULL, m_sq_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == m_sq_ptr) {
+        LWARNING << "Fail to map io_uring sq, " << strerror(errno);
+        m_sq_ptr = NULL;
+        close();
+        return false;
+    }
+
+    if (single_mmap) {
+        m_cq_ptr = m_sq_ptr;
+    } else {
+        m_cq_ptr = mmap(NULL, m_cq_len, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == m_cq_ptr) {
+            LWARNING << "Fail to map io_uring cq, " << strerror(errno);
+            m_cq_ptr = NULL;
+            close();
+            return false;
+        }
+    }
+
+    m_sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, m_sqes_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+        LWARNING << "Fail to map io_uring sqes, " << strerror(errno);
+        close();
+        return false;
+    }
+    m_sqes = reinterpret_cast<struct io_uring_sqe *>(sqes);
+
+    char *sq = reinterpret_cast<char *>(m_sq_ptr);
+    m_sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+    char *cq = reinterpret_cast<char *>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    m_cqes = cq + p.cq_off.cqes;
+
+    m_sqe_head = m_sqe_tail = *m_sq_tail;
+
+    /* probe the supported operations, old kernels have no probe at all */
+    size_t probe_len = sizeof(struct io_uring_probe)
+        + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe =
+        reinterpret_cast<struct io_uring_probe *>(calloc(1, probe_len));
+    if (NULL != probe) {
+        if (0 == syscall(__NR_io_uring_register, m_ring_fd,
+                    IORING_REGISTER_PROBE, probe, 256)) {
+            for (int i = 0; i < probe->ops_len && i < 256; ++i) {
+                m_supported_ops[i] =
+                    (probe->ops[i].flags & IO_URING_OP_SUPPORTED)? 1: 0;
+            }
+        }
+        free(probe);
+    }
+
+    return true;
+}/*}}}*/
+
+void IOUring::close()
+{/*{{{*/
+    if (NULL != m_sqes) {
+        munmap(m_sqes, m_sqes_len); m_sqes = NULL;
+    }
+    if (NULL != m_cq_ptr && m_cq_ptr != m_sq_ptr) {
+        munmap(m_cq_ptr, m_cq_len);
+    }
+    m_cq_ptr = NULL;
+    if (NULL != m_sq_ptr) {
+        munmap(m_sq_ptr, m_sq_len); m_sq_ptr = NULL;
+    }
+    if (-1 != m_ring_fd) {
+        ::close(m_ring_fd); m_ring_fd = -1;
+    }
+}/*}}}*/
+
+bool IOUring::isOpSupported(int op) const
+{/*{{{*/
+    return op >= 0 && op < 256 && 0 != m_supported_ops[op];
+}/*}}}*/
+
+struct io_uring_sqe *IOUring::getSqe()
+{/*{{{*/
+    if (-1 == m_ring_fd) return NULL;
+
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sqe_tail - head > *m_sq_mask) {
+        return NULL;
+    }
+
+    struct io_uring_sqe *sqe = &m_sqes[m_sqe_tail & *m_sq_mask];
+    ++m_sqe_tail;
+    memset(sqe, 0, sizeof(*sqe));
+
+    return sqe;
+}/*}}}*/
+
+int IOUring::submit(unsigned wait_nr)
+{/*{{{*/
+    if (-1 == m_ring_fd) return -EBADF;
+
+    /* publish the prepared entries to the kernel */
+    unsigned tail = *m_sq_tail;
+    unsigned to_submit = m_sqe_tail - m_sqe_head;
+    for (; m_sqe_head != m_sqe_tail; ++m_sqe_head, ++tail) {
+        m_sq_array[tail & *m_sq_mask] = m_sqe_head & *m_sq_mask;
+    }
+    __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+
+    if (0 == to_submit && 0 == wait_nr) {
+        return 0;
+    }
+
+    int ret = 0;
+    do {
+        ret = syscall(__NR_io_uring_enter, m_ring_fd, to_submit, wait_nr,
+                (wait_nr > 0)? IORING_ENTER_GETEVENTS: 0, NULL, 0);
+    } while (ret < 0 && EINTR == errno);
+
+    return (ret < 0)? -errno: ret;
+}/*}}}*/
+
+bool IOUring::popCqe(uint64_t &user_data, int &res)
+{/*{{{*/
+    if (-1 == m_ring_fd) return false;
+
+    unsigned head = *m_cq_head;
+    if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    struct io_uring_cqe *cqes = reinterpret_cast<struct io_uring_cqe *>(m_cqes);
+    struct io_uring_cqe *cqe = &cqes[head & *m_cq_mask];
+    user_data = cqe->user_data;
+    res = cqe->res;
+
+    __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}/*}}}*/
+
+bool IOUring::registerEventFd(int event_fd)
+{/*{{{*/
+    if (0 != syscall(__NR_io_uring_register, m_ring_fd,
+                IORING_REGISTER_EVENTFD, &event_fd, 1)) {
+        LWARNING << "Fail to register eventfd to io_uring, " << strerror(errno);
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+#else
+
+bool IOUring::init(unsigned entries)
+{/*{{{*/
+    LWARNING << "io_uring is not supported on this platform";
+    return false;
+}/*}}}*/
+
+void IOUring::close() {}
+bool IOUring::isOpSupported(int op) const { return false; }
+struct io_uring_sqe *IOUring::getSqe() { return NULL; }
+int IOUring::submit(unsigned wait_nr) { return -ENOSYS; }
+bool IOUring::popCqe(uint64_t &user_data, int &res) { return false; }
+bool IOUring::registerEventFd(int event_fd) { return false; }
+
+#endif // BASE_HAVE_IO_URING
+
+} // namespace base
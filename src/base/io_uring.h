@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_IO_URING_H_
+#define BASE_IO_URING_H_
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include <cstdlib>
+
+#include "base/common.h"
+#include "base/noncopyable.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BASE_HAVE_IO_URING 1
+#else
+struct io_uring_sqe;
+#endif
+
+namespace base {
+
+/* Minimal io_uring wrapper on top of the raw syscalls (no liburing),
+ * one submission queue and one completion queue, used by one thread.
+ * */
+class IOUring : base::noncopyable
+{
+    public:
+        IOUring();
+        ~IOUring();
+
+        /* return false if the kernel has no io_uring support */
+        bool init(unsigned entries);
+        void close();
+        bool isOpSupported(int op) const;
+
+        /* NULL if the submission queue is full */
+        struct io_uring_sqe *getSqe();
+        unsigned getPending() const { return m_sqe_tail - m_sqe_head; };
+
+        /* submit the prepared entries and wait for wait_nr completions,
+         * return the number of submitted entries or -errno */
+        int submit(unsigned wait_nr = 0);
+
+        /* pop one completion, return false if there is none */
+        bool popCqe(uint64_t &user_data, int &res);
+
+        /* signal the eventfd on every completion */
+        bool registerEventFd(int event_fd);
+
+    private:
+        int m_ring_fd;
+        unsigned char m_supported_ops[256];
+
+        void *m_sq_ptr;
+        size_t m_sq_len;
+        void *m_cq_ptr;
+        size_t m_cq_len;
+        struct io_uring_sqe *m_sqes;
+        size_t m_sqes_len;
+
+        unsigned *m_sq_head;
+        unsigned *m_sq_tail;
+        unsigned *m_sq_mask;
+        unsigned *m_sq_array;
+        unsigned *m_cq_head;
+        unsigned *m_cq_tail;
+        unsigned *m_cq_mask;
+        void *m_cqes;
+
+        /* entries handed out by getSqe but not yet submitted */
+        unsigned m_sqe_head;
+        unsigned m_sqe_tail;
+};
+
+} // namespace base
+
+#endif // BASE_IO_URING_H_
@@ -20,6 +20,7 @@
 //
 ///////////////////////////////////////////////////////////////////////////
 #include "base/json.h"
+#include "base/tools.h"
 
 #include "easylogging/easylogging++.h"
 
@@ -178,4 +179,21 @@ string Json::serialize(const Value &v)
     return string(json);
 }/*}}}*/
 
+void Json::parseStringArray(const string &json, vector<string> &values)
+{/*{{{*/
+    Document d;
+    d.Parse(json.c_str());
+    if (d.HasParseError() || !d.IsArray()) {
+        throw JsonErr("json string is not a valid array");
+    }
+
+    values.clear();
+    for (SizeType i = 0; i < d.Size(); ++i) {
+        if (!d[i].IsString()) {
+            throw JsonErr("the item " + int2Str(i) + " of array is not string");
+        }
+        values.push_back(string(d[i].GetString(), d[i].GetStringLength()));
+    }
+}/*}}}*/
+
 } // namespace base 
@@ -48,6 +48,8 @@ class Json {
     static void getValue(const rapidjson::Value &obj, const char *name, string &value);
     static void getValue(const rapidjson::Value &obj, const char *name, bool &value);
     static string serialize(const Value &v);
+    /* parse a json array of strings, e.g. ["a", "b"] */
+    static void parseStringArray(const string &json, vector<string> &values);
 
     static const char** TypeNames;
 };
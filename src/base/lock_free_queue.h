@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_LOCK_FREE_QUEUE_H_
+#define BASE_LOCK_FREE_QUEUE_H_
+
+#include <stdint.h>
+
+#include <cstdlib>
+
+#include "base/noncopyable.h"
+
+namespace base {
+
+/* Bounded multi-producer multi-consumer queue without locks.
+ *
+ * Each cell carries a sequence number which tells whether it is ready to
+ * be written (sequence == pos) or read (sequence == pos + 1) by the
+ * producer or consumer holding pos, the positions are claimed with one
+ * compare-and-swap. The capacity is rounded up to a power of two.
+ *
+ * NOTE: push returns false if the queue is full, pop returns false if it
+ * is empty, neither of them ever blocks.
+ * */
+template <typename T>
+class LockFreeQueue : base::noncopyable
+{
+    public:
+        explicit LockFreeQueue(size_t capacity);
+        ~LockFreeQueue() { delete [] m_cells; };
+
+        bool push(const T &value);
+        bool pop(T &value);
+        size_t capacity() const { return m_mask + 1; };
+
+    private:
+        struct Cell
+        {
+            volatile size_t sequence;
+            T value;
+        };
+
+        static const size_t CACHE_LINE_BYTES = 64;
+
+    private:
+        Cell *m_cells;
+        size_t m_mask;
+
+        /* the two positions are written by different threads, keep them
+         * on separate cache lines */
+        char m_pad0[CACHE_LINE_BYTES];
+        volatile size_t m_enqueue_pos;
+        char m_pad1[CACHE_LINE_BYTES - sizeof(size_t)];
+        volatile size_t m_dequeue_pos;
+        char m_pad2[CACHE_LINE_BYTES - sizeof(size_t)];
+};
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+{/*{{{*/
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    m_cells = new Cell[size];
+    m_mask = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        m_cells[i].sequence = i;
+    }
+
+    m_enqueue_pos = 0;
+    m_dequeue_pos = 0;
+}/*}}}*/
+
+template <typename T>
+bool LockFreeQueue<T>::push(const T &value)
+{/*{{{*/
+    Cell *cell = NULL;
+    size_t pos = __atomic_load_n(&m_enqueue_pos, __ATOMIC_RELAXED);
+
+    while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (0 == diff) {
+            if (__sync_bool_compare_and_swap(&m_enqueue_pos, pos, pos + 1)) {
+                break;
+            }
+            pos = __atomic_load_n(&m_enqueue_pos, __ATOMIC_RELAXED);
+        } else if (diff < 0) {
+            /* the cell of the previous round is not consumed yet */
+            return false;
+        } else {
+            pos = __atomic_load_n(&m_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->value = value;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    return true;
+}/*}}}*/
+
+template <typename T>
+bool LockFreeQueue<T>::pop(T &value)
+{/*{{{*/
+    Cell *cell = NULL;
+    size_t pos = __atomic_load_n(&m_dequeue_pos, __ATOMIC_RELAXED);
+
+    while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (0 == diff) {
+            if (__sync_bool_compare_and_swap(&m_dequeue_pos, pos, pos + 1)) {
+                break;
+            }
+            pos = __atomic_load_n(&m_dequeue_pos, __ATOMIC_RELAXED);
+        } else if (diff < 0) {
+            /* the cell is not produced yet */
+            return false;
+        } else {
+            pos = __atomic_load_n(&m_dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    value = cell->value;
+    __atomic_store_n(&cell->sequence, pos + m_mask + 1, __ATOMIC_RELEASE);
+
+    return true;
+}/*}}}*/
+
+} // namespace base
+
+#endif // BASE_LOCK_FREE_QUEUE_H_
@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/mmap_window.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "base/mutex.h"
+#include "base/scoped_lock.h"
+
+#include "easylogging/easylogging++.h"
+
+namespace base {
+
+namespace {
+
+const int MAX_WINDOWS = 256;
+
+/* mapped ranges checked by the SIGBUS guard, a slot is free when
+ * its start is NULL */
+struct MappedRange {
+    char * volatile start;
+    volatile size_t len;
+};
+
+MappedRange g_ranges[MAX_WINDOWS];
+Mutex g_ranges_mutex;
+struct sigaction g_old_sigbus_action;
+pthread_once_t g_sigbus_guard_once = PTHREAD_ONCE_INIT;
+bool g_sigbus_guard_installed = false;
+
+} // namespace
+
+MmapWindow::~MmapWindow()
+{/*{{{*/
+    if (NULL != m_data) {
+        unregisterRange(m_slot);
+        munmap(m_data, m_len);
+        m_data = NULL;
+    }
+}/*}}}*/
+
+size_t MmapWindow::getPageSize()
+{/*{{{*/
+    static size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}/*}}}*/
+
+MmapWindow *MmapWindow::create(int fd, off_t offset, size_t len)
+{/*{{{*/
+    if (0 == len || !installSigbusGuard()) {
+        return NULL;
+    }
+
+    void *addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, offset);
+    if (MAP_FAILED == addr) {
+        LERROR << "Fail to mmap fd " << fd
+               << ", offset " << offset << ", length " << len
+               << ", " << strerror(errno);
+        return NULL;
+    }
+
+    char *data = reinterpret_cast<char *>(addr);
+    int slot = registerRange(data, len);
+    if (-1 == slot) {
+        LWARNING << "Too many mmap windows in use";
+        munmap(data, len);
+        return NULL;
+    }
+
+    /* the window is read once from head to tail */
+    madvise(data, len, MADV_SEQUENTIAL);
+    madvise(data, len, MADV_WILLNEED);
+
+    MmapWindow *window = new MmapWindow();
+    window->m_data = data;
+    window->m_len = len;
+    window->m_slot = slot;
+
+    return window;
+}/*}}}*/
+
+bool MmapWindow::installSigbusGuard()
+{/*{{{*/
+    pthread_once(&g_sigbus_guard_once, doInstallSigbusGuard);
+    return g_sigbus_guard_installed;
+}/*}}}*/
+
+void MmapWindow::doInstallSigbusGuard()
+{/*{{{*/
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = onSigbus;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO;
+
+    /* the handler must not initialize anything */
+    getPageSize();
+
+    if (0 != sigaction(SIGBUS, &sa, &g_old_sigbus_action)) {
+        LERROR << "Fail to install SIGBUS handler, " << strerror(errno);
+        return;
+    }
+
+    g_sigbus_guard_installed = true;
+}/*}}}*/
+
+void MmapWindow::onSigbus(int signum, siginfo_t *info, void *context)
+{/*{{{*/
+    char *addr = reinterpret_cast<char *>(info->si_addr);
+
+    for (int i = 0; i < MAX_WINDOWS; ++i) {
+        char *start = g_ranges[i].start;
+        if (NULL != start && addr >= start && addr < start + g_ranges[i].len) {
+            /* the file was truncated, read zeros from now on */
+            size_t page_size = getPageSize();
+            char *page = start + (addr - start) / page_size * page_size;
+            if (MAP_FAILED != mmap(page, page_size, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0)) {
+                return;
+            }
+            break;
+        }
+    }
+
+    /* not ours, fall back to the previous action and fault again */
+    sigaction(SIGBUS, &g_old_sigbus_action, NULL);
+}/*}}}*/
+
+int MmapWindow::registerRange(char *start, size_t len)
+{/*{{{*/
+    /* NOTE: the signal handler reads the ranges without the lock,
+     * so len is always published before start */
+    ScopedLock l(g_ranges_mutex);
+    for (int i = 0; i < MAX_WINDOWS; ++i) {
+        if (NULL == g_ranges[i].start) {
+            g_ranges[i].len = len;
+            __sync_synchronize();
+            g_ranges[i].start = start;
+            return i;
+        }
+    }
+
+    return -1;
+}/*}}}*/
+
+void MmapWindow::unregisterRange(int slot)
+{/*{{{*/
+    if (slot < 0 || slot >= MAX_WINDOWS) return;
+    ScopedLock l(g_ranges_mutex);
+    g_ranges[slot].start = NULL;
+    __sync_synchronize();
+}/*}}}*/
+
+} // namespace base
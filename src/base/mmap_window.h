@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_MMAP_WINDOW_H_
+#define BASE_MMAP_WINDOW_H_
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <cstdlib>
+
+#include "base/common.h"
+#include "base/ref_counted.h"
+
+namespace base {
+
+/* Read-only mapping of a file range, unmapped when the last reference is
+ * dropped.
+ *
+ * If the file is truncated under the mapping, touching the pages beyond
+ * the new end raises SIGBUS, the guard installed by create replaces the
+ * faulting page of a registered window with a zero page, so the reader
+ * (in any thread) sees zeros instead of crashing.
+ * */
+class MmapWindow: public RefCounted
+{
+    public:
+        /* offset should be page aligned, return NULL on failure */
+        static MmapWindow *create(int fd, off_t offset, size_t len);
+        static size_t getPageSize();
+
+        const char *data() const { return m_data; };
+        size_t length() const { return m_len; };
+
+    protected:
+        MmapWindow(): m_data(NULL), m_len(0), m_slot(-1) {};
+        virtual ~MmapWindow();
+
+    private:
+        static bool installSigbusGuard();
+        static void doInstallSigbusGuard();
+        static void onSigbus(int signum, siginfo_t *info, void *context);
+        static int registerRange(char *start, size_t len);
+        static void unregisterRange(int slot);
+
+    private:
+        char *m_data;
+        size_t m_len;
+        int m_slot;
+};
+
+} // namespace base
+
+#endif // BASE_MMAP_WINDOW_H_
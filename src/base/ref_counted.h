@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_REF_COUNTED_H_
+#define BASE_REF_COUNTED_H_
+
+#include "base/noncopyable.h"
+
+namespace base {
+
+/* Intrusive reference counter, the object is created with one reference.
+ *
+ * NOTE: ref and unref are thread-safe, release is called by the thread
+ * which drops the last reference.
+ * */
+class RefCounted : base::noncopyable
+{
+    public:
+        RefCounted(): m_ref_count(1) {};
+
+        void ref() { __sync_add_and_fetch(&m_ref_count, 1); };
+        void unref()
+        {
+            if (0 == __sync_sub_and_fetch(&m_ref_count, 1)) release();
+        };
+        bool isShared() const { return m_ref_count > 1; };
+
+    protected:
+        virtual ~RefCounted() {};
+        virtual void release() { delete this; };
+
+        /* give the object its one reference again, for a release which
+         * recycles the object rather than deletes it */
+        void revive() { __sync_lock_test_and_set(&m_ref_count, 1); };
+
+    private:
+        volatile int m_ref_count;
+};
+
+} // namespace base
+
+#endif // BASE_REF_COUNTED_H_
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "base/ring_buffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "easylogging/easylogging++.h"
+
+namespace base {
+
+void RingBuffer::Segment::release()
+{/*{{{*/
+    /* the segment is deleted by reclaim once it is marked released,
+     * keep the ring alive until we are done with it */
+    RingBuffer *ring = m_ring;
+    __sync_synchronize();
+    m_released = true;
+    ring->unref();
+}/*}}}*/
+
+RingBuffer::RingBuffer()
+{/*{{{*/
+    m_base = NULL;
+    m_size = 0;
+    m_head = 0;
+    m_tail = 0;
+}/*}}}*/
+
+RingBuffer::~RingBuffer()
+{/*{{{*/
+    /* all the segments are released when the last reference is dropped */
+    while (!m_segments.empty()) {
+        delete m_segments.front();
+        m_segments.pop_front();
+    }
+
+    if (NULL != m_base) {
+        munmap(m_base, m_size * 2);
+        m_base = NULL;
+    }
+}/*}}}*/
+
+RingBuffer *RingBuffer::create(size_t size)
+{/*{{{*/
+    RingBuffer *ring = new RingBuffer();
+    if (!ring->init(size)) {
+        delete ring;
+        return NULL;
+    }
+
+    return ring;
+}/*}}}*/
+
+bool RingBuffer::init(size_t size)
+{/*{{{*/
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    m_size = (size + page_size - 1) / page_size * page_size;
+    if (0 == m_size) m_size = page_size;
+
+    int fd = createSharedFd(m_size);
+    if (-1 == fd) {
+        return false;
+    }
+
+    bool ret = false;
+
+    /* reserve the address range first, then map the pages twice into it */
+    void *addr = mmap(NULL, m_size * 2, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == addr) {
+        LERROR << "Fail to reserve " << m_size * 2 << " bytes"
+               << ", " << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    char *base = reinterpret_cast<char *>(addr);
+    if (MAP_FAILED == mmap(base, m_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, 0) ||
+        MAP_FAILED == mmap(base + m_size, m_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, 0)) {
+        LERROR << "Fail to map ring buffer of " << m_size << " bytes"
+               << ", " << strerror(errno);
+        munmap(base, m_size * 2);
+    } else {
+        m_base = base;
+        ret = true;
+    }
+
+    /* the mappings keep the pages alive */
+    ::close(fd);
+
+    return ret;
+}/*}}}*/
+
+int RingBuffer::createSharedFd(size_t size)
+{/*{{{*/
+    int fd = -1;
+
+#ifdef SYS_memfd_create
+    fd = syscall(SYS_memfd_create, "logkafka_ring", 0);
+#endif
+
+    if (-1 == fd) {
+        /* no memfd, use an unlinked temporary file instead */
+        const char *dirs[] = {"/dev/shm", P_tmpdir};
+        for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]) && -1 == fd; ++i) {
+            string path = string(dirs[i]) + "/logkafka_ring.XXXXXX";
+            fd = mkstemp(&path[0]);
+            if (-1 != fd) unlink(path.c_str());
+        }
+    }
+
+    if (-1 == fd) {
+        LERROR << "Fail to create ring buffer file, " << strerror(errno);
+        return -1;
+    }
+
+    if (0 != ftruncate(fd, size)) {
+        LERROR << "Fail to resize ring buffer file to " << size << " bytes"
+               << ", " << strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}/*}}}*/
+
+RingBuffer::Segment *RingBuffer::acquire(uint64_t end)
+{/*{{{*/
+    Segment *segment = new Segment(this, end);
+    m_segments.push_back(segment);
+    return segment;
+}/*}}}*/
+
+void RingBuffer::reclaim()
+{/*{{{*/
+    while (!m_segments.empty() && m_segments.front()->isReleased()) {
+        Segment *segment = m_segments.front();
+        __sync_synchronize();
+        if (segment->end() > m_tail) m_tail = segment->end();
+        m_segments.pop_front();
+        delete segment;
+    }
+}/*}}}*/
+
+} // namespace base
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef BASE_RING_BUFFER_H_
+#define BASE_RING_BUFFER_H_
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include <cstdlib>
+#include <deque>
+
+#include "base/common.h"
+#include "base/ref_counted.h"
+
+using namespace std;
+
+namespace base {
+
+/* Ring buffer backed by two adjacent virtual mappings of the same pages,
+ * so any region no longer than size() starting anywhere in the ring is
+ * contiguous in memory, data never has to be moved to the head.
+ *
+ * Positions are logical byte offsets which grow monotonically, the bytes
+ * in [tail, head) are in use. The consumer hands out Segments for the
+ * consumed regions in order, the space of a segment is reclaimed after it
+ * and all the segments before it are released.
+ *
+ * NOTE: produce/acquire/reclaim must be called by one thread, segments
+ * can be released by any thread.
+ * */
+class RingBuffer: public RefCounted
+{
+    public:
+        class Segment: public RefCounted
+        {
+            public:
+                Segment(RingBuffer *ring, uint64_t end)
+                    : m_ring(ring), m_end(end), m_released(false)
+                { m_ring->ref(); };
+                uint64_t end() const { return m_end; };
+                void setEnd(uint64_t end) { m_end = end; };
+                bool isReleased() const { return m_released; };
+
+            protected:
+                virtual ~Segment() {};
+                virtual void release();
+
+            private:
+                friend class RingBuffer;
+                RingBuffer *m_ring;
+                uint64_t m_end;
+                volatile bool m_released;
+        };
+
+    public:
+        /* size is rounded up to the page size, return NULL on failure */
+        static RingBuffer *create(size_t size);
+
+        size_t size() const { return m_size; };
+        uint64_t head() const { return m_head; };
+        uint64_t tail() const { return m_tail; };
+        size_t room() const { return m_size - (m_head - m_tail); };
+        char *at(uint64_t pos) const { return m_base + pos % m_size; };
+
+        /* mark len bytes written at head() as in use */
+        void produce(size_t len) { m_head += len; };
+
+        /* create the segment which covers the consumed region up to end,
+         * the caller owns the returned reference */
+        Segment *acquire(uint64_t end);
+
+        /* give back the space of released segments */
+        void reclaim();
+
+    protected:
+        RingBuffer();
+        virtual ~RingBuffer();
+
+    private:
+        bool init(size_t size);
+        static int createSharedFd(size_t size);
+
+    private:
+        char *m_base;
+        size_t m_size;
+        uint64_t m_head;
+        uint64_t m_tail;
+        deque<Segment *> m_segments;
+};
+
+} // namespace base
+
+#endif // BASE_RING_BUFFER_H_
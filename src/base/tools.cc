@@ -24,11 +24,15 @@
 #include <arpa/inet.h>
 #include <glob.h>
 #include <libgen.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -114,6 +118,19 @@ bool str2Bool(std::string str)
     return b;
 }/*}}}*/
 
+bool hexstr2bytes(const string &hex, string &bytes)
+{/*{{{*/
+    if (hex.length() % 2 != 0) return false;
+
+    bytes.clear();
+    for (size_t i = 0; i < hex.length(); i += 2) {
+        if (!isxdigit(hex[i]) || !isxdigit(hex[i + 1])) return false;
+        bytes += (char)strtol(hex.substr(i, 2).c_str(), NULL, 16);
+    }
+
+    return true;
+}/*}}}*/
+
 const char* realDir(const char *filepath, char *realdir)
 {/*{{{*/
     char buf[PATH_MAX + 1] = {'\0'};
@@ -229,6 +246,39 @@ off_t getFsize(FILE *fp)
     return getFsize(fileno(fp));
 };/*}}}*/
 
+off_t getPageCacheBytes(int fd, off_t offset, off_t len)
+{/*{{{*/
+    static const off_t CHUNK_BYTES = 268435456; /* 256MB */
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    off_t end = offset + len;
+    off_t cached = 0;
+    vector<unsigned char> vec;
+
+    if (len <= 0) return 0;
+
+    /* the range is mapped chunk by chunk, mincore does not touch the pages */
+    for (off_t start = offset / page_size * page_size; start < end;
+            start += CHUNK_BYTES) {
+        size_t chunk = min(CHUNK_BYTES, end - start);
+        void *addr = mmap(NULL, chunk, PROT_READ, MAP_SHARED, fd, start);
+        if (MAP_FAILED == addr) {
+            break;
+        }
+
+        vec.resize((chunk + page_size - 1) / page_size);
+        if (0 == mincore(addr, chunk, &vec[0])) {
+            for (size_t i = 0; i < vec.size(); ++i) {
+                if (vec[i] & 1) cached += page_size;
+            }
+        }
+
+        munmap(addr, chunk);
+    }
+
+    return min(cached, len);
+};/*}}}*/
+
 string sig2str(int signum)
 {/*{{{*/
     return string(strsignal(signum));
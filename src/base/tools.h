@@ -47,6 +47,7 @@ extern void ltrim(char *str);
 extern void trim(char *str);
 extern string int2Str(long long val);
 extern bool str2Bool(string str);
+extern bool hexstr2bytes(const string &hex, string &bytes);
 extern const char* realDir(const char *filepath, char *realdir);
 extern bool isAbsPath(const char* filepath);
 
@@ -69,6 +70,8 @@ extern ino_t getInode(FILE *fp);
 extern off_t getFsize(const char *path);
 extern off_t getFsize(int fd);
 extern off_t getFsize(FILE *fp);
+/* bytes of the range [offset, offset + len) resident in page cache */
+extern off_t getPageCacheBytes(int fd, off_t offset, off_t len);
 extern string sig2str(int signum);
 extern long long hexstr2num(const char *buf, long long default_num);
 void strReplace(std::string& str, 
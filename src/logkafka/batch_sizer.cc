@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/batch_sizer.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace logkafka {
+
+BatchSizer::BatchSizer()
+{/*{{{*/
+    m_size = 1;
+    m_min_size = 1;
+    m_max_size = 1;
+    m_avg_line_bytes = 0;
+}/*}}}*/
+
+void BatchSizer::init(unsigned int size,
+        unsigned int min_size,
+        unsigned int max_size)
+{/*{{{*/
+    m_min_size = max(min_size, 1U);
+    m_max_size = max(max_size, m_min_size);
+    m_size = min(max(size, m_min_size), m_max_size);
+    m_avg_line_bytes = 0;
+}/*}}}*/
+
+void BatchSizer::update(size_t lines, size_t bytes, off_t lag, bool accepted)
+{/*{{{*/
+    if (0 != lines) {
+        /* moving average with weight 1/8 */
+        size_t line_bytes = max(bytes / lines, (size_t)1);
+        if (0 == m_avg_line_bytes) {
+            m_avg_line_bytes = line_bytes;
+        } else {
+            m_avg_line_bytes = max(m_avg_line_bytes - m_avg_line_bytes / 8
+                    + line_bytes / 8, (size_t)1);
+        }
+    }
+
+    if (m_min_size == m_max_size) {
+        return;
+    }
+
+    if (!accepted) {
+        m_size = max(m_size / 2, m_min_size);
+        return;
+    }
+
+    unsigned long lines_behind = 0;
+    if (lag > 0 && 0 != m_avg_line_bytes) {
+        lines_behind = lag / m_avg_line_bytes;
+    }
+
+    unsigned int target = (unsigned int)min(max(lines_behind,
+                (unsigned long)m_min_size), (unsigned long)m_max_size);
+    if (target > m_size) {
+        m_size = (unsigned int)min((unsigned long)target, m_size * 2UL);
+    } else {
+        m_size = target;
+    }
+}/*}}}*/
+
+} // namespace logkafka
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_BATCH_SIZER_H_
+#define LOGKAFKA_BATCH_SIZER_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+namespace logkafka {
+
+/* Pick the number of lines sent at once from the lag of log file.
+ *
+ * While the producer accepts whole batches, the size grows (doubling at
+ * most) towards the number of lines behind, so that catching up uses large
+ * batches and live tailing small ones. It is halved when some lines are
+ * rejected, e.g. the queue of producer is full. The size always stays in
+ * [min_size, max_size], equal bounds give a fixed batch size.
+ * */
+class BatchSizer
+{
+    public:
+        BatchSizer();
+        void init(unsigned int size,
+                unsigned int min_size,
+                unsigned int max_size);
+
+        /* lines and bytes of the batch just sent, and the bytes still
+         * behind after it */
+        void update(size_t lines, size_t bytes, off_t lag, bool accepted);
+
+        unsigned int getSize() const { return m_size; };
+        unsigned int getMaxSize() const { return m_max_size; };
+        size_t getAvgLineBytes() const { return m_avg_line_bytes; };
+
+    private:
+        unsigned int m_size;
+        unsigned int m_min_size;
+        unsigned int m_max_size;
+        size_t m_avg_line_bytes;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_BATCH_SIZER_H_
@@ -36,6 +36,14 @@
 
 #define DEFAULT_LINE_MAX_BYTES 1048576UL /* 1MB */
 #define DEFAULT_READ_MAX_BYTES 1048576UL /* 1MB */
+#define DEFAULT_MMAP_MIN_BYTES 268435456UL /* 256MB */
+#define DEFAULT_DIRECT_IO_MIN_BYTES 0UL
+#define DEFAULT_PAGECACHE_DONTNEED cfg_true
+#define DEFAULT_IO_ENGINE "sync"
+#define DEFAULT_IO_URING_ENTRIES 4096UL
+#define DEFAULT_FILTER_THREADS 0UL
+#define DEFAULT_FILTER_QUEUE_SIZE 4096UL
+#define DEFAULT_DELIVERY_INFLIGHT_MAX_BYTES 16777216UL /* 16MB */
 #define DEFAULT_KEY_MAX_BYTES 1024UL /* 1KB */
 #define DEFAULT_STAT_SILENT_MAX_MS 10000UL /* milliseconds */
 #define DEFAULT_BATCHSIZE 100U
@@ -44,14 +52,17 @@
 #define DEFAULT_LOGKAFKA_ID ""
 #define DEFAULT_ZOOKEEPER_UPLOAD_INTERVAL 10000UL /* milliseconds */
 #define DEFAULT_REFRESH_INTERVAL 60000UL /* milliseconds */
-#define DEFAULT_MESSAGE_SEND_MAX_RETRIES 10000UL
+#define DEFAULT_MESSAGE_SEND_MAX_RETRIES 10UL
 #define DEFAULT_QUEUE_BUFFERING_MAX_MESSAGES 10000UL
+#define DEFAULT_QUEUE_HIGH_WATERMARK_BYTES 67108864UL /* 64MB */
+#define DEFAULT_QUEUE_LOW_WATERMARK_BYTES 33554432UL /* 32MB */
 #define DEFAULT_PATH_QUEUE_MAX_SIZE 100
 #define DEFAULT_RDKAFKA_POLL_TIMEOUT 100 /* milliseconds */
 
 #define HARD_LIMIT_LINE_MAX_BYTES 1073741824UL /* 1GB */
 #define HARD_LIMIT_READ_MAX_BYTES 1073741824UL /* 1GB */
 #define HARD_LIMIT_KEY_MAX_BYTES 10240UL /* 10KB */
+#define HARD_LIMIT_FILTER_THREADS 256UL
 #define HARD_LIMIT_ZOOKEEPER_UPLOAD_INTERVAL 60000UL /* milliseconds */
 
 #define FILEPOS_END -1       /* read from file end*/
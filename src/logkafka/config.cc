@@ -36,6 +36,15 @@ namespace logkafka {
 
 Config::Config()
 {/*{{{*/
+    /* producer.pool <name> { ... }, the limits not set are the global ones */
+    cfg_opt_t producer_pool_opts[] =
+    {
+        CFG_INT("queue.buffering.max.messages", 0, CFGF_NODEFAULT),
+        CFG_INT("queue.high.watermark.bytes", 0, CFGF_NODEFAULT),
+        CFG_INT("queue.low.watermark.bytes", 0, CFGF_NODEFAULT),
+        CFG_END()
+    };
+
     cfg_opt_t opts[] =
     {
         CFG_STR("zookeeper.connect", DEFAULT_ZOOKEEPER_CONNECT, CFGF_NONE),
@@ -43,6 +52,15 @@ Config::Config()
         CFG_STR("logkafka.id", DEFAULT_LOGKAFKA_ID, CFGF_NONE),
         CFG_INT("line.max.bytes", DEFAULT_LINE_MAX_BYTES, CFGF_NONE),
         CFG_INT("read.max.bytes", DEFAULT_READ_MAX_BYTES, CFGF_NONE),
+        CFG_INT("mmap.min.bytes", DEFAULT_MMAP_MIN_BYTES, CFGF_NONE),
+        CFG_INT("direct.io.min.bytes", DEFAULT_DIRECT_IO_MIN_BYTES, CFGF_NONE),
+        CFG_BOOL("pagecache.dontneed", DEFAULT_PAGECACHE_DONTNEED, CFGF_NONE),
+        CFG_STR("io.engine", DEFAULT_IO_ENGINE, CFGF_NONE),
+        CFG_INT("io.uring.entries", DEFAULT_IO_URING_ENTRIES, CFGF_NONE),
+        CFG_INT("filter.threads", DEFAULT_FILTER_THREADS, CFGF_NONE),
+        CFG_INT("filter.queue.size", DEFAULT_FILTER_QUEUE_SIZE, CFGF_NONE),
+        CFG_INT("delivery.inflight.max.bytes", DEFAULT_DELIVERY_INFLIGHT_MAX_BYTES,
+                CFGF_NONE),
         CFG_INT("key.max.bytes", DEFAULT_KEY_MAX_BYTES, CFGF_NONE),
         CFG_INT("stat.silent.max.ms", DEFAULT_STAT_SILENT_MAX_MS, CFGF_NONE),
         CFG_INT("zookeeper.upload.interval", DEFAULT_ZOOKEEPER_UPLOAD_INTERVAL,
@@ -53,6 +71,11 @@ Config::Config()
                 CFGF_NONE),
         CFG_INT("queue.buffering.max.messages", DEFAULT_QUEUE_BUFFERING_MAX_MESSAGES,
                 CFGF_NONE),
+        CFG_INT("queue.high.watermark.bytes", DEFAULT_QUEUE_HIGH_WATERMARK_BYTES,
+                CFGF_NONE),
+        CFG_INT("queue.low.watermark.bytes", DEFAULT_QUEUE_LOW_WATERMARK_BYTES,
+                CFGF_NONE),
+        CFG_SEC("producer.pool", producer_pool_opts, CFGF_MULTI | CFGF_TITLE),
         CFG_END()
     };
 
@@ -98,6 +121,22 @@ bool Config::init(const char* filepath)
     PRINT_VAR(line_max_bytes);
     read_max_bytes = cfg_getint(m_cfg, "read.max.bytes");
     PRINT_VAR(read_max_bytes);
+    mmap_min_bytes = cfg_getint(m_cfg, "mmap.min.bytes");
+    PRINT_VAR(mmap_min_bytes);
+    direct_io_min_bytes = cfg_getint(m_cfg, "direct.io.min.bytes");
+    PRINT_VAR(direct_io_min_bytes);
+    pagecache_dontneed = cfg_getbool(m_cfg, "pagecache.dontneed");
+    PRINT_VAR(pagecache_dontneed);
+    io_engine = cfg_getstr(m_cfg, "io.engine");
+    PRINT_VAR(io_engine);
+    io_uring_entries = cfg_getint(m_cfg, "io.uring.entries");
+    PRINT_VAR(io_uring_entries);
+    filter_threads = cfg_getint(m_cfg, "filter.threads");
+    PRINT_VAR(filter_threads);
+    filter_queue_size = cfg_getint(m_cfg, "filter.queue.size");
+    PRINT_VAR(filter_queue_size);
+    delivery_inflight_max_bytes = cfg_getint(m_cfg, "delivery.inflight.max.bytes");
+    PRINT_VAR(delivery_inflight_max_bytes);
     key_max_bytes = cfg_getint(m_cfg, "key.max.bytes");
     PRINT_VAR(key_max_bytes);
     stat_silent_max_ms = cfg_getint(m_cfg, "stat.silent.max.ms"); 
@@ -112,6 +151,38 @@ bool Config::init(const char* filepath)
     PRINT_VAR(message_send_max_retries);
     queue_buffering_max_messages = cfg_getint(m_cfg, "queue.buffering.max.messages"); 
     PRINT_VAR(queue_buffering_max_messages);
+    queue_high_watermark_bytes = cfg_getint(m_cfg, "queue.high.watermark.bytes");
+    PRINT_VAR(queue_high_watermark_bytes);
+    queue_low_watermark_bytes = cfg_getint(m_cfg, "queue.low.watermark.bytes");
+    PRINT_VAR(queue_low_watermark_bytes);
+
+    for (unsigned int i = 0; i < cfg_size(m_cfg, "producer.pool"); ++i) {
+        cfg_t *pool_cfg = cfg_getnsec(m_cfg, "producer.pool", i);
+        string name = cfg_title(pool_cfg);
+
+        ProducerPoolConf pool;
+        pool.queue_buffering_max_messages = 
+            0 != cfg_size(pool_cfg, "queue.buffering.max.messages")?
+            cfg_getint(pool_cfg, "queue.buffering.max.messages"):
+            queue_buffering_max_messages;
+        pool.queue_high_watermark_bytes = 
+            0 != cfg_size(pool_cfg, "queue.high.watermark.bytes")?
+            cfg_getint(pool_cfg, "queue.high.watermark.bytes"):
+            queue_high_watermark_bytes;
+        pool.queue_low_watermark_bytes = 
+            0 != cfg_size(pool_cfg, "queue.low.watermark.bytes")?
+            cfg_getint(pool_cfg, "queue.low.watermark.bytes"):
+            queue_low_watermark_bytes;
+        producer_pools[name] = pool;
+
+        LINFO << "producer pool " << name
+              << ", queue_buffering_max_messages " 
+              << pool.queue_buffering_max_messages
+              << ", queue_high_watermark_bytes "
+              << pool.queue_high_watermark_bytes
+              << ", queue_low_watermark_bytes "
+              << pool.queue_low_watermark_bytes;
+    }
 
     size_t first_slash = zookeeper_connect.find_first_of("/", 0);
     zookeeper_urls = zookeeper_connect.substr(0, first_slash);
@@ -155,12 +226,45 @@ bool Config::init(const char* filepath)
         return false;
     }
 
+    if (io_engine != "sync" && io_engine != "uring") {
+        fprintf(stderr, "The io_engine %s is not valid!\n",
+                io_engine.c_str());
+        return false;
+    }
+
+    if (filter_threads > HARD_LIMIT_FILTER_THREADS) {
+        fprintf(stderr, "The filter_threads %lu exceeds hard limit %lu!\n",
+                filter_threads, HARD_LIMIT_FILTER_THREADS);
+        return false;
+    }
+
+    if (0 != filter_threads && 0 == filter_queue_size) {
+        fprintf(stderr, "The filter_queue_size %lu is not valid!\n",
+                filter_queue_size);
+        return false;
+    }
+
     if (!TailWatcher::isStateSilentMaxMsValid(stat_silent_max_ms)) {
         fprintf(stderr, "The stat_silent_max_ms %lu is not valid!\n",
                 stat_silent_max_ms);
         return false;
     }
 
+    map<string, ProducerPoolConf>::const_iterator iter;
+    for (iter = producer_pools.begin(); iter != producer_pools.end(); ++iter) {
+        if ("" == iter->first || "shared" == iter->first || "topic" == iter->first) {
+            fprintf(stderr, "The producer pool name \"%s\" is reserved!\n",
+                    iter->first.c_str());
+            return false;
+        }
+
+        if (0 == iter->second.queue_buffering_max_messages) {
+            fprintf(stderr, "The queue_buffering_max_messages of producer pool %s is not valid!\n",
+                    iter->first.c_str());
+            return false;
+        }
+    }
+
     if (zookeeper_upload_interval > HARD_LIMIT_ZOOKEEPER_UPLOAD_INTERVAL) {
         fprintf(stderr, "The zookeeper_upload_interval %lu exceeds hard limit %lu!\n",
                 zookeeper_upload_interval, HARD_LIMIT_ZOOKEEPER_UPLOAD_INTERVAL);
@@ -42,6 +42,13 @@ namespace logkafka {
 
 #define PRINT_VAR(name) Config::print(#name, (name))
 
+/* the queue limits of a named producer pool, the global ones by default */
+struct ProducerPoolConf {
+    unsigned long queue_buffering_max_messages;
+    unsigned long queue_high_watermark_bytes;
+    unsigned long queue_low_watermark_bytes;
+};
+
 class Config {
     public:
         Config();
@@ -59,6 +66,14 @@ class Config {
         string logkafka_id;
         unsigned long line_max_bytes;
         unsigned long read_max_bytes;
+        unsigned long mmap_min_bytes;
+        unsigned long direct_io_min_bytes;
+        bool pagecache_dontneed;
+        string io_engine;
+        unsigned long io_uring_entries;
+        unsigned long filter_threads;
+        unsigned long filter_queue_size;
+        unsigned long delivery_inflight_max_bytes;
         unsigned long key_max_bytes;
         unsigned long zookeeper_upload_interval;
         unsigned long refresh_interval;
@@ -66,6 +81,9 @@ class Config {
         unsigned long path_queue_max_size;
         unsigned long message_send_max_retries;
         unsigned long queue_buffering_max_messages;
+        unsigned long queue_high_watermark_bytes;
+        unsigned long queue_low_watermark_bytes;
+        map<string, ProducerPoolConf> producer_pools;
 
     private:
         Config(const Config &config);
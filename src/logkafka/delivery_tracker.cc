@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/delivery_tracker.h"
+
+#include "easylogging/easylogging++.h"
+
+namespace logkafka {
+
+DeliveryBatch::DeliveryBatch(DeliveryTracker *tracker, uint64_t seq,
+        off_t start_pos)
+{/*{{{*/
+    m_tracker = tracker;
+    m_tracker->ref();
+    m_seq = seq;
+    m_start_pos = start_pos;
+    m_bytes = 0;
+    m_failed = false;
+}/*}}}*/
+
+DeliveryBatch::~DeliveryBatch()
+{/*{{{*/
+}/*}}}*/
+
+void DeliveryBatch::hold(RefCounted *owner)
+{/*{{{*/
+    /* the lines of a batch mostly share a few owners */
+    if (NULL == owner || (!m_owners.empty() && m_owners.back() == owner)) {
+        return;
+    }
+
+    owner->ref();
+    m_owners.push_back(owner);
+}/*}}}*/
+
+void DeliveryBatch::release()
+{/*{{{*/
+    for (size_t i = 0; i < m_owners.size(); ++i) {
+        m_owners[i]->unref();
+    }
+    m_owners.clear();
+
+    m_tracker->complete(this);
+    m_tracker->unref();
+
+    delete this;
+}/*}}}*/
+
+DeliveryTracker::DeliveryTracker()
+{/*{{{*/
+    m_position_entry = NULL;
+    m_commit_arg = NULL;
+    m_commit_func = NULL;
+    m_max_inflight_bytes = 0;
+    m_inflight_bytes = 0;
+    m_commit_pos = 0;
+    m_end_pos = 0;
+    m_rewind = false;
+    m_base_seq = 0;
+    m_next_seq = 0;
+    m_current = NULL;
+}/*}}}*/
+
+DeliveryTracker::~DeliveryTracker()
+{/*{{{*/
+}/*}}}*/
+
+bool DeliveryTracker::init(PositionEntry *position_entry, off_t pos,
+        unsigned long max_inflight_bytes)
+{/*{{{*/
+    m_position_entry = position_entry;
+    m_commit_pos = pos;
+    m_end_pos = pos;
+    m_max_inflight_bytes = max_inflight_bytes;
+
+    return true;
+}/*}}}*/
+
+void DeliveryTracker::close()
+{/*{{{*/
+    /* the batches in flight complete as abandoned ones */
+    m_position_entry = NULL;
+    m_commit_arg = NULL;
+    m_commit_func = NULL;
+    m_ranges.clear();
+    m_base_seq = m_next_seq;
+    m_rewind = false;
+}/*}}}*/
+
+void DeliveryTracker::setCommitCallback(void *arg, CommitFunc func)
+{/*{{{*/
+    m_commit_arg = arg;
+    m_commit_func = func;
+}/*}}}*/
+
+DeliveryBatch *DeliveryTracker::begin()
+{/*{{{*/
+    m_current = new DeliveryBatch(this, m_next_seq++, m_end_pos);
+    return m_current;
+}/*}}}*/
+
+void DeliveryTracker::end(off_t pos, size_t bytes)
+{/*{{{*/
+    DeliveryBatch *batch = m_current;
+    m_current = NULL;
+
+    if (NULL == m_position_entry || m_rewind) {
+        /* nothing is tracked until the reader rewinds, the batch is
+         * abandoned (there is no range then) */
+        m_base_seq = m_next_seq;
+    } else if (batch->m_seq >= m_base_seq) {
+        Range range = {max(m_end_pos, pos), false, false};
+        m_ranges.push_back(range);
+        m_end_pos = range.end;
+    }
+    /* otherwise a rewind is found during the send, the batch is
+     * abandoned as it is read again anyway */
+
+    batch->m_bytes = bytes;
+    m_inflight_bytes += bytes;
+
+    /* completed here if no message is queued */
+    batch->unref();
+}/*}}}*/
+
+void DeliveryTracker::skip(off_t pos)
+{/*{{{*/
+    begin();
+    end(pos, 0);
+}/*}}}*/
+
+bool DeliveryTracker::isFull() const
+{/*{{{*/
+    return m_inflight_bytes >= m_max_inflight_bytes;
+}/*}}}*/
+
+bool DeliveryTracker::needRewind(off_t &pos) const
+{/*{{{*/
+    pos = m_commit_pos;
+    return m_rewind;
+}/*}}}*/
+
+void DeliveryTracker::rewind()
+{/*{{{*/
+    m_end_pos = m_commit_pos;
+    m_rewind = false;
+}/*}}}*/
+
+void DeliveryTracker::complete(DeliveryBatch *batch)
+{/*{{{*/
+    m_inflight_bytes -= batch->m_bytes;
+
+    if (batch->m_seq < m_base_seq) {
+        return;
+    }
+
+    Range &range = m_ranges[batch->m_seq - m_base_seq];
+    range.done = true;
+    range.failed = batch->m_failed;
+
+    commit();
+}/*}}}*/
+
+void DeliveryTracker::commit()
+{/*{{{*/
+    off_t pos = m_commit_pos;
+
+    while (!m_ranges.empty() && m_ranges.front().done) {
+        if (m_ranges.front().failed) {
+            LWARNING << "Fail to deliver lines after offset " << m_commit_pos
+                     << ", read them again";
+            /* the batches after it are abandoned */
+            m_ranges.clear();
+            m_base_seq = m_next_seq;
+            m_rewind = true;
+            break;
+        }
+
+        m_commit_pos = m_ranges.front().end;
+        m_ranges.pop_front();
+        ++m_base_seq;
+    }
+
+    if (m_commit_pos != pos) {
+        m_position_entry->updatePos(m_commit_pos);
+        if (NULL != m_commit_func) {
+            (*m_commit_func)(m_commit_arg, m_commit_pos);
+        }
+    }
+}/*}}}*/
+
+} // namespace logkafka
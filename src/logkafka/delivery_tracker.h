@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_DELIVERY_TRACKER_H_
+#define LOGKAFKA_DELIVERY_TRACKER_H_
+
+#include <sys/types.h>
+
+#include <deque>
+#include <vector>
+
+#include "base/common.h"
+#include "base/ref_counted.h"
+#include "logkafka/position_entry.h"
+
+using namespace std;
+using namespace base;
+
+namespace logkafka {
+
+class DeliveryTracker;
+
+/* called with the position once it is committed */
+typedef void (*CommitFunc)(void *arg, off_t pos);
+
+/* The messages of one line batch of a file. Each queued message holds
+ * one reference, the owners of the lines are held by the batch until
+ * the last message is delivered, then the batch reports to its tracker.
+ * */
+class DeliveryBatch: public RefCounted
+{
+    public:
+        DeliveryBatch(DeliveryTracker *tracker, uint64_t seq, off_t start_pos);
+
+        /* keep the owner of a queued message, for librdkafka */
+        void hold(RefCounted *owner);
+        /* the message is lost, the range of the batch is read again */
+        void fail() { m_failed = true; };
+        /* the file offset the lines of the batch start from */
+        off_t getStartPos() const { return m_start_pos; };
+
+    protected:
+        virtual ~DeliveryBatch();
+        virtual void release();
+
+    private:
+        friend class DeliveryTracker;
+        DeliveryTracker *m_tracker;
+        uint64_t m_seq;
+        off_t m_start_pos;
+        size_t m_bytes;
+        volatile bool m_failed;
+        vector<RefCounted *> m_owners;
+};
+
+/* Commits the position of one file once its lines are delivered.
+ *
+ * The batches of a file are sent in order, each one covers the file
+ * range from the end of the batch before it to its own end offset. The
+ * position advances to the end of the last batch of the delivered
+ * prefix, so a crash or a lost message never skips undelivered lines.
+ * If a batch fails, the batches after it are abandoned and the file is
+ * read again from the committed position, some lines may be sent twice.
+ *
+ * The bytes of undelivered batches are counted, the reader stops once
+ * they reach the max in-flight bytes.
+ *
+ * NOTE: not thread-safe, the batches must be delivered on the thread
+ * which sends them, i.e. librdkafka is polled by the loop.
+ * */
+class DeliveryTracker: public RefCounted
+{
+    public:
+        DeliveryTracker();
+
+        bool init(PositionEntry *position_entry, off_t pos,
+                unsigned long max_inflight_bytes);
+        /* the position is no longer committed, e.g. the file is left */
+        void close();
+        /* NULL func for none, it is cleared on close */
+        void setCommitCallback(void *arg, CommitFunc func);
+
+        /* Begin the batch of the lines to send, the tracker keeps the
+         * returned reference until end, the caller must not unref it.
+         * */
+        DeliveryBatch *begin();
+        /* The batch covers the file up to pos, -1 if nothing of it has
+         * been queued. */
+        void end(off_t pos, size_t bytes);
+        /* advance to pos once the batches before it are delivered */
+        void skip(off_t pos);
+
+        bool isFull() const;
+        /* return true if the file should be read again from pos */
+        bool needRewind(off_t &pos) const;
+        void rewind();
+
+        off_t getCommitPos() const { return m_commit_pos; };
+        size_t getInflightBytes() const { return m_inflight_bytes; };
+
+    protected:
+        virtual ~DeliveryTracker();
+
+    private:
+        friend class DeliveryBatch;
+        void complete(DeliveryBatch *batch);
+        void commit();
+
+    private:
+        struct Range
+        {
+            off_t end;
+            bool done;
+            bool failed;
+        };
+
+        PositionEntry *m_position_entry;
+        void *m_commit_arg;
+        CommitFunc m_commit_func;
+        unsigned long m_max_inflight_bytes;
+        size_t m_inflight_bytes;
+
+        /* the position committed, and the end of the last range */
+        off_t m_commit_pos;
+        off_t m_end_pos;
+        bool m_rewind;
+
+        /* m_ranges[i] is the range of batch m_base_seq + i */
+        deque<Range> m_ranges;
+        uint64_t m_base_seq;
+        uint64_t m_next_seq;
+        DeliveryBatch *m_current;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_DELIVERY_TRACKER_H_
@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/envelope.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "base/tools.h"
+
+namespace logkafka {
+
+const size_t Envelope::ARENA_BYTES = 256 * 1024;
+const size_t Envelope::ARENA_MAX_FREE = 16;
+
+/* the longest off_t in decimal */
+static const size_t OFFSET_MAX_DIGITS = 20;
+
+Envelope::Envelope()
+{/*{{{*/
+    m_json = false;
+    m_has_offset = false;
+    m_pool = NULL;
+}/*}}}*/
+
+Envelope::~Envelope()
+{/*{{{*/
+    /* the pool is freed after the arenas in flight come back */
+    if (NULL != m_pool) {
+        m_pool->unref();
+        m_pool = NULL;
+    }
+}/*}}}*/
+
+size_t Envelope::escapeJson(const char *data, size_t len, char *out)
+{/*{{{*/
+    static const char hex[] = "0123456789abcdef";
+    char *p = out;
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = data[i];
+        if (c >= 0x20 && '"' != c && '\\' != c) {
+            *p++ = c;
+            continue;
+        }
+
+        *p++ = '\\';
+        switch (c) {
+            case '"': *p++ = '"'; break;
+            case '\\': *p++ = '\\'; break;
+            case '\b': *p++ = 'b'; break;
+            case '\f': *p++ = 'f'; break;
+            case '\n': *p++ = 'n'; break;
+            case '\r': *p++ = 'r'; break;
+            case '\t': *p++ = 't'; break;
+            default:
+                *p++ = 'u';
+                *p++ = '0';
+                *p++ = '0';
+                *p++ = hex[c >> 4];
+                *p++ = hex[c & 0xf];
+                break;
+        }
+    }
+
+    return p - out;
+}/*}}}*/
+
+void Envelope::addField(const string &name, const string &value, bool quoted)
+{/*{{{*/
+    string &part = m_has_offset? m_middle: m_head;
+
+    if (m_json) {
+        part += "\"" + name + "\":";
+        if (quoted) {
+            string escaped(value.length() * 6, '\0');
+            escaped.resize(escapeJson(value.data(), value.length(), &escaped[0]));
+            part += "\"" + escaped + "\"";
+        } else {
+            part += value;
+        }
+        part += ",";
+    } else {
+        part += value + m_delimiter;
+    }
+}/*}}}*/
+
+bool Envelope::init(const EnvelopeConf &conf,
+        const string &hostname,
+        const string &logkafka_id,
+        const string &path,
+        ino_t inode)
+{/*{{{*/
+    if (conf.format == "") {
+        LINFO << "Envelope format is not set";
+        return false;
+    }
+
+    if (!EnvelopeConf::isFormatValid(conf.format)) {
+        LERROR << "Envelope format " << conf.format << " is unknown";
+        return false;
+    }
+
+    m_json = "json" == conf.format;
+    m_delimiter = conf.delimiter;
+    m_head = m_json? "{": "";
+    m_has_offset = false;
+    m_middle = "";
+
+    vector<string> fields = conf.fields;
+    if (fields.empty()) {
+        fields.push_back("hostname");
+        fields.push_back("logkafka_id");
+        fields.push_back("path");
+        fields.push_back("inode");
+        fields.push_back("offset");
+    }
+
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const string &field = fields[i];
+        if ("hostname" == field) {
+            addField(field, hostname, true);
+        } else if ("logkafka_id" == field) {
+            addField(field, logkafka_id, true);
+        } else if ("path" == field) {
+            addField(field, path, true);
+        } else if ("inode" == field) {
+            addField(field, int2Str(inode), false);
+        } else if ("offset" == field && !m_has_offset) {
+            /* the only field differing per line */
+            if (m_json) m_head += "\"offset\":";
+            m_has_offset = true;
+            if (m_json) {
+                m_middle = ",";
+            } else {
+                m_middle = m_delimiter;
+            }
+        } else {
+            LERROR << "Envelope field " << field << " is unknown";
+            return false;
+        }
+    }
+
+    if (m_json) {
+        (m_has_offset? m_middle: m_head) += "\"message\":\"";
+        m_tail = "\"}";
+    } else {
+        m_tail = "";
+    }
+
+    if (NULL == m_pool) {
+        m_pool = base::ArenaPool::create(ARENA_BYTES, ARENA_MAX_FREE);
+    }
+
+    return true;
+}/*}}}*/
+
+size_t Envelope::getBound(size_t len) const
+{/*{{{*/
+    return m_head.length() + OFFSET_MAX_DIGITS + m_middle.length()
+        + (m_json? len * 6: len) + m_tail.length();
+}/*}}}*/
+
+size_t Envelope::write(const LineSlice &line, char *out) const
+{/*{{{*/
+    char *p = out;
+
+    memcpy(p, m_head.data(), m_head.length());
+    p += m_head.length();
+
+    if (m_has_offset) {
+        p += snprintf(p, OFFSET_MAX_DIGITS + 1, "%lld", (long long)line.offset());
+    }
+
+    memcpy(p, m_middle.data(), m_middle.length());
+    p += m_middle.length();
+
+    if (m_json) {
+        p += escapeJson(line.data(), line.length(), p);
+    } else {
+        memcpy(p, line.data(), line.length());
+        p += line.length();
+    }
+
+    memcpy(p, m_tail.data(), m_tail.length());
+    p += m_tail.length();
+
+    return p - out;
+}/*}}}*/
+
+bool Envelope::wrap(const vector<LineSlice> &lines, vector<LineSlice> &envelopes)
+{/*{{{*/
+    envelopes.clear();
+    envelopes.reserve(lines.size());
+
+    base::ArenaPool::Arena *arena = NULL;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        size_t bound = getBound(lines[i].length());
+        char *out = NULL == arena? NULL: arena->reserve(bound);
+
+        /* the envelopes keep the full arena alive */
+        if (NULL == out) {
+            if (NULL != arena) arena->unref();
+            arena = m_pool->acquire(bound);
+            if (NULL == arena) {
+                LERROR << "Fail to acquire arena of " << bound << " bytes";
+                envelopes.clear();
+                return false;
+            }
+            out = arena->reserve(bound);
+        }
+
+        size_t len = write(lines[i], out);
+        arena->commit(len);
+        envelopes.push_back(LineSlice(out, len, arena, lines[i].offset()));
+    }
+
+    if (NULL != arena) arena->unref();
+
+    return true;
+}/*}}}*/
+
+} // namespace logkafka
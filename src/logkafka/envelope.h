@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_ENVELOPE_H_
+#define LOGKAFKA_ENVELOPE_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "base/arena.h"
+#include "base/noncopyable.h"
+#include "logkafka/line_slice.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Wrap each line with the fields of where it comes from, hostname,
+ * logkafka_id, path, inode and offset, into a json object
+ *
+ *   {"hostname":"h","path":"/a.log","offset":42,"message":"line"}
+ *
+ * with the line escaped, or into a prefix of the fields and the line
+ * separated by the delimiter
+ *
+ *   h<TAB>/a.log<TAB>42<TAB>line
+ *
+ * The envelopes of a batch are written into one arena, which goes back
+ * to the pool after all of them are delivered, nothing is allocated per
+ * line. The fields but the offset are formatted once. Not thread-safe.
+ * */
+class Envelope : base::noncopyable
+{
+    public:
+        Envelope();
+        ~Envelope();
+
+        /* all the fields are used if conf.fields is empty */
+        bool init(const EnvelopeConf &conf,
+                const string &hostname,
+                const string &logkafka_id,
+                const string &path,
+                ino_t inode);
+        bool isEnabled() const { return NULL != m_pool; };
+
+        /* envelopes[i] is the envelope of lines[i], with its offset */
+        bool wrap(const vector<LineSlice> &lines, vector<LineSlice> &envelopes);
+
+        const base::ArenaPool *getPool() const { return m_pool; };
+
+        /* the escaped data is written to out, which has room for
+         * 6 * len bytes, the length written is returned */
+        static size_t escapeJson(const char *data, size_t len, char *out);
+
+    private:
+        size_t getBound(size_t len) const;
+        size_t write(const LineSlice &line, char *out) const;
+        void addField(const string &name, const string &value, bool quoted);
+
+    private:
+        bool m_json;
+        string m_delimiter;
+
+        /* the envelope is m_head, the offset if m_has_offset,
+         * m_middle, the line and m_tail */
+        string m_head;
+        bool m_has_offset;
+        string m_middle;
+        string m_tail;
+
+        base::ArenaPool *m_pool;
+
+        static const size_t ARENA_BYTES;
+        static const size_t ARENA_MAX_FREE;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_ENVELOPE_H_
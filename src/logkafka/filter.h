@@ -23,21 +23,56 @@
 #define LOGKAFKA_FILTER_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "logkafka/line_slice.h"
+
 using namespace std;
 
 namespace logkafka {
 
+/* named counters of filter, reported in collecting state */
+typedef vector<pair<string, unsigned long> > FilterStats;
+
 class Filter
 {
     public:
         Filter() {};
         virtual ~Filter() {};
         virtual bool init(void *arg) = 0;
-        virtual bool filter(void *arg, vector<string> &lines) = 0;
+        /* Drop lines in place, the order of kept lines is preserved.
+         * Return false if a stage fails, the lines it could not judge
+         * are kept, the other stages of the filter still apply and the
+         * lines left are sent. */
+        virtual bool filter(void *arg, vector<LineSlice> &lines) = 0;
+        /* NOTE: filter may run on a thread of FilterPool while the
+         * loop thread reads the counters, they are updated with
+         * __atomic_add_fetch and read with __atomic_load_n */
+        virtual void getStats(FilterStats &stats) const {};
 };
 
+/* keep(i, line) decides on the i-th line, the kept lines are moved
+ * forward over the dropped ones in one pass, no line is moved twice,
+ * returns the number of dropped lines */
+template <typename Keep>
+size_t compactLines(vector<LineSlice> &lines, Keep keep)
+{/*{{{*/
+    size_t count = lines.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!keep(i, lines[i])) continue;
+
+        if (kept != i) {
+            lines[kept] = std::move(lines[i]);
+        }
+        ++kept;
+    }
+    lines.erase(lines.begin() + kept, lines.end());
+
+    return count - kept;
+}/*}}}*/
+
 } // namespace logkafka
 
 #endif // LOGKAFKA_FILTER_H_
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_chain.h"
+
+#include <time.h>
+
+namespace logkafka {
+
+static unsigned long getMonotonicNs()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}/*}}}*/
+
+FilterChain::~FilterChain()
+{/*{{{*/
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        delete m_stages[i].regex_set;
+    }
+    m_stages.clear();
+}/*}}}*/
+
+bool FilterChain::addStage(bool include, const vector<string> &patterns)
+{/*{{{*/
+    Stage stage;
+    stage.include = include;
+    stage.regex_set = NULL;
+    stage.lines_in = 0;
+    stage.lines_out = 0;
+    stage.ns = 0;
+
+    if (!patterns.empty()) {
+        stage.regex_set = new RegexSet();
+        if (!stage.regex_set->init(patterns)) {
+            delete stage.regex_set;
+            return false;
+        }
+    }
+
+    m_stages.push_back(stage);
+    return true;
+}/*}}}*/
+
+bool FilterChain::init(void *arg)
+{/*{{{*/
+    vector<string> patterns;
+    if (m_filter_conf.regex_filter_pattern != "") {
+        patterns.push_back(m_filter_conf.regex_filter_pattern);
+    }
+    patterns.insert(patterns.end(),
+            m_filter_conf.regex_filter_patterns.begin(),
+            m_filter_conf.regex_filter_patterns.end());
+
+    if (!patterns.empty() && !addStage(false, patterns)) {
+        LERROR << "Fail to add exclude stage of regex filter patterns";
+        return false;
+    }
+
+    const vector<FilterStageConf> &stages = m_filter_conf.stages;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        if (!addStage(stages[i].include, stages[i].patterns)) {
+            LERROR << "Fail to add filter stage " << i;
+            return false;
+        }
+    }
+
+    if (m_stages.empty()) {
+        LINFO << "Filter stages are not set";
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+void FilterChain::runStage(Stage &stage, const vector<LineSlice> &lines)
+{/*{{{*/
+    unsigned long start = getMonotonicNs();
+
+    size_t left = 0;
+    for (size_t k = 0; k < m_undecided.size(); ++k) {
+        size_t i = m_undecided[k];
+        const LineSlice &line = lines[i];
+        if (NULL == stage.regex_set ||
+                -1 != stage.regex_set->match(line.data(), line.length())) {
+            m_dropped[i] = !stage.include;
+        } else {
+            m_undecided[left++] = i;
+        }
+    }
+
+    __atomic_add_fetch(&stage.lines_in, m_undecided.size(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stage.lines_out, left, __ATOMIC_RELAXED);
+    m_undecided.resize(left);
+
+    __atomic_add_fetch(&stage.ns, getMonotonicNs() - start, __ATOMIC_RELAXED);
+}/*}}}*/
+
+bool FilterChain::filter(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    FilterChain *fc = reinterpret_cast<FilterChain *>(arg);
+
+    if (NULL == fc) {
+        LERROR << "Filter chain is NULL";
+        return false;
+    }
+
+    fc->m_undecided.resize(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        fc->m_undecided[i] = i;
+    }
+    fc->m_dropped.assign(lines.size(), 0);
+
+    /* a decided line is not seen by the later stages */
+    for (size_t i = 0; i < fc->m_stages.size(); ++i) {
+        if (fc->m_undecided.empty()) break;
+        fc->runStage(fc->m_stages[i], lines);
+    }
+
+    compactLines(lines, [fc](size_t i, LineSlice &line) {
+        if (fc->m_dropped[i]) {
+            LDEBUG << "Filter chain drop line: " << line;
+            return false;
+        }
+        return true;
+    });
+
+    return true;
+}/*}}}*/
+
+void FilterChain::getStats(FilterStats &stats) const
+{/*{{{*/
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        const Stage &stage = m_stages[i];
+        string prefix = "stage." + int2Str(i) + "."
+            + (stage.include? "include": "exclude") + ".";
+        stats.push_back(make_pair(prefix + "in",
+                __atomic_load_n(&stage.lines_in, __ATOMIC_RELAXED)));
+        stats.push_back(make_pair(prefix + "out",
+                __atomic_load_n(&stage.lines_out, __ATOMIC_RELAXED)));
+        stats.push_back(make_pair(prefix + "ns",
+                __atomic_load_n(&stage.ns, __ATOMIC_RELAXED)));
+    }
+}/*}}}*/
+
+} // namespace logkafka
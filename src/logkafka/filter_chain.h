@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_CHAIN_H_
+#define LOGKAFKA_FILTER_CHAIN_H_
+
+#include <string>
+#include <vector>
+
+#include "logkafka/filter.h"
+#include "logkafka/regex_set.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Ordered include (keep) and exclude (drop) stages, the first stage
+ * matching a line decides, the lines matching no stage are kept.
+ * regex_filter_pattern and regex_filter_patterns, if set, form an
+ * exclude stage before the others.
+ *
+ * Each stage runs over the undecided lines of the whole batch at once,
+ * the lines in, the lines passed on and the nanoseconds spent are
+ * counted per stage.
+ * */
+class FilterChain: public virtual Filter
+{
+    public:
+        FilterChain(FilterConf filter_conf):
+            m_filter_conf(filter_conf) {};
+        virtual ~FilterChain();
+        bool init(void *arg);
+        bool filter(void *arg, vector<LineSlice> &lines);
+        void getStats(FilterStats &stats) const;
+
+    private:
+        struct Stage
+        {
+            bool include;
+            /* NULL matches every line */
+            RegexSet *regex_set;
+            unsigned long lines_in;
+            unsigned long lines_out;
+            unsigned long ns;
+        };
+
+        bool addStage(bool include, const vector<string> &patterns);
+        void runStage(Stage &stage, const vector<LineSlice> &lines);
+
+    private:
+        FilterConf m_filter_conf;
+        vector<Stage> m_stages;
+
+        /* indexes of the lines not decided yet */
+        vector<size_t> m_undecided;
+        vector<char> m_dropped;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_CHAIN_H_
@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_json.h"
+
+#include <string.h>
+
+#include "rapidjson/memorystream.h"
+
+using namespace rapidjson;
+
+namespace logkafka {
+
+struct FilterJson::Handler: public BaseReaderHandler<UTF8<>, FilterJson::Handler>
+{
+    FilterJson *fj;
+
+    Handler(FilterJson *filter_json): fj(filter_json) {};
+
+    bool Null() { return fj->onValue(kNullType, NULL, 0, 0); };
+    bool Bool(bool b) { return fj->onValue(b? kTrueType: kFalseType, NULL, 0, 0); };
+    bool Int(int i) { return fj->onValue(kNumberType, NULL, 0, i); };
+    bool Uint(unsigned u) { return fj->onValue(kNumberType, NULL, 0, u); };
+    bool Int64(int64_t i) { return fj->onValue(kNumberType, NULL, 0, (double)i); };
+    bool Uint64(uint64_t u) { return fj->onValue(kNumberType, NULL, 0, (double)u); };
+    bool Double(double d) { return fj->onValue(kNumberType, NULL, 0, d); };
+
+    bool String(const char *str, SizeType len, bool copy)
+    {/*{{{*/
+        return fj->onValue(kStringType, str, len, 0);
+    }/*}}}*/
+
+    bool Key(const char *str, SizeType len, bool copy)
+    {/*{{{*/
+        if (fj->m_array_depth > 0) return true;
+
+        fj->m_path.resize(fj->m_path_lens.back());
+        if (!fj->m_path.empty()) fj->m_path += '.';
+        fj->m_path.append(str, len);
+
+        return true;
+    }/*}}}*/
+
+    bool StartObject()
+    {/*{{{*/
+        if (fj->m_array_depth > 0) {
+            ++fj->m_array_depth;
+            return true;
+        }
+
+        if (fj->m_path_lens.empty()) {
+            fj->m_is_object = true;
+        } else if (!fj->onValue(kObjectType, NULL, 0, 0)) {
+            return false;
+        }
+
+        fj->m_path_lens.push_back(fj->m_path.length());
+        return true;
+    }/*}}}*/
+
+    bool EndObject(SizeType member_count)
+    {/*{{{*/
+        if (fj->m_array_depth > 0) {
+            --fj->m_array_depth;
+            return true;
+        }
+
+        fj->m_path.resize(fj->m_path_lens.back());
+        fj->m_path_lens.pop_back();
+        return true;
+    }/*}}}*/
+
+    bool StartArray()
+    {/*{{{*/
+        if (fj->m_array_depth > 0) {
+            ++fj->m_array_depth;
+            return true;
+        }
+
+        /* the root is not an object */
+        if (fj->m_path_lens.empty()) return false;
+
+        if (!fj->onValue(kArrayType, NULL, 0, 0)) return false;
+
+        fj->m_array_depth = 1;
+        return true;
+    }/*}}}*/
+
+    bool EndArray(SizeType element_count)
+    {/*{{{*/
+        --fj->m_array_depth;
+        return true;
+    }/*}}}*/
+};
+
+FilterJson::FilterJson(FilterConf filter_conf)
+{/*{{{*/
+    m_filter_conf = filter_conf;
+    m_inner = NULL;
+
+    m_array_depth = 0;
+    m_is_object = false;
+    m_unseen = 0;
+    m_failed = false;
+
+    m_lines_in = 0;
+    m_lines_dropped = 0;
+    m_lines_invalid = 0;
+}/*}}}*/
+
+FilterJson::~FilterJson()
+{/*{{{*/
+    delete m_inner; m_inner = NULL;
+}/*}}}*/
+
+bool FilterJson::addPredicate(const JsonPredicateConf &conf)
+{/*{{{*/
+    Predicate predicate;
+    predicate.field = conf.field;
+    predicate.seen = false;
+
+    if ("eq" == conf.op) {
+        predicate.op = OP_EQ;
+    } else if ("ne" == conf.op) {
+        predicate.op = OP_NE;
+    } else if ("in" == conf.op) {
+        predicate.op = OP_IN;
+    } else if ("exists" == conf.op) {
+        predicate.op = OP_EXISTS;
+    } else if ("lt" == conf.op) {
+        predicate.op = OP_LT;
+    } else if ("le" == conf.op) {
+        predicate.op = OP_LE;
+    } else if ("gt" == conf.op) {
+        predicate.op = OP_GT;
+    } else if ("ge" == conf.op) {
+        predicate.op = OP_GE;
+    } else {
+        LERROR << "Json predicate op " << conf.op << " is unknown";
+        return false;
+    }
+
+    for (size_t i = 0; i < conf.values.size(); ++i) {
+        Document d;
+        d.Parse(conf.values[i].c_str());
+        if (d.HasParseError() || d.IsObject() || d.IsArray()) {
+            LERROR << "Json predicate value " << conf.values[i]
+                   << " is not a json scalar";
+            return false;
+        }
+
+        Operand operand;
+        operand.type = d.GetType();
+        operand.num = d.IsNumber()? d.GetDouble(): 0;
+        if (d.IsString()) operand.str.assign(d.GetString(), d.GetStringLength());
+        predicate.operands.push_back(operand);
+    }
+
+    size_t operand_num = predicate.operands.size();
+    if ((OP_EXISTS == predicate.op && 0 != operand_num) ||
+            (OP_IN == predicate.op && 0 == operand_num) ||
+            (OP_EXISTS != predicate.op && OP_IN != predicate.op && 1 != operand_num)) {
+        LERROR << "Json predicate op " << conf.op << " has "
+               << operand_num << " values";
+        return false;
+    }
+
+    if (predicate.op >= OP_LT && kNumberType != predicate.operands[0].type) {
+        LERROR << "Json predicate op " << conf.op << " needs a number";
+        return false;
+    }
+
+    m_predicates.push_back(predicate);
+    return true;
+}/*}}}*/
+
+bool FilterJson::init(void *arg)
+{/*{{{*/
+    const vector<JsonPredicateConf> &predicates = m_filter_conf.json_predicates;
+    if (predicates.empty()) {
+        LINFO << "Json predicates are not set";
+        return false;
+    }
+
+    for (size_t i = 0; i < predicates.size(); ++i) {
+        if (!addPredicate(predicates[i])) {
+            LERROR << "Fail to add json predicate " << i;
+            m_predicates.clear();
+            return false;
+        }
+    }
+
+    m_inner = reinterpret_cast<Filter *>(arg);
+
+    return true;
+}/*}}}*/
+
+bool FilterJson::evaluate(const Predicate &predicate,
+        Type type, const char *str, size_t len, double num)
+{/*{{{*/
+    switch (predicate.op) {
+        case OP_EXISTS:
+            return true;
+        case OP_LT:
+            return kNumberType == type && num < predicate.operands[0].num;
+        case OP_LE:
+            return kNumberType == type && num <= predicate.operands[0].num;
+        case OP_GT:
+            return kNumberType == type && num > predicate.operands[0].num;
+        case OP_GE:
+            return kNumberType == type && num >= predicate.operands[0].num;
+        default:
+            break;
+    }
+
+    /* eq, ne and in */
+    bool equal = false;
+    for (size_t i = 0; i < predicate.operands.size() && !equal; ++i) {
+        const Operand &operand = predicate.operands[i];
+        if (operand.type != type) continue;
+
+        if (kStringType == type) {
+            equal = operand.str.length() == len &&
+                0 == memcmp(operand.str.data(), str, len);
+        } else if (kNumberType == type) {
+            equal = operand.num == num;
+        } else {
+            equal = true;
+        }
+    }
+
+    return OP_NE == predicate.op? !equal: equal;
+}/*}}}*/
+
+bool FilterJson::onValue(Type type, const char *str, size_t len, double num)
+{/*{{{*/
+    /* the root, or a value in an array */
+    if (m_path_lens.empty()) return false;
+    if (m_array_depth > 0) return true;
+
+    for (size_t i = 0; i < m_predicates.size(); ++i) {
+        Predicate &predicate = m_predicates[i];
+        if (predicate.seen || predicate.field != m_path) continue;
+
+        predicate.seen = true;
+        --m_unseen;
+        if (!evaluate(predicate, type, str, len, num)) {
+            m_failed = true;
+        }
+    }
+
+    /* stop reading once the line is decided */
+    return !m_failed && m_unseen > 0;
+}/*}}}*/
+
+bool FilterJson::match(const char *data, size_t len)
+{/*{{{*/
+    m_path.clear();
+    m_path_lens.clear();
+    m_array_depth = 0;
+    m_is_object = false;
+    m_unseen = m_predicates.size();
+    m_failed = false;
+    for (size_t i = 0; i < m_predicates.size(); ++i) {
+        m_predicates[i].seen = false;
+    }
+
+    MemoryStream ms(data, len);
+    Handler handler(this);
+    ParseResult res = m_reader.Parse<kParseStopWhenDoneFlag>(ms, handler);
+
+    if (!m_is_object || (res.IsError() && kParseErrorTermination != res.Code())) {
+        __atomic_add_fetch(&m_lines_invalid, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    if (m_failed) return false;
+
+    /* a missing field satisfies only ne */
+    for (size_t i = 0; i < m_predicates.size(); ++i) {
+        if (!m_predicates[i].seen && OP_NE != m_predicates[i].op) {
+            return false;
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+bool FilterJson::filter(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    FilterJson *fj = reinterpret_cast<FilterJson *>(arg);
+
+    if (NULL == fj) {
+        LERROR << "Json filter is NULL";
+        return false;
+    }
+
+    bool inner_ok = NULL == fj->m_inner
+        || fj->m_inner->filter(fj->m_inner, lines);
+
+    __atomic_add_fetch(&fj->m_lines_in, lines.size(), __ATOMIC_RELAXED);
+    size_t dropped = compactLines(lines, [fj](size_t i, LineSlice &line) {
+        if (!fj->match(line.data(), line.length())) {
+            LDEBUG << "Json filter drop line: " << line;
+            return false;
+        }
+        return true;
+    });
+    __atomic_add_fetch(&fj->m_lines_dropped, dropped, __ATOMIC_RELAXED);
+
+    return inner_ok;
+}/*}}}*/
+
+void FilterJson::getStats(FilterStats &stats) const
+{/*{{{*/
+    if (NULL != m_inner) {
+        m_inner->getStats(stats);
+    }
+
+    stats.push_back(make_pair(string("json.in"),
+            __atomic_load_n(&m_lines_in, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(string("json.dropped"),
+            __atomic_load_n(&m_lines_dropped, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(string("json.invalid"),
+            __atomic_load_n(&m_lines_invalid, __ATOMIC_RELAXED)));
+}/*}}}*/
+
+} // namespace logkafka
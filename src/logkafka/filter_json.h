@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_JSON_H_
+#define LOGKAFKA_FILTER_JSON_H_
+
+#include <string>
+#include <vector>
+
+#include "logkafka/filter.h"
+#include "logkafka/task_conf.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/reader.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Drop the json lines not satisfying all of json_predicates, the lines
+ * of an inner filter, if any, are filtered first.
+ *
+ * A line is read by SAX from where it is, nothing is copied or parsed
+ * into a DOM, and the reading stops once a predicate fails or all the
+ * fields of the predicates are seen, so usually only the head of a line
+ * is read. The first occurrence of a field counts, the values in arrays
+ * are not addressable. A missing field satisfies only ne.
+ *
+ * The lines which are not json objects are kept and counted.
+ * */
+class FilterJson: public virtual Filter
+{
+    public:
+        FilterJson(FilterConf filter_conf);
+        virtual ~FilterJson();
+
+        /* arg is the inner Filter, may be NULL, owned once inited */
+        bool init(void *arg);
+        bool filter(void *arg, vector<LineSlice> &lines);
+        void getStats(FilterStats &stats) const;
+
+        /* false if data[0, len) is a json object not satisfying all
+         * the predicates */
+        bool match(const char *data, size_t len);
+
+    private:
+        enum Op {
+            OP_EQ,
+            OP_NE,
+            OP_IN,
+            OP_EXISTS,
+            OP_LT,
+            OP_LE,
+            OP_GT,
+            OP_GE
+        };
+
+        struct Operand
+        {
+            rapidjson::Type type;
+            string str;
+            double num;
+        };
+
+        struct Predicate
+        {
+            string field;
+            Op op;
+            vector<Operand> operands;
+            /* the state of the line being read */
+            bool seen;
+        };
+
+        /* SAX handler, see filter_json.cc */
+        struct Handler;
+
+        bool addPredicate(const JsonPredicateConf &conf);
+        bool onValue(rapidjson::Type type,
+                const char *str, size_t len, double num);
+        static bool evaluate(const Predicate &predicate,
+                rapidjson::Type type, const char *str, size_t len, double num);
+
+    private:
+        FilterConf m_filter_conf;
+        Filter *m_inner;
+        vector<Predicate> m_predicates;
+        rapidjson::Reader m_reader;
+
+        /* the state of the line being read */
+        string m_path;
+        vector<size_t> m_path_lens;
+        int m_array_depth;
+        bool m_is_object;
+        size_t m_unseen;
+        bool m_failed;
+
+        unsigned long m_lines_in;
+        unsigned long m_lines_dropped;
+        unsigned long m_lines_invalid;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_JSON_H_
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_multi_regex.h"
+
+namespace logkafka {
+
+bool FilterMultiRegex::init(void *arg)
+{/*{{{*/
+    vector<string> patterns;
+    if (m_filter_conf.regex_filter_pattern != "") {
+        patterns.push_back(m_filter_conf.regex_filter_pattern);
+    }
+    patterns.insert(patterns.end(),
+            m_filter_conf.regex_filter_patterns.begin(),
+            m_filter_conf.regex_filter_patterns.end());
+
+    if (patterns.empty()) {
+        LINFO << "Regex filter patterns are not set";
+        return false;
+    }
+
+    m_hits.assign(patterns.size(), 0);
+
+    return m_regex_set.init(patterns);
+}/*}}}*/
+
+bool FilterMultiRegex::filter(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    FilterMultiRegex *fmr = reinterpret_cast<FilterMultiRegex *>(arg);
+
+    if (NULL == fmr) {
+        LERROR << "Multi regex filter is NULL";
+        return false;
+    }
+
+    compactLines(lines, [fmr](size_t i, LineSlice &line) {
+        int idx = fmr->m_regex_set.match(line.data(), line.length());
+        if (-1 != idx) {
+            LDEBUG << "Multi regex filter drop line: " << line;
+            __atomic_add_fetch(&fmr->m_hits[idx], 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        return true;
+    });
+
+    return true;
+}/*}}}*/
+
+void FilterMultiRegex::getStats(FilterStats &stats) const
+{/*{{{*/
+    for (size_t i = 0; i < m_regex_set.size(); ++i) {
+        stats.push_back(make_pair(
+                    "regex." + int2Str(i) + "." + m_regex_set.getPattern(i),
+                    __atomic_load_n(&m_hits[i], __ATOMIC_RELAXED)));
+    }
+}/*}}}*/
+
+} // namespace logkafka
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_MULTI_REGEX_H_
+#define LOGKAFKA_FILTER_MULTI_REGEX_H_
+
+#include <string>
+#include <vector>
+
+#include "logkafka/filter.h"
+#include "logkafka/regex_set.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Drop the lines matching any of regex_filter_pattern and
+ * regex_filter_patterns, see RegexSet. The hits are counted for the
+ * first matching pattern of the list.
+ * */
+class FilterMultiRegex: public virtual Filter
+{
+    public:
+        FilterMultiRegex(FilterConf filter_conf):
+            m_filter_conf(filter_conf) {};
+        virtual ~FilterMultiRegex() {};
+        bool init(void *arg);
+        bool filter(void *arg, vector<LineSlice> &lines);
+        void getStats(FilterStats &stats) const;
+
+    private:
+        FilterConf m_filter_conf;
+        RegexSet m_regex_set;
+        vector<unsigned long> m_hits;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_MULTI_REGEX_H_
@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_plugin.h"
+
+#include <dlfcn.h>
+
+#include <cstring>
+
+#include "easylogging/easylogging++.h"
+
+namespace logkafka {
+
+const size_t FilterPlugin::ARENA_BYTES = 256 * 1024;
+const size_t FilterPlugin::ARENA_MAX_FREE = 16;
+
+FilterPlugin::FilterPlugin(FilterPluginConf plugin_conf)
+{/*{{{*/
+    m_plugin_conf = plugin_conf;
+    m_inner = NULL;
+
+    m_handle = NULL;
+    m_plugin = NULL;
+    m_instance = NULL;
+    m_pool = NULL;
+
+    m_lines_in = 0;
+    m_lines_dropped = 0;
+    m_lines_rewritten = 0;
+    m_errors = 0;
+}/*}}}*/
+
+FilterPlugin::~FilterPlugin()
+{/*{{{*/
+    delete m_inner; m_inner = NULL;
+    unload();
+
+    /* the pool is freed after the arenas in flight come back */
+    if (NULL != m_pool) {
+        m_pool->unref();
+        m_pool = NULL;
+    }
+}/*}}}*/
+
+bool FilterPlugin::init(void *arg)
+{/*{{{*/
+    if (m_plugin_conf.path.empty()) {
+        LINFO << "Filter plugin path is not set";
+        return false;
+    }
+
+    if (!load()) {
+        unload();
+        return false;
+    }
+
+    m_pool = base::ArenaPool::create(ARENA_BYTES, ARENA_MAX_FREE);
+    m_inner = reinterpret_cast<Filter *>(arg);
+
+    LINFO << "Load filter plugin " << m_name
+          << " from " << m_plugin_conf.path;
+
+    return true;
+}/*}}}*/
+
+bool FilterPlugin::load()
+{/*{{{*/
+    const string &path = m_plugin_conf.path;
+
+    /* each instance holds its own reference to the shared object */
+    m_handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (NULL == m_handle) {
+        LERROR << "Fail to load filter plugin " << path << ", " << dlerror();
+        return false;
+    }
+
+    logkafka_filter_plugin_func func = (logkafka_filter_plugin_func)
+        dlsym(m_handle, LOGKAFKA_FILTER_PLUGIN_SYMBOL);
+    if (NULL == func) {
+        LERROR << "Filter plugin " << path << " does not export "
+               << LOGKAFKA_FILTER_PLUGIN_SYMBOL;
+        return false;
+    }
+
+    m_plugin = (*func)();
+    if (NULL == m_plugin) {
+        LERROR << "Filter plugin " << path << " is NULL";
+        return false;
+    }
+
+    if (LOGKAFKA_FILTER_PLUGIN_ABI_VERSION != m_plugin->abi_version) {
+        LERROR << "Filter plugin " << path << " is built with abi version "
+               << m_plugin->abi_version << ", expect "
+               << LOGKAFKA_FILTER_PLUGIN_ABI_VERSION;
+        m_plugin = NULL;
+        return false;
+    }
+
+    if (NULL == m_plugin->create || NULL == m_plugin->process) {
+        LERROR << "Filter plugin " << path << " has no create or process";
+        m_plugin = NULL;
+        return false;
+    }
+
+    m_name = NULL != m_plugin->name? m_plugin->name: path;
+
+    m_instance = (*m_plugin->create)(m_plugin_conf.args.c_str());
+    if (NULL == m_instance) {
+        LERROR << "Fail to create filter plugin " << m_name
+               << " with args " << m_plugin_conf.args;
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+void FilterPlugin::unload()
+{/*{{{*/
+    if (NULL != m_instance && NULL != m_plugin->destroy) {
+        (*m_plugin->destroy)(m_instance);
+    }
+    m_instance = NULL;
+    m_plugin = NULL;
+
+    if (NULL != m_handle) {
+        dlclose(m_handle);
+        m_handle = NULL;
+    }
+}/*}}}*/
+
+bool FilterPlugin::filter(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    FilterPlugin *fp = reinterpret_cast<FilterPlugin *>(arg);
+
+    if (NULL == fp) {
+        LERROR << "Plugin filter is NULL";
+        return false;
+    }
+
+    bool inner_ok = NULL == fp->m_inner
+        || fp->m_inner->filter(fp->m_inner, lines);
+
+    if (lines.empty() || NULL == fp->m_instance) {
+        return inner_ok;
+    }
+
+    return fp->process(lines) && inner_ok;
+}/*}}}*/
+
+bool FilterPlugin::process(vector<LineSlice> &lines)
+{/*{{{*/
+    size_t count = lines.size();
+    logkafka_line_t none = {NULL, 0};
+
+    m_in.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_in[i].data = lines[i].data();
+        m_in[i].len = lines[i].length();
+    }
+    m_keep.assign(count, 1);
+    m_out.assign(count, none);
+
+    __atomic_add_fetch(&m_lines_in, count, __ATOMIC_RELAXED);
+
+    int res = (*m_plugin->process)(m_instance, &m_in[0], count,
+            &m_keep[0], &m_out[0]);
+    if (0 != res) {
+        LWARNING << "Filter plugin " << m_name << " fails a batch of "
+                 << count << " lines, " << res;
+        __atomic_add_fetch(&m_errors, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    base::ArenaPool::Arena *arena = NULL;
+    size_t dropped = compactLines(lines, [this, &arena](size_t i, LineSlice &line) {
+        if (!m_keep[i]) {
+            LDEBUG << "Filter plugin " << m_name << " drop line: " << line;
+            return false;
+        }
+
+        if (NULL != m_out[i].data && !rewrite(line, m_out[i], arena)) {
+            __atomic_add_fetch(&m_errors, 1, __ATOMIC_RELAXED);
+        }
+        return true;
+    });
+    __atomic_add_fetch(&m_lines_dropped, dropped, __ATOMIC_RELAXED);
+
+    if (NULL != arena) arena->unref();
+
+    return true;
+}/*}}}*/
+
+bool FilterPlugin::rewrite(LineSlice &line, const logkafka_line_t &out,
+        base::ArenaPool::Arena *&arena)
+{/*{{{*/
+    char *data = NULL == arena? NULL: arena->reserve(out.len);
+
+    /* the rewritten lines keep the full arena alive */
+    if (NULL == data) {
+        if (NULL != arena) arena->unref();
+        arena = m_pool->acquire(out.len);
+        if (NULL == arena) {
+            LERROR << "Fail to acquire arena of " << out.len << " bytes";
+            return false;
+        }
+        data = arena->reserve(out.len);
+    }
+
+    memcpy(data, out.data, out.len);
+    arena->commit(out.len);
+    line = LineSlice(data, out.len, arena, line.offset());
+    __atomic_add_fetch(&m_lines_rewritten, 1, __ATOMIC_RELAXED);
+
+    return true;
+}/*}}}*/
+
+void FilterPlugin::getStats(FilterStats &stats) const
+{/*{{{*/
+    if (NULL != m_inner) {
+        m_inner->getStats(stats);
+    }
+
+    string prefix = "plugin." + m_name + ".";
+    stats.push_back(make_pair(prefix + "in",
+            __atomic_load_n(&m_lines_in, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(prefix + "dropped",
+            __atomic_load_n(&m_lines_dropped, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(prefix + "rewritten",
+            __atomic_load_n(&m_lines_rewritten, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(prefix + "errors",
+            __atomic_load_n(&m_errors, __ATOMIC_RELAXED)));
+}/*}}}*/
+
+} // namespace logkafka
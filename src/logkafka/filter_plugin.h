@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_PLUGIN_H_
+#define LOGKAFKA_FILTER_PLUGIN_H_
+
+#include <string>
+#include <vector>
+
+#include "base/arena.h"
+#include "logkafka/filter.h"
+#include "logkafka/filter_plugin_abi.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Run a plugin loaded with dlopen on the lines of an inner filter, if
+ * any, see filter_plugin_abi.h for the interface of plugins.
+ *
+ * The whole batch is handed to the plugin at once. The dropped lines are
+ * compacted away as the other filters do, the rewritten lines are copied
+ * into pooled arenas, so they outlive the buffer of plugin. If the plugin
+ * fails a batch, the batch is passed on unchanged.
+ * */
+class FilterPlugin: public virtual Filter
+{
+    public:
+        FilterPlugin(FilterPluginConf plugin_conf);
+        virtual ~FilterPlugin();
+
+        /* arg is the inner Filter, may be NULL, owned once inited */
+        bool init(void *arg);
+        bool filter(void *arg, vector<LineSlice> &lines);
+        void getStats(FilterStats &stats) const;
+
+    private:
+        bool load();
+        void unload();
+        bool process(vector<LineSlice> &lines);
+        bool rewrite(LineSlice &line, const logkafka_line_t &out,
+                base::ArenaPool::Arena *&arena);
+
+    private:
+        FilterPluginConf m_plugin_conf;
+        Filter *m_inner;
+
+        void *m_handle;
+        const logkafka_filter_plugin_t *m_plugin;
+        void *m_instance;
+        string m_name;
+
+        /* reused for each batch */
+        vector<logkafka_line_t> m_in;
+        vector<unsigned char> m_keep;
+        vector<logkafka_line_t> m_out;
+        base::ArenaPool *m_pool;
+
+        unsigned long m_lines_in;
+        unsigned long m_lines_dropped;
+        unsigned long m_lines_rewritten;
+        unsigned long m_errors;
+
+        static const size_t ARENA_BYTES;
+        static const size_t ARENA_MAX_FREE;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_PLUGIN_H_
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_PLUGIN_ABI_H_
+#define LOGKAFKA_FILTER_PLUGIN_ABI_H_
+
+/* C ABI of filter plugins, the only header a plugin needs.
+ *
+ * A plugin is a shared object exporting LOGKAFKA_FILTER_PLUGIN_SYMBOL,
+ * which returns the description of the plugin. An instance is created
+ * for each file of the task, and is called once per batch of lines, so
+ * the per-line work can be vectorized or amortized.
+ *
+ * An instance is called by one thread at a time, not always the same
+ * thread if filter.threads is set.
+ * */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped on any incompatible change of the structs below */
+#define LOGKAFKA_FILTER_PLUGIN_ABI_VERSION 1
+
+#define LOGKAFKA_FILTER_PLUGIN_SYMBOL "logkafka_filter_plugin"
+
+typedef struct logkafka_line {
+    const char *data;
+    size_t len;
+} logkafka_line_t;
+
+typedef struct logkafka_filter_plugin {
+    /* LOGKAFKA_FILTER_PLUGIN_ABI_VERSION the plugin is built with */
+    uint32_t abi_version;
+
+    /* prefix of the counters in collecting state */
+    const char *name;
+
+    /* a new instance, args is the args string of the task (or ""),
+     * NULL on failure */
+    void *(*create)(const char *args);
+
+    /* may be NULL */
+    void (*destroy)(void *instance);
+
+    /* On entry keep[i] is 1 and out[i] is {NULL, 0} for each of the
+     * count lines. Set keep[i] to 0 to drop lines[i], set out[i] to
+     * replace it, the data of out[] must stay valid until the next call
+     * on the instance, it is copied by logkafka. The data of lines[] is
+     * valid only during the call.
+     *
+     * Return 0 on success, otherwise the batch is passed on unchanged. */
+    int (*process)(void *instance, const logkafka_line_t *lines,
+            size_t count, unsigned char *keep, logkafka_line_t *out);
+} logkafka_filter_plugin_t;
+
+typedef const logkafka_filter_plugin_t *(*logkafka_filter_plugin_func)(void);
+
+/* the function each plugin defines */
+const logkafka_filter_plugin_t *logkafka_filter_plugin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGKAFKA_FILTER_PLUGIN_ABI_H_
@@ -0,0 +1,274 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_pool.h"
+
+#include <sched.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace logkafka {
+
+const int FilterPool::JOB_QUEUED = 0;
+const int FilterPool::JOB_RUNNING = 1;
+const int FilterPool::JOB_DONE = 2;
+const int FilterPool::JOB_CANCELLED = 3;
+
+FilterPool::FilterPool()
+{/*{{{*/
+    m_jobs = NULL;
+    m_done = NULL;
+    m_jobs_sem_valid = false;
+    m_stopping = false;
+    m_inflight = 0;
+    m_loop = NULL;
+    m_async_handle = NULL;
+}/*}}}*/
+
+FilterPool::~FilterPool()
+{/*{{{*/
+    close();
+}/*}}}*/
+
+bool FilterPool::init(uv_loop_t *loop, unsigned threads, unsigned queue_size)
+{/*{{{*/
+    m_loop = loop;
+
+    if (0 == threads || 0 == queue_size) {
+        return false;
+    }
+
+    /* each job in flight holds one cell of either queue, at most
+     * capacity() jobs are submitted, the done queue never overflows */
+    m_jobs = new LockFreeQueue<FilterJob *>(queue_size);
+    m_done = new LockFreeQueue<FilterJob *>(queue_size);
+
+    if (0 != sem_init(&m_jobs_sem, 0, 0)) {
+        LERROR << "Fail to init semaphore, " << strerror(errno);
+        close();
+        return false;
+    }
+    m_jobs_sem_valid = true;
+
+    m_async_handle = new uv_async_t();
+    int res = uv_async_init(m_loop, m_async_handle, onAsync);
+    if (res < 0) {
+        LERROR << "Fail to init uv async, " << uv_strerror(res);
+        delete m_async_handle; m_async_handle = NULL;
+        close();
+        return false;
+    }
+    m_async_handle->data = this;
+
+    for (unsigned i = 0; i < threads; ++i) {
+        pthread_t tid;
+        int err = pthread_create(&tid, NULL, run, this);
+        if (0 != err) {
+            LERROR << "Fail to create filter thread, " << strerror(err);
+            close();
+            return false;
+        }
+        m_threads.push_back(tid);
+    }
+
+    LINFO << "Using filter pool, threads: " << threads
+          << ", queue size: " << m_jobs->capacity();
+
+    return true;
+}/*}}}*/
+
+void FilterPool::close()
+{/*{{{*/
+    if (!m_threads.empty()) {
+        m_stopping = true;
+        __sync_synchronize();
+
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            sem_post(&m_jobs_sem);
+        }
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            pthread_join(m_threads[i], NULL);
+        }
+        m_threads.clear();
+    }
+
+    if (NULL != m_async_handle) {
+        uv_close((uv_handle_t *)m_async_handle, onCloseComplete);
+        m_async_handle = NULL;
+    }
+
+    /* the jobs left are dropped, their callbacks are never called, the
+     * submitters may still finish or cancel them */
+    FilterJob *job = NULL;
+    if (NULL != m_jobs) {
+        while (m_jobs->pop(job)) job->unref();
+        delete m_jobs; m_jobs = NULL;
+    }
+
+    if (NULL != m_done) {
+        while (m_done->pop(job)) job->unref();
+        delete m_done; m_done = NULL;
+    }
+
+    m_inflight = 0;
+
+    if (m_jobs_sem_valid) {
+        sem_destroy(&m_jobs_sem);
+        m_jobs_sem_valid = false;
+    }
+}/*}}}*/
+
+FilterJob *FilterPool::submit(Filter *filter, vector<LineSlice> &lines,
+        FilterFunc func, void *arg)
+{/*{{{*/
+    if (NULL == m_jobs || m_threads.empty()
+            || m_inflight >= m_jobs->capacity()) {
+        return NULL;
+    }
+
+    FilterJob *job = new FilterJob();
+    job->filter = filter;
+    job->lines.swap(lines);
+    job->func = func;
+    job->arg = arg;
+    job->state = JOB_QUEUED;
+
+    /* the reference of pool, dropped once the job is reaped */
+    job->ref();
+
+    if (!m_jobs->push(job)) {
+        lines.swap(job->lines);
+        job->unref();
+        job->unref();
+        return NULL;
+    }
+
+    ++m_inflight;
+    sem_post(&m_jobs_sem);
+
+    return job;
+}/*}}}*/
+
+void FilterPool::finish(FilterJob *job, vector<LineSlice> &lines)
+{/*{{{*/
+    if (NULL == job) return;
+
+    job->func = NULL;
+
+    if (__sync_bool_compare_and_swap(&job->state, JOB_QUEUED, JOB_RUNNING)) {
+        runJob(job);
+        __sync_bool_compare_and_swap(&job->state, JOB_RUNNING, JOB_DONE);
+    } else {
+        wait(job);
+    }
+
+    lines.swap(job->lines);
+}/*}}}*/
+
+void FilterPool::runJob(FilterJob *job)
+{/*{{{*/
+    /* the lines left are sent, as Manager::receiveLines does */
+    if (!job->filter->filter(job->filter, job->lines)) {
+        LWARNING << "Filter fails on a batch, the " << job->lines.size()
+                 << " lines left are sent";
+    }
+}/*}}}*/
+
+void FilterPool::cancel(FilterJob *job)
+{/*{{{*/
+    if (NULL == job) return;
+
+    job->func = NULL;
+
+    /* the filter may be deleted right after, the worker must be done
+     * with it */
+    if (!__sync_bool_compare_and_swap(&job->state, JOB_QUEUED, JOB_CANCELLED)) {
+        wait(job);
+    }
+}/*}}}*/
+
+void FilterPool::wait(FilterJob *job)
+{/*{{{*/
+    /* one batch is filtered in a short while, it is not worth sleeping */
+    while (JOB_RUNNING == __atomic_load_n(&job->state, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}/*}}}*/
+
+void FilterPool::reap()
+{/*{{{*/
+    FilterJob *job = NULL;
+
+    while (NULL != m_done && m_done->pop(job)) {
+        --m_inflight;
+
+        if (NULL != job->func) {
+            (*job->func)(job->arg, job->lines);
+        }
+
+        job->unref();
+    }
+}/*}}}*/
+
+void *FilterPool::run(void *arg)
+{/*{{{*/
+    FilterPool *pool = reinterpret_cast<FilterPool *>(arg);
+
+    while (true) {
+        while (0 != sem_wait(&pool->m_jobs_sem) && EINTR == errno);
+
+        if (pool->m_stopping) {
+            break;
+        }
+
+        FilterJob *job = NULL;
+        if (!pool->m_jobs->pop(job)) {
+            continue;
+        }
+
+        /* the job may have been taken over by finish or cancel */
+        if (__sync_bool_compare_and_swap(&job->state, JOB_QUEUED, JOB_RUNNING)) {
+            runJob(job);
+            __sync_bool_compare_and_swap(&job->state, JOB_RUNNING, JOB_DONE);
+        }
+
+        while (!pool->m_done->push(job)) {
+            sched_yield();
+        }
+        uv_async_send(pool->m_async_handle);
+    }
+
+    return NULL;
+}/*}}}*/
+
+void FilterPool::onAsync(uv_async_t *handle)
+{/*{{{*/
+    FilterPool *pool = reinterpret_cast<FilterPool *>(handle->data);
+    pool->reap();
+}/*}}}*/
+
+void FilterPool::onCloseComplete(uv_handle_t *handle)
+{/*{{{*/
+    delete (uv_async_t *)handle;
+}/*}}}*/
+
+} // namespace logkafka
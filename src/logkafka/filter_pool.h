@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_POOL_H_
+#define LOGKAFKA_FILTER_POOL_H_
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <vector>
+
+#include "base/common.h"
+#include "base/lock_free_queue.h"
+#include "base/ref_counted.h"
+#include "logkafka/filter.h"
+#include "logkafka/line_slice.h"
+
+#include <uv.h>
+#include "easylogging/easylogging++.h"
+
+using namespace std;
+using namespace base;
+
+namespace logkafka {
+
+/* Completion callback with the kept lines, called on the loop thread */
+typedef void (*FilterFunc)(void *arg, vector<LineSlice> &lines);
+
+struct FilterJob: public RefCounted
+{
+    Filter *filter;
+    vector<LineSlice> lines;
+    FilterFunc func;
+    void *arg;
+    /* JOB_QUEUED -> JOB_RUNNING -> JOB_DONE, or JOB_QUEUED -> JOB_CANCELLED */
+    volatile int state;
+};
+
+/* Fixed pool of threads which run the filters of the loop.
+ *
+ * The loop thread hands the line batches over through a lock-free queue,
+ * the workers put the filtered batches to another one and wake the loop
+ * up with uv_async_send, the callbacks are then called on the loop
+ * thread. The submitter keeps at most one job in flight per file, so the
+ * lines of one file are delivered in order and a filter (which is not
+ * thread-safe) is never run by two threads at once.
+ *
+ * If a job can not be queued (NULL is returned), the caller should
+ * filter the lines itself.
+ * */
+class FilterPool
+{
+    public:
+        FilterPool();
+        ~FilterPool();
+
+        bool init(uv_loop_t *loop, unsigned threads, unsigned queue_size);
+        void close();
+
+        /* the lines are moved into the job, the caller owns the returned
+         * reference */
+        FilterJob *submit(Filter *filter, vector<LineSlice> &lines,
+                FilterFunc func, void *arg);
+
+        /* filter the lines of a queued job on the calling thread, or wait
+         * for the worker running it, the kept lines are moved out of the
+         * job and the callback is never called */
+        void finish(FilterJob *job, vector<LineSlice> &lines);
+
+        /* the callback of a cancelled job is never called */
+        void cancel(FilterJob *job);
+
+    private:
+        void wait(FilterJob *job);
+        void reap();
+
+        static void runJob(FilterJob *job);
+        static void *run(void *arg);
+        static void onAsync(uv_async_t *handle);
+        static void onCloseComplete(uv_handle_t *handle);
+
+    private:
+        LockFreeQueue<FilterJob *> *m_jobs;
+        LockFreeQueue<FilterJob *> *m_done;
+        sem_t m_jobs_sem;
+        bool m_jobs_sem_valid;
+        vector<pthread_t> m_threads;
+        volatile bool m_stopping;
+        unsigned m_inflight;
+        uv_loop_t *m_loop;
+        uv_async_t *m_async_handle;
+
+        static const int JOB_QUEUED;
+        static const int JOB_RUNNING;
+        static const int JOB_DONE;
+        static const int JOB_CANCELLED;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_POOL_H_
@@ -25,29 +25,15 @@ namespace logkafka {
 
 bool FilterRegex::init(void *arg)
 {/*{{{*/
-    PCRE2_SIZE erroffset;
-    int errorcode;
-
     if (m_filter_conf.regex_filter_pattern == "") {
         LINFO << "Regex filter pattern is not set";
         return false;
     }
 
-    PCRE2_SPTR pattern = (PCRE2_SPTR)(m_filter_conf.regex_filter_pattern.c_str());
-
-    m_re = pcre2_compile(pattern, -1, 0, &errorcode, &erroffset, NULL);
-    if (m_re == NULL) {
-        PCRE2_UCHAR8 buffer[120];
-        (void)pcre2_get_error_message(errorcode, buffer, 120);
-        /* Handle error */
-        LERROR << "Fail to compile pattern, " << buffer;
-        return false;
-    }
-
-    return true;
+    return m_regex.init(m_filter_conf.regex_filter_pattern);
 }/*}}}*/
 
-bool FilterRegex::filter(void *arg, vector<string> &lines)
+bool FilterRegex::filter(void *arg, vector<LineSlice> &lines)
 {/*{{{*/
     FilterRegex *fr = reinterpret_cast<FilterRegex *>(arg);
 
@@ -56,27 +42,13 @@ bool FilterRegex::filter(void *arg, vector<string> &lines)
         return false;
     }
 
-    pcre2_code *re = fr->m_re;
-    pcre2_match_data *match_data;
-    int rc;
-
-    match_data = pcre2_match_data_create(20, NULL);
-
-    vector<string>::iterator iter;
-
-    for (iter = lines.begin(); iter != lines.end(); ) {
-        string line = *iter;
-        PCRE2_SPTR value = (PCRE2_SPTR)line.c_str(); 
-        rc = pcre2_match(re, value, -1, 0, 0, match_data, NULL);
-        if (rc > 0) {
+    compactLines(lines, [fr](size_t i, LineSlice &line) {
+        if (fr->m_regex.match(line.data(), line.length())) {
             LDEBUG << "Regex filter drop line: " << line;
-            lines.erase(iter);
-        } else {
-            ++iter;
+            return false;
         }
-    }
-
-    pcre2_match_data_free(match_data);
+        return true;
+    });
 
     return true;
 }/*}}}*/
@@ -26,10 +26,9 @@
 #include <vector>
 
 #include "logkafka/filter.h"
+#include "logkafka/regex.h"
 #include "logkafka/task_conf.h"
 
-#include "pcre2.h"
-
 using namespace std;
 
 namespace logkafka {
@@ -39,16 +38,14 @@ class FilterRegex: public virtual Filter
     public:
         FilterRegex(): Filter() {};
         FilterRegex(FilterConf filter_conf): 
-            m_filter_conf(filter_conf) { m_re = NULL; };
-        virtual ~FilterRegex() {
-            pcre2_code_free(m_re); m_re = NULL;
-        };
+            m_filter_conf(filter_conf) {};
+        virtual ~FilterRegex() {};
         bool init(void *arg);
-        bool filter(void *arg, vector<string> &lines);
+        bool filter(void *arg, vector<LineSlice> &lines);
 
     private:
         FilterConf m_filter_conf;
-        pcre2_code *m_re;
+        Regex m_regex;
 };
 
 } // namespace logkafka
@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/filter_sample.h"
+
+#include <time.h>
+
+#include <algorithm>
+
+namespace logkafka {
+
+static const unsigned long WINDOW_MS = 1000;
+
+/* the weight of the newest second in the effective rate */
+static const double RATE_SMOOTHING = 0.5;
+
+static unsigned long getMonotonicMs()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}/*}}}*/
+
+FilterSample::FilterSample(SampleConf sample_conf)
+{/*{{{*/
+    m_sample_conf = sample_conf;
+    m_inner = NULL;
+    m_key_regex = NULL;
+
+    m_rate = sample_conf.rate;
+    m_credit = 0.0;
+
+    m_window_started = false;
+    m_window_start_ms = 0;
+    m_window_lines_in = 0;
+    m_window_bytes_in = 0;
+    m_window_lines_kept = 0;
+    m_window_bytes_kept = 0;
+
+    m_lines_in = 0;
+    m_lines_sampled_out = 0;
+}/*}}}*/
+
+FilterSample::~FilterSample()
+{/*{{{*/
+    delete m_inner; m_inner = NULL;
+    delete m_key_regex; m_key_regex = NULL;
+}/*}}}*/
+
+bool FilterSample::init(void *arg)
+{/*{{{*/
+    if (!SampleConf::isRateValid(m_sample_conf.rate)) {
+        LERROR << "Sample rate " << m_sample_conf.rate << " is invalid";
+        return false;
+    }
+
+    if (m_sample_conf.key_pattern != "") {
+        m_key_regex = new Regex();
+        if (!m_key_regex->init(m_sample_conf.key_pattern)) {
+            LERROR << "Fail to init sample key pattern "
+                   << m_sample_conf.key_pattern;
+            delete m_key_regex; m_key_regex = NULL;
+            return false;
+        }
+    }
+
+    m_inner = reinterpret_cast<Filter *>(arg);
+
+    return true;
+}/*}}}*/
+
+uint64_t FilterSample::hashKey(const char *data, size_t len)
+{/*{{{*/
+    /* FNV-1a, finished with the splitmix64 mixer, the high bits of
+     * FNV-1a alone are poorly spread for short keys */
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    hash ^= hash >> 30; hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27; hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+
+    return hash;
+}/*}}}*/
+
+void FilterSample::updateRate(unsigned long now_ms)
+{/*{{{*/
+    if (!m_window_started) {
+        m_window_started = true;
+        m_window_start_ms = now_ms;
+        return;
+    }
+
+    unsigned long elapsed_ms = now_ms - m_window_start_ms;
+    if (elapsed_ms < WINDOW_MS) return;
+
+    double target = m_sample_conf.rate;
+    if (m_sample_conf.max_lines_per_sec > 0 && m_window_lines_in > 0) {
+        double lines_per_sec = m_window_lines_in * 1000.0 / elapsed_ms;
+        target = min(target, m_sample_conf.max_lines_per_sec / lines_per_sec);
+    }
+    if (m_sample_conf.max_bytes_per_sec > 0 && m_window_bytes_in > 0) {
+        double bytes_per_sec = m_window_bytes_in * 1000.0 / elapsed_ms;
+        target = min(target, m_sample_conf.max_bytes_per_sec / bytes_per_sec);
+    }
+
+    /* drop faster than recover, a burst is cut at once */
+    double rate = m_rate;
+    if (target < rate) {
+        rate = target;
+    } else {
+        rate += (target - rate) * RATE_SMOOTHING;
+    }
+    /* read by getRate from the loop thread */
+    __atomic_store(&m_rate, &rate, __ATOMIC_RELAXED);
+
+    m_window_start_ms = now_ms;
+    m_window_lines_in = 0;
+    m_window_bytes_in = 0;
+    m_window_lines_kept = 0;
+    m_window_bytes_kept = 0;
+}/*}}}*/
+
+bool FilterSample::keep(const LineSlice &line)
+{/*{{{*/
+    if (m_sample_conf.max_lines_per_sec > 0 &&
+            m_window_lines_kept >= m_sample_conf.max_lines_per_sec) {
+        return false;
+    }
+    if (m_sample_conf.max_bytes_per_sec > 0 &&
+            m_window_bytes_kept + line.length() > m_sample_conf.max_bytes_per_sec) {
+        return false;
+    }
+
+    const char *key = NULL;
+    size_t key_len = 0;
+    if (NULL != m_key_regex &&
+            m_key_regex->capture(line.data(), line.length(), &key, &key_len)) {
+        if (m_rate >= 1.0) return true;
+        /* 2^64 */
+        return hashKey(key, key_len) < (uint64_t)(m_rate * 18446744073709551616.0);
+    }
+
+    m_credit += m_rate;
+    if (m_credit < 1.0) return false;
+    m_credit -= 1.0;
+
+    return true;
+}/*}}}*/
+
+void FilterSample::sample(vector<LineSlice> &lines, unsigned long now_ms)
+{/*{{{*/
+    updateRate(now_ms);
+
+    __atomic_add_fetch(&m_lines_in, lines.size(), __ATOMIC_RELAXED);
+    size_t sampled_out = compactLines(lines, [this](size_t i, LineSlice &line) {
+        ++m_window_lines_in;
+        m_window_bytes_in += line.length();
+
+        if (!keep(line)) {
+            LDEBUG << "Sample filter drop line: " << line;
+            return false;
+        }
+
+        ++m_window_lines_kept;
+        m_window_bytes_kept += line.length();
+        return true;
+    });
+    __atomic_add_fetch(&m_lines_sampled_out, sampled_out, __ATOMIC_RELAXED);
+}/*}}}*/
+
+bool FilterSample::filter(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    FilterSample *fs = reinterpret_cast<FilterSample *>(arg);
+
+    if (NULL == fs) {
+        LERROR << "Sample filter is NULL";
+        return false;
+    }
+
+    bool inner_ok = NULL == fs->m_inner
+        || fs->m_inner->filter(fs->m_inner, lines);
+
+    fs->sample(lines, getMonotonicMs());
+
+    return inner_ok;
+}/*}}}*/
+
+void FilterSample::getStats(FilterStats &stats) const
+{/*{{{*/
+    if (NULL != m_inner) {
+        m_inner->getStats(stats);
+    }
+
+    stats.push_back(make_pair(string("sample.in"),
+                __atomic_load_n(&m_lines_in, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(string("sample.sampled_out"),
+                __atomic_load_n(&m_lines_sampled_out, __ATOMIC_RELAXED)));
+    stats.push_back(make_pair(string("sample.rate_ppm"),
+                (unsigned long)(getRate() * 1000000 + 0.5)));
+}/*}}}*/
+
+} // namespace logkafka
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_FILTER_SAMPLE_H_
+#define LOGKAFKA_FILTER_SAMPLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "logkafka/filter.h"
+#include "logkafka/regex.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Keep a deterministic fraction of the lines kept by an inner filter.
+ *
+ * Without key_pattern every 1/rate-th line is kept. With key_pattern the
+ * key of a line is hashed and the line is kept if the hash is below
+ * rate * 2^64, so the lines of a key (a request id, a user) are kept or
+ * dropped together, on every host. The lines without a key are sampled
+ * by count.
+ *
+ * With max_lines_per_sec or max_bytes_per_sec the rate is lowered to
+ * what the input of the last second allows, smoothed over the seconds,
+ * and the lines over the budget of the current second are dropped.
+ *
+ * The lines in, the lines sampled out and the current rate in ppm are
+ * reported, so downstream can reweight by 1e6 / rate_ppm.
+ * */
+class FilterSample: public virtual Filter
+{
+    public:
+        FilterSample(SampleConf sample_conf);
+        virtual ~FilterSample();
+
+        /* arg is the inner Filter, may be NULL, owned once inited */
+        bool init(void *arg);
+        bool filter(void *arg, vector<LineSlice> &lines);
+        void getStats(FilterStats &stats) const;
+
+        /* sample lines as if at now_ms of a monotonic clock */
+        void sample(vector<LineSlice> &lines, unsigned long now_ms);
+        double getRate() const
+        {
+            double rate;
+            __atomic_load(&m_rate, &rate, __ATOMIC_RELAXED);
+            return rate;
+        };
+
+    private:
+        void updateRate(unsigned long now_ms);
+        bool keep(const LineSlice &line);
+        static uint64_t hashKey(const char *data, size_t len);
+
+    private:
+        SampleConf m_sample_conf;
+        Filter *m_inner;
+        Regex *m_key_regex;
+
+        /* the effective rate, below m_sample_conf.rate under budget */
+        double m_rate;
+        double m_credit;
+
+        bool m_window_started;
+        unsigned long m_window_start_ms;
+        unsigned long m_window_lines_in;
+        unsigned long m_window_bytes_in;
+        unsigned long m_window_lines_kept;
+        unsigned long m_window_bytes_kept;
+
+        unsigned long m_lines_in;
+        unsigned long m_lines_sampled_out;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_FILTER_SAMPLE_H_
@@ -23,54 +23,152 @@
 
 namespace logkafka {
 
+const unsigned long IOHandler::MMAP_WINDOW_DEFAULT_BYTES = 67108864UL; /* 64MB */
+const size_t IOHandler::DIRECT_IO_ALIGN_BYTES = 4096;
+const off_t IOHandler::PAGECACHE_SCAN_AHEAD_BYTES = 16777216; /* 16MB */
+const off_t IOHandler::PAGECACHE_SCAN_MAX_BYTES = 67108864; /* 64MB */
+
 IOHandler::IOHandler()
 {/*{{{*/
     m_file = NULL;
-    m_buffer = NULL;
+    m_fd = -1;
+    m_file_pos = 0;
+    m_file_stat_valid = false;
+    m_advised_pos = 0;
+    m_direct_fd = -1;
+    m_direct_buffer = NULL;
+    m_direct_buffer_bytes = 0;
+    m_engine = NULL;
+    m_read_request = NULL;
+    m_read_ready = false;
+    m_read_result = 0;
+    m_filter_pool = NULL;
+    m_filter_job = NULL;
+    m_filter_lines = 0;
+    m_filter_bytes = 0;
+    m_tracker = NULL;
+    m_ring = NULL;
+    m_buffer_start = 0;
     m_buffer_len = 0;
     m_last_io_time = (struct timeval){0};
     m_last_buffer_stuck_time = (struct timeval){0};
     m_buffer_last_segment = false;
+    m_length_prefix_bytes = 0;
+    m_frame_left = 0;
+    m_assembler = NULL;
     m_filter = NULL;
     m_output = NULL;
+    m_output_paused = false;
 }/*}}}*/
 
 IOHandler::~IOHandler()
 {/*{{{*/
-    free(m_buffer);
-    m_buffer = NULL;
+    cancelRead();
+    cancelFilter();
+    closeDirect();
+    free(m_direct_buffer); m_direct_buffer = NULL;
+    delete m_assembler; m_assembler = NULL;
+
+    /* the batches in flight hold the tracker until they are delivered */
+    if (NULL != m_tracker) {
+        m_tracker->close();
+        m_tracker->unref(); m_tracker = NULL;
+    }
+
+    /* in-flight lines keep the ring alive until they are delivered */
+    if (NULL != m_ring) {
+        m_ring->unref(); m_ring = NULL;
+    }
 }/*}}}*/
 
 bool IOHandler::init(FILE *file,
                      PositionEntry *position_entry,
                      unsigned int max_line_at_once,
+                     unsigned int batch_min_lines,
+                     unsigned int batch_max_lines,
                      unsigned int line_max_bytes,
                      unsigned int buffer_max_bytes,
-                     char line_delimiter,
+                     unsigned long mmap_min_bytes,
+                     unsigned long direct_min_bytes,
+                     bool pagecache_dontneed,
+                     const string &line_delimiter,
                      bool remove_delimiter,
+                     unsigned int length_prefix_bytes,
+                     const MultilineConf &multiline_conf,
                      void *filter,
                      void *output,
-                     ReceiveFunc receiveLines)
+                     ReceiveFunc receiveLines,
+                     UringEngine *engine,
+                     FilterPool *filter_pool,
+                     unsigned long max_inflight_bytes)
 {/*{{{*/
     m_file = file;
+    m_fd = fileno(file);
+    /* the file was positioned by the caller, from now on it is only
+     * read with pread at m_file_pos, stdio is not involved */
+    m_file_pos = ftell(file);
+    if (m_file_pos < 0) {
+        LERROR << "Fail to get position of fd " << m_fd
+               << ", " << strerror(errno);
+        return false;
+    }
+    refreshFileStat();
     m_position_entry = position_entry;
-    m_max_line_at_once = max_line_at_once;
+    m_batch_sizer.init(max_line_at_once, batch_min_lines, batch_max_lines);
+    m_max_line_at_once = m_batch_sizer.getSize();
     m_line_max_bytes = line_max_bytes;
-    m_buffer_max_bytes = buffer_max_bytes;
+    /* a whole line with its delimiter or length prefix must fit in buffer */
+    m_buffer_max_bytes = max((size_t)buffer_max_bytes, line_max_bytes
+            + max(line_delimiter.length(), (size_t)length_prefix_bytes));
     m_buffer_stuck_max_ms = 10000;
+    m_mmap_min_bytes = mmap_min_bytes;
+    m_mmap_window_bytes = max(MMAP_WINDOW_DEFAULT_BYTES, m_buffer_max_bytes * 2UL);
+    m_direct_min_bytes = direct_min_bytes;
+    m_pagecache_dontneed = pagecache_dontneed;
     m_line_delimiter = line_delimiter;
     m_remove_delimiter = remove_delimiter;
+    m_length_prefix_bytes = length_prefix_bytes;
+    if (0 == m_length_prefix_bytes && m_line_delimiter.empty()) {
+        LERROR << "Line delimiter is empty";
+        return false;
+    }
+    if (0 != m_length_prefix_bytes && multiline_conf.start_pattern != "") {
+        LWARNING << "Multi-line records are not joined with length-prefixed framing";
+    } else if (multiline_conf.start_pattern != "") {
+        m_assembler = new RecordAssembler();
+        if (!m_assembler->init(multiline_conf,
+                    line_delimiter, remove_delimiter)) {
+            LERROR << "Fail to init record assembler";
+            delete m_assembler; m_assembler = NULL;
+            return false;
+        }
+    }
     m_filter = filter;
     m_output = output;
     m_receive_func = receiveLines;
+    m_engine = engine;
+    m_filter_pool = filter_pool;
 
-    if (NULL == (m_buffer = reinterpret_cast<char *>(malloc(m_buffer_max_bytes + 1)))) {
-        LERROR << "Fail to malloc " << (m_buffer_max_bytes + 1) << " bytes"
-               << ", " << strerror(errno);
+    if (0 != max_inflight_bytes) {
+        m_tracker = new DeliveryTracker();
+        if (!m_tracker->init(position_entry, m_file_pos, max_inflight_bytes)) {
+            LERROR << "Fail to init delivery tracker";
+            return false;
+        }
+        /* the pages are dropped once the lines are delivered */
+        m_tracker->setCommitCallback(this, onCommit);
+    }
+
+    m_delimiter_positions.resize(m_batch_sizer.getMaxSize());
+    m_lines.reserve(m_batch_sizer.getMaxSize());
+
+    /* half of the ring for the unsplit data, the other half for lines
+     * which are still in use (e.g. waiting for delivery) */
+    if (NULL == (m_ring = RingBuffer::create(m_buffer_max_bytes * 2UL))) {
+        LERROR << "Fail to create ring buffer of "
+               << m_buffer_max_bytes * 2UL << " bytes";
         return false;
     }
-    
-    bzero(m_buffer, m_buffer_max_bytes + 1);
 
     if (0 != gettimeofday(&m_last_io_time, NULL)) {
         LERROR << "Fail to get time";
@@ -94,20 +192,62 @@ void IOHandler::onNotify(void *arg)
         return;
     }
 
-    if (NULL == ioh->m_file) {
+    if (-1 == ioh->m_fd) {
+        return;
+    }
+
+    /* inode and size are served from this stat until the next notify */
+    ioh->refreshFileStat();
+
+    /* wait for the completion of asynchronous read */
+    if (NULL != ioh->m_read_request) {
+        return;
+    }
+
+    /* wait for the filtered lines, the lines of one file are sent in order */
+    if (NULL != ioh->m_filter_job) {
         return;
     }
 
+    /* some lines are lost, read them again from the delivered position */
+    off_t rewind_pos = 0;
+    if (NULL != ioh->m_tracker && ioh->m_tracker->needRewind(rewind_pos)) {
+        ioh->rewind(rewind_pos);
+    }
+
+    /* wait for the deliveries, or for the output to resume */
+    if (ioh->isSendPaused()) {
+        return;
+    }
+
+    /* handle last unsent lines, before any new line */
+    if (!ioh->m_unsent_lines.empty()) {
+        ioh->updateLastIOTime();
+        if (!ioh->resendLines()) {
+            return;
+        }
+    }
+
+    /* the rest of the record may never come */
+    if (NULL != ioh->m_assembler) {
+        ioh->m_assembler->flush(ioh->m_lines, false);
+    }
+
     /* handle last uncleaned buffer */
     if (0 != ioh->m_buffer_len) {
         LDEBUG << "Handle uncleaned buffer";
         ioh->updateLastIOTime();
         if (ioh->m_lines.size() < ioh->m_max_line_at_once) {
             LDEBUG << "Have no room for new line";
-            if (ioh->isBufferStuck() && ioh->m_buffer_last_segment) {
+            /* a partial frame is never sent as one line */
+            if (ioh->isBufferStuck() && ioh->m_buffer_last_segment
+                    && 0 == ioh->m_length_prefix_bytes) {
                 LDEBUG << "Buffer is inactive";
-                ioh->m_lines.push_back(string(ioh->m_buffer, ioh->m_buffer_len));
-                ioh->m_buffer_len = 0;
+                RingBuffer::Segment *segment = ioh->m_ring->acquire(
+                        ioh->m_buffer_start + ioh->m_buffer_len);
+                ioh->addLine(ioh->getBuffer(), ioh->m_buffer_len, segment,
+                        ioh->getFilePos() - ioh->m_buffer_len);
+                ioh->consumeBuffer(ioh->m_buffer_len, segment);
             }
         }
     }
@@ -115,14 +255,7 @@ void IOHandler::onNotify(void *arg)
     /* handle last unreceived lines */ 
     if (!ioh->m_lines.empty()) {
         ioh->updateLastIOTime();
-        vector<string> unsent_lines;
-        if ((*ioh->m_receive_func)(ioh->m_filter, ioh->m_output, ioh->m_lines, unsent_lines)) {
-            ioh->m_position_entry->updatePos(ioh->getFilePos() - ioh->m_buffer_len);
-            /* keep unsent lines in m_lines for resending */ 
-            ioh->m_lines = unsent_lines;
-        }
-
-        if (!unsent_lines.empty()) {
+        if (!ioh->receiveLines()) {
             /* unsent lines found, we have to return */
             return;
         }
@@ -136,71 +269,45 @@ void IOHandler::onNotify(void *arg)
         while (true) {
             size_t read_len = 0;
 
-            {
-                ScopedLock l(ioh->m_file_mutex);
-                if (NULL != ioh->m_file) {
-                    read_len += fread(ioh->m_buffer + ioh->m_buffer_len,
-                            1, ioh->m_buffer_max_bytes - ioh->m_buffer_len, ioh->m_file);
+            if (ioh->readMapped(read_len) && 0 != read_len) {
+                /* far behind, the lines are split in place from the mapping */
+                if (ioh->m_lines.size() >= ioh->m_max_line_at_once) {
+                     read_more = true;
+                     break;
                 }
+                continue;
             }
 
-            ioh->m_buffer_len += read_len;
+            if (!ioh->readBuffer(read_len)) {
+                /* the read is submitted, we will be back on completion */
+                read_more = false;
+                break;
+            }
 
             if (0 != ioh->m_buffer_len) {
                 size_t cur_buf_pos = 0;
-                size_t cur_line_len = 0;
-                char *cur_line = ioh->m_buffer;
-
-                ioh->m_buffer_last_segment = false;
-                size_t i; 
-                for (i = 0; i < ioh->m_buffer_len; ++i) {
-                    /* got enough data, we should leave this loop */
-                    if (ioh->m_lines.size() >= ioh->m_max_line_at_once) {
-                         read_more = true;
-                         break;
-                    }
-
-                    cur_line_len = (i + 1) - cur_buf_pos;
-                    cur_line = ioh->m_buffer + cur_buf_pos;
-
-                    if (ioh->m_buffer[i] == ioh->m_line_delimiter) {
-                        if (ioh->m_remove_delimiter) {
-                            cur_line_len -= 1;
-                        }
-
-                        ioh->m_lines.push_back(string(cur_line, cur_line_len));
-                        cur_buf_pos = i + 1;
-                    } else if (cur_line_len >= ioh->m_line_max_bytes) {
-                        ioh->m_lines.push_back(string(cur_line, cur_line_len));
-                        cur_buf_pos = i + 1;
-                    }
-                }
 
-                if (i == ioh->m_buffer_len) ioh->m_buffer_last_segment = true;
+                RingBuffer::Segment *segment = ioh->m_ring->acquire(
+                        ioh->m_buffer_start + ioh->m_buffer_len);
+
+                /* got enough data, we should leave this loop */
+                ioh->m_buffer_last_segment = !ioh->splitBuffer(ioh->getBuffer(),
+                        ioh->m_buffer_len, ioh->getFilePos() - ioh->m_buffer_len,
+                        cur_buf_pos, segment);
+                if (!ioh->m_buffer_last_segment) read_more = true;
 
                 /* Sometimes, the buffer can not be split perfectly, there is
-                 * some data left in buffer, we should move it to the head of buffer
+                 * some data left in buffer, it stays where it is and the
+                 * next read is appended right after it
                  * */
-                size_t buffer_left_bytes = ioh->m_buffer_len - cur_buf_pos;
-                ioh->m_buffer_len = buffer_left_bytes;
-                if (buffer_left_bytes > 0) {
-                    memcpy(ioh->m_buffer, ioh->m_buffer + cur_buf_pos, buffer_left_bytes);
+                ioh->consumeBuffer(cur_buf_pos, segment);
+                if (ioh->m_buffer_len > 0) {
                     ioh->updateLastBufferStuckTime();
                 }
             } 
 
             /* read no new data, we should leave this loop */
             if (0 == read_len) {
-                if (int err = ferror(ioh->m_file)) {
-                    LERROR << "Fail to read from fd " << fileno(ioh->m_file)
-                           << ", ferror: " << err;
-                }
-
-                /* fgets of BSD libc will not clear EOF flag bit (glibc will), 
-                 * so we have to call clearerr to clear the flag bit of EOF & ERR
-                 * */
-                clearerr(ioh->m_file);
-
                 break;
             }
 
@@ -222,21 +329,698 @@ void IOHandler::onNotify(void *arg)
              * */
             ioh->updateLastIOTime();
 
-            vector<string> unsent_lines;
-            if ((*ioh->m_receive_func)(ioh->m_filter, ioh->m_output, ioh->m_lines, unsent_lines)) {
-                ioh->m_position_entry->updatePos(ioh->getFilePos() - ioh->m_buffer_len);
-                /* keep unsent lines in m_lines for resending */ 
-                ioh->m_lines = unsent_lines;
-            }
-
-            if (!unsent_lines.empty()) {
-                /* unsent lines found, read no more */
+            if (!ioh->receiveLines() || ioh->isSendPaused()) {
+                /* unsent lines found, too many lines in flight, or the
+                 * output paused, read no more */
                 read_more = false;
             }
         }
     } while (read_more);
 }/*}}}*/
 
+bool IOHandler::receiveLines()
+{/*{{{*/
+    size_t lines = m_lines.size();
+    size_t bytes = 0;
+    for (size_t i = 0; i < lines; ++i) {
+        bytes += m_lines[i].length();
+    }
+
+    assembleLines();
+    if (m_lines.empty()) {
+        /* all lines belong to the pending record */
+        commitPos(getCommitPos());
+        return true;
+    }
+
+    /* nothing is read until the job is complete, the commit position
+     * stays where it is */
+    if (NULL != m_filter_pool && NULL != m_filter) {
+        m_filter_job = m_filter_pool->submit(
+                reinterpret_cast<Filter *>(m_filter), m_lines,
+                onFilterComplete, this);
+        if (NULL != m_filter_job) {
+            m_filter_lines = lines;
+            m_filter_bytes = bytes;
+            return false;
+        }
+        /* the pool is busy, filter in the loop this time */
+    }
+
+    return sendLines(m_filter, lines, bytes);
+}/*}}}*/
+
+bool IOHandler::sendLines(void *filter, size_t lines, size_t bytes)
+{/*{{{*/
+    if (sendBatch(filter, m_lines, bytes)) {
+        m_batch_sizer.update(lines, bytes, getFileSize() - getFilePos()
+                + m_buffer_len, m_unsent_lines.empty());
+        m_max_line_at_once = m_batch_sizer.getSize();
+    }
+
+    return m_unsent_lines.empty();
+}/*}}}*/
+
+bool IOHandler::resendLines()
+{/*{{{*/
+    vector<LineSlice> lines;
+    lines.swap(m_unsent_lines);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        bytes += lines[i].length();
+    }
+
+    /* the lines are filtered already, sampling and the stats of the
+     * filters see each line once */
+    sendBatch(NULL, lines, bytes);
+
+    return m_unsent_lines.empty();
+}/*}}}*/
+
+bool IOHandler::sendBatch(void *filter, vector<LineSlice> &lines,
+        size_t bytes)
+{/*{{{*/
+    DeliveryBatch *batch = NULL;
+    if (NULL != m_tracker) {
+        batch = m_tracker->begin();
+    }
+
+    vector<LineSlice> unsent_lines;
+    if (!(*m_receive_func)(filter, m_output, lines, unsent_lines, batch)) {
+        if (NULL != m_tracker) {
+            m_tracker->end(-1, 0);
+        }
+
+        /* nothing is sent, the lines are filtered already */
+        m_unsent_lines.insert(m_unsent_lines.end(), lines.begin(),
+                lines.end());
+        lines.clear();
+        return false;
+    }
+
+    /* the batch ends before the lines not sent yet, they are sent with
+     * a later one */
+    off_t pos = getCommitPos();
+    off_t batch_pos = pos;
+    size_t unsent_bytes = 0;
+    for (size_t i = 0; i < unsent_lines.size(); ++i) {
+        batch_pos = min(batch_pos, unsent_lines[i].offset());
+        unsent_bytes += unsent_lines[i].length();
+    }
+    if (!m_unsent_lines.empty()) {
+        batch_pos = min(batch_pos, m_unsent_lines.front().offset());
+    }
+    if (&lines != &m_lines && !m_lines.empty()) {
+        batch_pos = min(batch_pos, m_lines.front().offset());
+    }
+
+    if (NULL != m_tracker) {
+        m_tracker->end(batch_pos, bytes > unsent_bytes?
+                bytes - unsent_bytes: 0);
+    } else {
+        persistPos(pos);
+    }
+
+    /* the references of sent lines are dropped here */
+    lines.clear();
+    m_unsent_lines.insert(m_unsent_lines.end(), unsent_lines.begin(),
+            unsent_lines.end());
+
+    return true;
+}/*}}}*/
+
+void IOHandler::onFilterComplete(void *arg, vector<LineSlice> &lines)
+{/*{{{*/
+    IOHandler *ioh = reinterpret_cast<IOHandler *>(arg);
+
+    ioh->m_filter_job->unref();
+    ioh->m_filter_job = NULL;
+    ioh->m_lines.swap(lines);
+
+    /* the lines are filtered already, unsent lines wait for the next
+     * notify as they do without the pool */
+    if (ioh->sendLines(NULL, ioh->m_filter_lines, ioh->m_filter_bytes)) {
+        onNotify(ioh);
+    }
+}/*}}}*/
+
+void IOHandler::finishFilter()
+{/*{{{*/
+    if (NULL == m_filter_job) {
+        return;
+    }
+
+    m_filter_pool->finish(m_filter_job, m_lines);
+    m_filter_job->unref();
+    m_filter_job = NULL;
+
+    sendLines(NULL, m_filter_lines, m_filter_bytes);
+}/*}}}*/
+
+void IOHandler::cancelFilter()
+{/*{{{*/
+    if (NULL != m_filter_job) {
+        m_filter_pool->cancel(m_filter_job);
+        m_filter_job->unref();
+        m_filter_job = NULL;
+    }
+}/*}}}*/
+
+size_t IOHandler::getBufferRoom()
+{/*{{{*/
+    m_ring->reclaim();
+
+    /* the pending record may fill up the ring, the rest of it
+     * can not be read then */
+    if (0 == m_ring->room() && NULL != m_assembler
+            && m_assembler->hasPending()) {
+        m_assembler->detach();
+        m_ring->reclaim();
+    }
+
+    /* the unsplit data never exceeds m_buffer_max_bytes, if the ring is
+     * filled up by lines in use, we just read less */
+    if (m_buffer_len >= m_buffer_max_bytes) {
+        return 0;
+    }
+
+    return min(m_ring->room(), (size_t)(m_buffer_max_bytes - m_buffer_len));
+}/*}}}*/
+
+void IOHandler::consumeBuffer(size_t len, RingBuffer::Segment *segment)
+{/*{{{*/
+    m_buffer_start += len;
+    m_buffer_len -= len;
+
+    /* the segment only covers the consumed data, the lines cut from it
+     * hold the references now */
+    segment->setEnd(m_buffer_start);
+    segment->unref();
+}/*}}}*/
+
+bool IOHandler::readBuffer(size_t &read_len)
+{/*{{{*/
+    read_len = 0;
+
+    if (m_read_ready) {
+        m_read_ready = false;
+        if (m_read_result < 0) {
+            LERROR << "Fail to read from fd " << m_fd
+                   << ", " << strerror(-m_read_result);
+            return true;
+        }
+        read_len = m_read_result;
+    } else {
+        size_t room = getBufferRoom();
+        if (0 == room) {
+            return true;
+        }
+
+        /* the ring is double mapped, the free space is
+         * contiguous even if it wraps around */
+        char *buffer_end = m_ring->at(m_ring->head());
+
+        bool backfilling = isBackfilling();
+        if (!backfilling) {
+            closeDirect();
+        }
+
+        if (NULL != m_engine && !backfilling) {
+            m_read_request = m_engine->read(m_fd, buffer_end, room,
+                    m_file_pos, m_ring, onReadComplete, this);
+            if (NULL != m_read_request) {
+                return false;
+            }
+            /* the engine is busy, read synchronously this time */
+        }
+
+        ssize_t n = 0;
+        if (backfilling && openDirect()) {
+            n = readDirect(buffer_end, room);
+        } else {
+            do {
+                n = pread(m_fd, buffer_end, room, m_file_pos);
+            } while (-1 == n && EINTR == errno);
+        }
+
+        if (n < 0) {
+            LERROR << "Fail to read from fd " << m_fd
+                   << ", " << strerror(errno);
+            return true;
+        }
+        read_len = n;
+    }
+
+    m_file_pos += read_len;
+    m_ring->produce(read_len);
+    m_buffer_len += read_len;
+
+    return true;
+}/*}}}*/
+
+void IOHandler::onReadComplete(void *arg, int res, const UringRequest *req)
+{/*{{{*/
+    IOHandler *ioh = reinterpret_cast<IOHandler *>(arg);
+
+    ioh->m_read_request = NULL;
+    ioh->m_read_ready = true;
+    ioh->m_read_result = res;
+
+    onNotify(ioh);
+}/*}}}*/
+
+void IOHandler::cancelRead()
+{/*{{{*/
+    if (NULL != m_read_request) {
+        m_engine->cancel(m_read_request);
+        m_read_request = NULL;
+    }
+    m_read_ready = false;
+}/*}}}*/
+
+bool IOHandler::readMapped(size_t &read_len)
+{/*{{{*/
+    /* the unsplit data in ring buffer and the completed read go first */
+    if (0 == m_mmap_min_bytes || 0 != m_buffer_len || m_read_ready) {
+        return false;
+    }
+
+    if (!m_file_stat_valid) {
+        return false;
+    }
+
+    /* the backfill does not go through page cache at all */
+    if (isBackfilling()) {
+        return false;
+    }
+
+    off_t pos = m_file_pos;
+    off_t fsize = m_file_stat.st_size;
+
+    /* not far behind (or truncated), the streaming reader is cheaper */
+    if (fsize - pos < (off_t)m_mmap_min_bytes) {
+        return false;
+    }
+
+    size_t page_size = MmapWindow::getPageSize();
+    off_t offset = pos / page_size * page_size;
+    size_t len = min((off_t)m_mmap_window_bytes, fsize - offset);
+
+    MmapWindow *window = MmapWindow::create(m_fd, offset, len);
+    if (NULL == window) {
+        return false;
+    }
+
+    LDEBUG << "Split mapped file, fd: " << m_fd
+           << ", pos: " << pos << ", length: " << len;
+
+    size_t cur_buf_pos = pos - offset;
+    splitBuffer(window->data(), window->length(), offset, cur_buf_pos, window);
+    window->unref();
+
+    /* the partial line at the end of window is read again later */
+    read_len = cur_buf_pos - (pos - offset);
+    m_file_pos = pos + read_len;
+
+    return true;
+}/*}}}*/
+
+bool IOHandler::isBackfilling()
+{/*{{{*/
+    return 0 != m_direct_min_bytes && m_file_stat_valid
+        && m_file_stat.st_size - m_file_pos >= (off_t)m_direct_min_bytes;
+}/*}}}*/
+
+bool IOHandler::openDirect()
+{/*{{{*/
+    if (-1 != m_direct_fd) {
+        return true;
+    }
+
+#ifdef O_DIRECT
+    if (NULL == m_direct_buffer) {
+        /* one more block for the unaligned head of read */
+        size_t bytes = (m_buffer_max_bytes + DIRECT_IO_ALIGN_BYTES - 1)
+            / DIRECT_IO_ALIGN_BYTES * DIRECT_IO_ALIGN_BYTES + DIRECT_IO_ALIGN_BYTES;
+        void *buf = NULL;
+        if (0 != posix_memalign(&buf, DIRECT_IO_ALIGN_BYTES, bytes)) {
+            LERROR << "Fail to allocate direct io buffer of " << bytes << " bytes";
+            m_direct_min_bytes = 0;
+            return false;
+        }
+        m_direct_buffer = (char *)buf;
+        m_direct_buffer_bytes = bytes;
+    }
+
+    /* reopen through procfs, it is the same inode even if the file has
+     * been renamed or unlinked by rotation */
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", m_fd);
+    m_direct_fd = open(path, O_RDONLY | O_DIRECT);
+    if (-1 != m_direct_fd) {
+        LINFO << "Backfill with direct io, fd: " << m_fd
+              << ", pos: " << m_file_pos
+              << ", size: " << getFileSize();
+        return true;
+    }
+
+    LWARNING << "Fail to open fd " << m_fd << " with O_DIRECT, "
+             << strerror(errno) << ", backfill through page cache";
+#endif
+
+    /* e.g. tmpfs does not support O_DIRECT, do not try again */
+    m_direct_min_bytes = 0;
+    return false;
+}/*}}}*/
+
+void IOHandler::closeDirect()
+{/*{{{*/
+    if (-1 != m_direct_fd) {
+        ::close(m_direct_fd);
+        m_direct_fd = -1;
+    }
+}/*}}}*/
+
+ssize_t IOHandler::readDirect(char *buf, size_t len)
+{/*{{{*/
+    /* offset, length and buffer of O_DIRECT read should be aligned,
+     * read the enclosing blocks and copy the wanted part */
+    off_t offset = m_file_pos / DIRECT_IO_ALIGN_BYTES * DIRECT_IO_ALIGN_BYTES;
+    size_t head = m_file_pos - offset;
+    size_t n_read = min(m_direct_buffer_bytes,
+            (head + len + DIRECT_IO_ALIGN_BYTES - 1)
+            / DIRECT_IO_ALIGN_BYTES * DIRECT_IO_ALIGN_BYTES);
+
+    ssize_t n = 0;
+    do {
+        n = pread(m_direct_fd, m_direct_buffer, n_read, offset);
+    } while (-1 == n && EINTR == errno);
+
+    if (n < 0) {
+        return n;
+    }
+
+    if ((size_t)n <= head) {
+        return 0;
+    }
+
+    size_t copied = min(len, (size_t)n - head);
+    memcpy(buf, m_direct_buffer + head, copied);
+
+    return copied;
+}/*}}}*/
+
+void IOHandler::adviseDontNeed(off_t pos)
+{/*{{{*/
+    if (!m_pagecache_dontneed || -1 == m_fd) {
+        return;
+    }
+
+    /* pos is the one written to the position entry, only whole pages
+     * before it are dropped, the partial page at the end is dropped with
+     * the next commit */
+    size_t page_size = MmapWindow::getPageSize();
+    off_t end = pos / page_size * page_size;
+    if (end <= m_advised_pos) {
+        return;
+    }
+
+    int err = posix_fadvise(m_fd, m_advised_pos, end - m_advised_pos,
+            POSIX_FADV_DONTNEED);
+    if (0 != err) {
+        LWARNING << "Fail to drop page cache of fd " << m_fd
+                 << ", " << strerror(err);
+    }
+    m_advised_pos = end;
+}/*}}}*/
+
+void IOHandler::onCommit(void *arg, off_t pos)
+{/*{{{*/
+    IOHandler *ioh = reinterpret_cast<IOHandler *>(arg);
+    ioh->adviseDontNeed(pos);
+}/*}}}*/
+
+void IOHandler::flushRecord(bool update_pos)
+{/*{{{*/
+    /* the position entry has been taken over by another file */
+    if (!update_pos && NULL != m_tracker) {
+        m_tracker->close();
+    }
+
+    /* the lines in flight are sent before the file is left */
+    finishFilter();
+    if (!m_unsent_lines.empty()) {
+        resendLines();
+    }
+
+    if (NULL == m_assembler) {
+        return;
+    }
+
+    assembleLines();
+    if (!m_assembler->flush(m_lines, true)) {
+        return;
+    }
+
+    DeliveryBatch *batch = NULL;
+    if (NULL != m_tracker) {
+        batch = m_tracker->begin();
+    }
+
+    vector<LineSlice> unsent_lines;
+    bool sent = (*m_receive_func)(m_filter, m_output, m_lines, unsent_lines,
+            batch);
+    if (NULL != m_tracker) {
+        m_tracker->end(sent && unsent_lines.empty() && m_unsent_lines.empty()?
+                getCommitPos(): -1, 0);
+    } else if (sent && update_pos) {
+        persistPos(getCommitPos());
+    }
+
+    if (sent) {
+        m_lines.clear();
+        m_unsent_lines.insert(m_unsent_lines.end(), unsent_lines.begin(),
+                unsent_lines.end());
+    }
+}/*}}}*/
+
+void IOHandler::assembleLines()
+{/*{{{*/
+    if (NULL == m_assembler || m_line_offsets.empty()) {
+        return;
+    }
+
+    m_assembler->assemble(m_lines, m_line_offsets,
+            m_lines.size() - m_line_offsets.size());
+    m_line_offsets.clear();
+}/*}}}*/
+
+void IOHandler::commitPos(off_t pos)
+{/*{{{*/
+    if (NULL != m_tracker) {
+        m_tracker->skip(pos);
+    } else {
+        persistPos(pos);
+    }
+}/*}}}*/
+
+void IOHandler::persistPos(off_t pos)
+{/*{{{*/
+    m_position_entry->updatePos(pos);
+    adviseDontNeed(pos);
+}/*}}}*/
+
+bool IOHandler::isSendPaused()
+{/*{{{*/
+    off_t pos = 0;
+    return m_output_paused || (NULL != m_tracker
+        && (m_tracker->isFull() || m_tracker->needRewind(pos)));
+}/*}}}*/
+
+void IOHandler::rewind(off_t pos)
+{/*{{{*/
+    LWARNING << "Read fd " << m_fd << " again from " << pos;
+
+    /* the lines after pos, the completed read and the unsplit data
+     * are all dropped */
+    m_lines.clear();
+    m_unsent_lines.clear();
+    m_line_offsets.clear();
+    if (NULL != m_assembler) {
+        m_assembler->reset();
+    }
+    m_read_ready = false;
+    if (0 != m_buffer_len) {
+        RingBuffer::Segment *segment = m_ring->acquire(
+                m_buffer_start + m_buffer_len);
+        consumeBuffer(m_buffer_len, segment);
+    }
+    m_frame_left = 0;
+    m_file_pos = pos;
+
+    /* the pages after pos may be read again, drop them once committed */
+    size_t page_size = MmapWindow::getPageSize();
+    m_advised_pos = min(m_advised_pos, (off_t)(pos / page_size * page_size));
+
+    m_tracker->rewind();
+}/*}}}*/
+
+off_t IOHandler::getCommitPos()
+{/*{{{*/
+    off_t pos = getFilePos() - m_buffer_len;
+
+    /* the pending record is read again after restart */
+    if (NULL != m_assembler && m_assembler->hasPending()) {
+        pos = min(pos, m_assembler->getPendingOffset());
+    }
+
+    return pos;
+}/*}}}*/
+
+void IOHandler::addLine(const char *data, size_t len, RefCounted *owner,
+        off_t offset)
+{/*{{{*/
+    m_lines.push_back(LineSlice(data, len, owner, offset));
+    if (NULL != m_assembler) {
+        m_line_offsets.push_back(offset);
+    }
+}/*}}}*/
+
+bool IOHandler::splitBuffer(const char *buffer, size_t len, off_t buffer_offset,
+        size_t &cur_buf_pos, RefCounted *owner)
+{/*{{{*/
+    if (0 != m_length_prefix_bytes) {
+        return splitFrames(buffer, len, buffer_offset, cur_buf_pos, owner);
+    }
+
+    size_t delimiter_len = m_line_delimiter.length();
+    size_t cur = cur_buf_pos;
+    bool full = false;
+
+    while (!full && cur < len) {
+        /* the batch may have shrunk below the unsent lines */
+        if (m_lines.size() >= m_max_line_at_once) {
+            full = true;
+            break;
+        }
+        size_t room = m_max_line_at_once - m_lines.size();
+
+        size_t base = cur;
+        size_t scanned = 0;
+        size_t n = DelimiterScanner::scanString(buffer + base, len - base,
+                m_line_delimiter.data(), delimiter_len,
+                &m_delimiter_positions[0], room, &scanned);
+
+        for (size_t k = 0; k < n; ++k) {
+            size_t pos = base + m_delimiter_positions[k];
+
+            /* lines longer than m_line_max_bytes are split, but never
+             * inside the delimiter */
+            while (pos + 1 - cur >= m_line_max_bytes + delimiter_len) {
+                if (m_lines.size() >= m_max_line_at_once) {
+                    full = true;
+                    break;
+                }
+                addLine(buffer + cur, m_line_max_bytes, owner,
+                        buffer_offset + cur);
+                cur += m_line_max_bytes;
+            }
+
+            if (full || m_lines.size() >= m_max_line_at_once) {
+                full = true;
+                break;
+            }
+
+            /* pos is the last byte of delimiter */
+            size_t cur_line_len = pos + 1 - cur;
+            if (m_remove_delimiter) {
+                cur_line_len -= delimiter_len;
+            }
+
+            addLine(buffer + cur, cur_line_len, owner, buffer_offset + cur);
+            cur = pos + 1;
+        }
+
+        if (full) break;
+
+        /* the scanning was stopped by the room limit */
+        if (base + scanned < len) continue;
+
+        /* no delimiter in the rest of buffer, keep the tail which may
+         * be the beginning of a delimiter */
+        size_t tail = min(delimiter_len - 1, len - cur);
+        while (tail > 0 && 0 != memcmp(buffer + len - tail,
+                    m_line_delimiter.data(), tail)) {
+            --tail;
+        }
+        while (len - tail - cur >= m_line_max_bytes) {
+            if (m_lines.size() >= m_max_line_at_once) {
+                full = true;
+                break;
+            }
+            addLine(buffer + cur, m_line_max_bytes, owner,
+                    buffer_offset + cur);
+            cur += m_line_max_bytes;
+        }
+
+        break;
+    }
+
+    cur_buf_pos = cur;
+
+    /* the line batch is full, but there is still data left in buffer */
+    return full || (cur < len && m_lines.size() >= m_max_line_at_once);
+}/*}}}*/
+
+bool IOHandler::splitFrames(const char *buffer, size_t len, off_t buffer_offset,
+        size_t &cur_buf_pos, RefCounted *owner)
+{/*{{{*/
+    size_t cur = cur_buf_pos;
+    bool full = false;
+
+    while (cur < len) {
+        if (m_lines.size() >= m_max_line_at_once) {
+            full = true;
+            break;
+        }
+
+        if (0 != m_frame_left) {
+            size_t n = min(m_frame_left, (size_t)m_line_max_bytes);
+            if (len - cur < n) break;
+            addLine(buffer + cur, n, owner, buffer_offset + cur);
+            cur += n;
+            m_frame_left -= n;
+            continue;
+        }
+
+        if (len - cur < m_length_prefix_bytes) break;
+
+        uint64_t frame_len = 0;
+        for (size_t k = 0; k < m_length_prefix_bytes; ++k) {
+            frame_len = (frame_len << 8) | (unsigned char)buffer[cur + k];
+        }
+
+        if (frame_len > m_line_max_bytes) {
+            LWARNING << "Frame of " << frame_len << " bytes at offset "
+                     << buffer_offset + cur << " is split";
+            cur += m_length_prefix_bytes;
+            m_frame_left = frame_len;
+            continue;
+        }
+
+        if (len - cur - m_length_prefix_bytes < frame_len) break;
+
+        addLine(buffer + cur + m_length_prefix_bytes, frame_len, owner,
+                buffer_offset + cur);
+        cur += m_length_prefix_bytes + frame_len;
+    }
+
+    cur_buf_pos = cur;
+
+    return full || (cur < len && m_lines.size() >= m_max_line_at_once);
+}/*}}}*/
+
 void IOHandler::updateLastIOTime()
 {/*{{{*/
     if (0 == pthread_mutex_trylock(&m_last_io_time_mutex.mutex())) {
@@ -309,45 +1093,63 @@ bool IOHandler::isBufferStuck()
 
 void IOHandler::close()
 {/*{{{*/
+    /* the lines in flight are read again if the file is watched again */
+    if (NULL != m_tracker) {
+        m_tracker->close();
+    }
+
+    cancelRead();
+    cancelFilter();
+    closeDirect();
+
     if (0 == pthread_mutex_lock(&m_file_mutex.mutex())) {
         if (NULL != m_file) {
             LINFO << "Closing file"
-                   << ", fd: " << fileno(m_file)
-                   << ", inode: " << getInode(m_file);
+                   << ", fd: " << m_fd
+                   << ", inode: " << getFileInode();
             fclose(m_file); m_file = NULL;
+            m_fd = -1;
+            m_file_stat_valid = false;
         }
         pthread_mutex_unlock(&m_file_mutex.mutex());
     }
 }/*}}}*/
 
+void IOHandler::refreshFileStat()
+{/*{{{*/
+    m_file_stat_valid = (-1 != m_fd && 0 == fstat(m_fd, &m_file_stat));
+}/*}}}*/
+
 long IOHandler::getFileInode()
 {/*{{{*/
-    long inode = INO_NONE;
-    if (0 == pthread_mutex_lock(&m_file_mutex.mutex())) {
-        inode = (NULL != m_file)? getInode(m_file): inode;
-        pthread_mutex_unlock(&m_file_mutex.mutex());
-    }
-    return inode;
+    return m_file_stat_valid? m_file_stat.st_ino: INO_NONE;
 }/*}}}*/
 
 long IOHandler::getFileSize()
 {/*{{{*/
-    long fsize = 0;
-    if (0 == pthread_mutex_lock(&m_file_mutex.mutex())) {
-        fsize = (NULL != m_file)? getFsize(m_file): fsize;
-        pthread_mutex_unlock(&m_file_mutex.mutex());
-    }
-    return fsize;
+    return m_file_stat_valid? m_file_stat.st_size: 0;
 }/*}}}*/
 
 long IOHandler::getFilePos()
 {/*{{{*/
-    long fpos = 0;
-    if (0 == pthread_mutex_lock(&m_file_mutex.mutex())) {
-        fpos = (NULL != m_file)? ftell(m_file): fpos;
-        pthread_mutex_unlock(&m_file_mutex.mutex());
+    return (-1 != m_fd)? m_file_pos: 0;
+}/*}}}*/
+
+long IOHandler::getPageCacheBytes()
+{/*{{{*/
+    if (-1 == m_fd) return 0;
+
+    /* the state is uploaded often, only the pages from the committed
+     * position to a little past the read position are counted */
+    off_t start = getCommitPos();
+    if (NULL != m_tracker) {
+        start = min(start, m_tracker->getCommitPos());
     }
-    return fpos;
+    off_t end = min((off_t)getFileSize(),
+            getFilePos() + PAGECACHE_SCAN_AHEAD_BYTES);
+    start = max(start, end - PAGECACHE_SCAN_MAX_BYTES);
+
+    return ::getPageCacheBytes(m_fd, start, end - start);
 }/*}}}*/
 
 } // namespace logkafka
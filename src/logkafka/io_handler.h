@@ -22,6 +22,7 @@
 #ifndef LOGKAFKA_IO_HANDLER_H_
 #define LOGKAFKA_IO_HANDLER_H_
 
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -30,10 +31,20 @@
 #include <vector>
 
 #include "base/common.h"
+#include "base/delimiter_scanner.h"
+#include "base/mmap_window.h"
 #include "base/mutex.h"
+#include "base/ring_buffer.h"
 #include "base/scoped_lock.h"
 #include "base/tools.h"
+#include "logkafka/batch_sizer.h"
+#include "logkafka/delivery_tracker.h"
+#include "logkafka/filter_pool.h"
+#include "logkafka/line_slice.h"
 #include "logkafka/position_entry.h"
+#include "logkafka/record_assembler.h"
+#include "logkafka/task_conf.h"
+#include "logkafka/uring_engine.h"
 
 #include "easylogging/easylogging++.h"
 
@@ -42,9 +53,12 @@ using namespace base;
 
 namespace logkafka {
 
+/* NOTE: the receive function may drop lines from the line vector in place,
+ * the queued messages are added to the delivery batch if it is not NULL */
 typedef bool (*ReceiveFunc)(void *, 
-        void *, const vector<string> &, 
-        vector<string> &);
+        void *, vector<LineSlice> &, 
+        vector<LineSlice> &,
+        DeliveryBatch *);
 
 class IOHandler
 {
@@ -54,45 +68,152 @@ class IOHandler
         bool init(FILE *file,
                   PositionEntry *position_entry,
                   unsigned int max_line_at_once,
+                  unsigned int batch_min_lines,
+                  unsigned int batch_max_lines,
                   unsigned int line_max_bytes,
                   unsigned int read_max_bytes,
-                  char line_delimiter,
+                  unsigned long mmap_min_bytes,
+                  unsigned long direct_min_bytes,
+                  bool pagecache_dontneed,
+                  const string &line_delimiter,
                   bool remove_delimiter,
+                  unsigned int length_prefix_bytes,
+                  const MultilineConf &multiline_conf,
                   void *filter,
                   void *output,
-                  ReceiveFunc receiveLines);
+                  ReceiveFunc receiveLines,
+                  UringEngine *engine = NULL,
+                  FilterPool *filter_pool = NULL,
+                  unsigned long max_inflight_bytes = 0);
         void close();
         static void onNotify(void *arg);
+        /* send the pending multi-line record, e.g. before rotation */
+        void flushRecord(bool update_pos);
         bool getLastIOTime(struct timeval &tv);
+        /* NOTE: the file info is cached, it is refreshed on each notify */
         long getFileInode();
         long getFileSize();
         long getFilePos();
+        /* bytes cached from the committed position to a little past
+         * the read position, not over the whole file */
+        long getPageCacheBytes();
+        unsigned int getBatchSize() { return m_max_line_at_once; };
+        /* no lines are read or sent while the output is paused */
+        void setOutputPaused(bool paused) { m_output_paused = paused; };
 
     public:
         FILE *m_file;
         PositionEntry *m_position_entry;
 
     private:
+        char *getBuffer() { return m_ring->at(m_buffer_start); };
+        size_t getBufferRoom();
+        void consumeBuffer(size_t len, RingBuffer::Segment *segment);
+        void refreshFileStat();
+        bool readBuffer(size_t &read_len);
+        static void onReadComplete(void *arg, int res, const UringRequest *req);
+        void cancelRead();
+        static void onFilterComplete(void *arg, vector<LineSlice> &lines);
+        void finishFilter();
+        void cancelFilter();
+        bool readMapped(size_t &read_len);
+        bool isBackfilling();
+        bool openDirect();
+        void closeDirect();
+        ssize_t readDirect(char *buf, size_t len);
+        void adviseDontNeed(off_t pos);
+        static void onCommit(void *arg, off_t pos);
+        bool splitBuffer(const char *buffer, size_t len, off_t buffer_offset,
+                size_t &cur_buf_pos, RefCounted *owner);
+        bool splitFrames(const char *buffer, size_t len, off_t buffer_offset,
+                size_t &cur_buf_pos, RefCounted *owner);
+        void addLine(const char *data, size_t len, RefCounted *owner,
+                off_t offset);
+        void assembleLines();
+        off_t getCommitPos();
+        void commitPos(off_t pos);
+        /* write pos to the position entry and drop the pages before it */
+        void persistPos(off_t pos);
+        bool isSendPaused();
+        void rewind(off_t pos);
+        bool receiveLines();
+        bool sendLines(void *filter, size_t lines, size_t bytes);
+        bool resendLines();
+        bool sendBatch(void *filter, vector<LineSlice> &lines, size_t bytes);
         void updateLastIOTime();
         bool getLastBufferStuckTime(struct timeval &tv);
         void updateLastBufferStuckTime();
         bool isBufferStuck();
 
     private:
+        /* the current batch size, adjusted by m_batch_sizer */
         unsigned int m_max_line_at_once;
+        BatchSizer m_batch_sizer;
         unsigned int m_line_max_bytes;
         unsigned int m_buffer_max_bytes;
         unsigned long m_buffer_stuck_max_ms;
+        unsigned long m_mmap_min_bytes;
+        unsigned long m_mmap_window_bytes;
+        unsigned long m_direct_min_bytes;
+        bool m_pagecache_dontneed;
         bool m_buffer_last_segment;
         ReceiveFunc m_receive_func;
         void *m_filter;
         void *m_output;
 
-        char *m_buffer;
+        int m_fd;
+        off_t m_file_pos;
+        struct stat m_file_stat;
+        bool m_file_stat_valid;
+
+        /* pages before m_advised_pos have been dropped from page cache */
+        off_t m_advised_pos;
+
+        /* O_DIRECT descriptor of the same file, only open while backfilling */
+        int m_direct_fd;
+        char *m_direct_buffer;
+        size_t m_direct_buffer_bytes;
+
+        /* asynchronous read, NULL engine for synchronous pread */
+        UringEngine *m_engine;
+        UringRequest *m_read_request;
+        bool m_read_ready;
+        int m_read_result;
+
+        /* filtering on the worker pool, NULL pool for filtering in the
+         * loop, m_lines is empty while m_filter_job is in flight */
+        FilterPool *m_filter_pool;
+        FilterJob *m_filter_job;
+        size_t m_filter_lines;
+        size_t m_filter_bytes;
+
+        /* the position is committed once the lines are delivered, NULL
+         * for committing it once they are queued */
+        DeliveryTracker *m_tracker;
+        bool m_output_paused;
+
+        RingBuffer *m_ring;
+        uint64_t m_buffer_start;
         size_t m_buffer_len;
-        char m_line_delimiter;
+        string m_line_delimiter;
         bool m_remove_delimiter;
-        vector<string> m_lines;
+
+        /* length-prefixed framing if not 0, the length is big-endian,
+         * frames longer than m_line_max_bytes are split, m_frame_left
+         * is the length of the rest of such a frame */
+        unsigned int m_length_prefix_bytes;
+        size_t m_frame_left;
+        vector<LineSlice> m_lines;
+        /* the lines filtered but not taken by the output, they are sent
+         * again as they are before any line of m_lines */
+        vector<LineSlice> m_unsent_lines;
+        vector<size_t> m_delimiter_positions;
+
+        /* NULL if the lines are not joined into multi-line records,
+         * otherwise m_line_offsets holds the file offsets of the lines
+         * at the end of m_lines which are not assembled yet */
+        RecordAssembler *m_assembler;
+        vector<off_t> m_line_offsets;
 
         struct timeval m_last_io_time;
         struct timeval m_last_buffer_stuck_time;
@@ -100,6 +221,11 @@ class IOHandler
         Mutex m_last_io_time_mutex;
         Mutex m_last_buffer_stuck_time_mutex;
         Mutex m_file_mutex;
+
+        static const unsigned long MMAP_WINDOW_DEFAULT_BYTES;
+        static const size_t DIRECT_IO_ALIGN_BYTES;
+        static const off_t PAGECACHE_SCAN_AHEAD_BYTES;
+        static const off_t PAGECACHE_SCAN_MAX_BYTES;
 };
 
 } // namespace logkafka
@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/key_extractor.h"
+
+#include <string.h>
+
+namespace logkafka {
+
+static const char *skipSpace(const char *p, const char *end)
+{/*{{{*/
+    while (p < end && (' ' == *p || '\t' == *p || '\r' == *p || '\n' == *p)) {
+        ++p;
+    }
+    return p;
+}/*}}}*/
+
+/* p is at the opening quote, the end of the string is returned */
+static const char *skipString(const char *p, const char *end)
+{/*{{{*/
+    for (++p; p < end; ++p) {
+        if ('\\' == *p) {
+            ++p;
+        } else if ('"' == *p) {
+            return p + 1;
+        }
+    }
+    return NULL;
+}/*}}}*/
+
+/* p is at the first char of a value, the end of the value is returned */
+static const char *skipValue(const char *p, const char *end)
+{/*{{{*/
+    if (p >= end) return NULL;
+
+    if ('"' == *p) return skipString(p, end);
+
+    if ('{' == *p || '[' == *p) {
+        int depth = 0;
+        while (p < end) {
+            if ('"' == *p) {
+                p = skipString(p, end);
+                if (NULL == p) return NULL;
+                continue;
+            }
+            if ('{' == *p || '[' == *p) {
+                ++depth;
+            } else if ('}' == *p || ']' == *p) {
+                if (0 == --depth) return p + 1;
+            }
+            ++p;
+        }
+        return NULL;
+    }
+
+    /* number, true, false or null */
+    const char *begin = p;
+    while (p < end && ',' != *p && '}' != *p && ']' != *p &&
+            ' ' != *p && '\t' != *p && '\r' != *p && '\n' != *p) {
+        ++p;
+    }
+    return p == begin? NULL: p;
+}/*}}}*/
+
+KeyExtractor::KeyExtractor()
+{/*{{{*/
+    m_type = KEY_NONE;
+    m_regex = NULL;
+    m_field = 0;
+}/*}}}*/
+
+KeyExtractor::~KeyExtractor()
+{/*{{{*/
+    delete m_regex; m_regex = NULL;
+}/*}}}*/
+
+bool KeyExtractor::init(const KafkaTopicConf &kafka_topic_conf)
+{/*{{{*/
+    m_type = KEY_NONE;
+    delete m_regex; m_regex = NULL;
+    m_json_path.clear();
+
+    if (kafka_topic_conf.key_pattern != "") {
+        m_regex = new Regex();
+        if (!m_regex->init(kafka_topic_conf.key_pattern)) {
+            LERROR << "Fail to init key pattern " << kafka_topic_conf.key_pattern;
+            delete m_regex; m_regex = NULL;
+            return false;
+        }
+        m_type = KEY_PATTERN;
+    } else if (kafka_topic_conf.key_field > 0) {
+        if (kafka_topic_conf.key_field_delimiter.empty()) {
+            LERROR << "Key field delimiter is empty";
+            return false;
+        }
+        m_field = kafka_topic_conf.key_field;
+        m_field_delimiter = kafka_topic_conf.key_field_delimiter;
+        m_type = KEY_FIELD;
+    } else if (kafka_topic_conf.key_json_field != "") {
+        const string &path = kafka_topic_conf.key_json_field;
+        size_t cur = 0;
+        while (true) {
+            size_t pos = path.find('.', cur);
+            if (string::npos == pos) pos = path.length();
+            if (pos == cur) {
+                LERROR << "Key json field " << path << " is illegal";
+                m_json_path.clear();
+                return false;
+            }
+            m_json_path.push_back(path.substr(cur, pos - cur));
+            if (pos == path.length()) break;
+            cur = pos + 1;
+        }
+        m_type = KEY_JSON_FIELD;
+    }
+
+    return true;
+}/*}}}*/
+
+bool KeyExtractor::extract(const char *data, size_t len,
+        const char **key, size_t *key_len)
+{/*{{{*/
+    bool found = false;
+
+    switch (m_type) {
+        case KEY_PATTERN:
+            found = m_regex->capture(data, len, key, key_len);
+            break;
+        case KEY_FIELD:
+            found = extractField(data, len, key, key_len);
+            break;
+        case KEY_JSON_FIELD:
+            found = extractJsonField(data, data + len, 0, key, key_len);
+            break;
+        default:
+            break;
+    }
+
+    return found && *key_len > 0;
+}/*}}}*/
+
+bool KeyExtractor::extractField(const char *data, size_t len,
+        const char **key, size_t *key_len) const
+{/*{{{*/
+    const char *p = data;
+    const char *end = data + len;
+    const char *delimiter = m_field_delimiter.data();
+    size_t delimiter_len = m_field_delimiter.length();
+
+    /* the fields are separated by each delimiter, as cut(1) does */
+    for (int i = 1; i < m_field; ++i) {
+        const char *pos = (const char *)memmem(p, end - p,
+                delimiter, delimiter_len);
+        if (NULL == pos) return false;
+        p = pos + delimiter_len;
+    }
+
+    const char *pos = (const char *)memmem(p, end - p,
+            delimiter, delimiter_len);
+    *key = p;
+    *key_len = (NULL == pos? end: pos) - p;
+
+    return true;
+}/*}}}*/
+
+bool KeyExtractor::extractJsonField(const char *begin, const char *end,
+        size_t depth, const char **key, size_t *key_len) const
+{/*{{{*/
+    const string &name = m_json_path[depth];
+
+    const char *p = skipSpace(begin, end);
+    if (p >= end || '{' != *p) return false;
+    ++p;
+
+    while (true) {
+        p = skipSpace(p, end);
+        if (p >= end || '"' != *p) return false;
+
+        const char *name_end = skipString(p, end);
+        if (NULL == name_end) return false;
+        const char *name_begin = p + 1;
+        size_t name_len = name_end - 1 - name_begin;
+
+        p = skipSpace(name_end, end);
+        if (p >= end || ':' != *p) return false;
+        p = skipSpace(p + 1, end);
+
+        const char *value_end = skipValue(p, end);
+        if (NULL == value_end) return false;
+
+        if (name_len == name.length() &&
+                0 == memcmp(name_begin, name.data(), name_len)) {
+            if (depth + 1 < m_json_path.size()) {
+                return extractJsonField(p, value_end, depth + 1, key, key_len);
+            }
+
+            if ('"' == *p) {
+                *key = p + 1;
+                *key_len = value_end - 1 - *key;
+            } else {
+                *key = p;
+                *key_len = value_end - p;
+            }
+            return true;
+        }
+
+        p = skipSpace(value_end, end);
+        if (p >= end || ',' != *p) return false;
+        ++p;
+    }
+}/*}}}*/
+
+} // namespace logkafka
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_KEY_EXTRACTOR_H_
+#define LOGKAFKA_KEY_EXTRACTOR_H_
+
+#include <string>
+#include <vector>
+
+#include "base/noncopyable.h"
+#include "logkafka/regex.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Take the message key out of a line, by the first capturing group of
+ * key_pattern, by the key_field-th (from 1) field separated by
+ * key_field_delimiter, or by the value of key_json_field, a dot
+ * separated path of object fields, e.g. "user.id".
+ *
+ * The key points into the line, nothing is allocated or copied. The
+ * value of a json string field is returned without its quotes and
+ * escapes are kept as is. Not thread-safe.
+ * */
+class KeyExtractor : base::noncopyable
+{
+    public:
+        KeyExtractor();
+        ~KeyExtractor();
+        bool init(const KafkaTopicConf &kafka_topic_conf);
+        bool isEnabled() const { return KEY_NONE != m_type; };
+
+        /* false if no key or an empty one is found */
+        bool extract(const char *data, size_t len,
+                const char **key, size_t *key_len);
+
+    private:
+        enum KeyType {
+            KEY_NONE,
+            KEY_PATTERN,
+            KEY_FIELD,
+            KEY_JSON_FIELD
+        };
+
+        bool extractField(const char *data, size_t len,
+                const char **key, size_t *key_len) const;
+        bool extractJsonField(const char *begin, const char *end,
+                size_t depth, const char **key, size_t *key_len) const;
+
+    private:
+        KeyType m_type;
+        Regex *m_regex;
+        int m_field;
+        string m_field_delimiter;
+        vector<string> m_json_path;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_KEY_EXTRACTOR_H_
@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_LINE_SLICE_H_
+#define LOGKAFKA_LINE_SLICE_H_
+
+#include <sys/types.h>
+
+#include <cstdlib>
+#include <ostream>
+#include <string>
+
+#include "base/ref_counted.h"
+
+using namespace std;
+using namespace base;
+
+namespace logkafka {
+
+/* One line of log file, points into the memory of its owner (e.g. the
+ * read chunk), no data is copied. Every slice holds one reference to the
+ * owner. The offset of the line in the file is kept along, -1 if unknown.
+ * */
+class LineSlice
+{
+    public:
+        LineSlice(): m_data(NULL), m_len(0), m_owner(NULL), m_offset(-1) {};
+
+        LineSlice(const char *data, size_t len, RefCounted *owner,
+                off_t offset = -1)
+            : m_data(data), m_len(len), m_owner(owner), m_offset(offset)
+        {/*{{{*/
+            if (NULL != m_owner) m_owner->ref();
+        }/*}}}*/
+
+        LineSlice(const LineSlice &ls)
+            : m_data(ls.m_data), m_len(ls.m_len), m_owner(ls.m_owner),
+            m_offset(ls.m_offset)
+        {/*{{{*/
+            if (NULL != m_owner) m_owner->ref();
+        }/*}}}*/
+
+        LineSlice(LineSlice &&ls)
+            : m_data(ls.m_data), m_len(ls.m_len), m_owner(ls.m_owner),
+            m_offset(ls.m_offset)
+        {/*{{{*/
+            ls.m_owner = NULL;
+        }/*}}}*/
+
+        ~LineSlice()
+        {/*{{{*/
+            if (NULL != m_owner) m_owner->unref();
+        }/*}}}*/
+
+        LineSlice &operator=(const LineSlice &ls)
+        {/*{{{*/
+            if (this != &ls) {
+                if (NULL != ls.m_owner) ls.m_owner->ref();
+                if (NULL != m_owner) m_owner->unref();
+                m_data = ls.m_data;
+                m_len = ls.m_len;
+                m_owner = ls.m_owner;
+                m_offset = ls.m_offset;
+            }
+            return *this;
+        }/*}}}*/
+
+        LineSlice &operator=(LineSlice &&ls)
+        {/*{{{*/
+            if (this != &ls) {
+                if (NULL != m_owner) m_owner->unref();
+                m_data = ls.m_data;
+                m_len = ls.m_len;
+                m_owner = ls.m_owner;
+                m_offset = ls.m_offset;
+                ls.m_owner = NULL;
+            }
+            return *this;
+        }/*}}}*/
+
+        const char *data() const { return m_data; };
+        size_t length() const { return m_len; };
+        bool empty() const { return 0 == m_len; };
+        RefCounted *owner() const { return m_owner; };
+        off_t offset() const { return m_offset; };
+        string str() const { return string(m_data, m_len); };
+
+        /* Take one more reference of the owner for the consumer which
+         * keeps the data pointer after the slice is gone (e.g. librdkafka),
+         * the consumer must unref it when done. */
+        RefCounted *refOwner() const
+        {/*{{{*/
+            if (NULL != m_owner) m_owner->ref();
+            return m_owner;
+        }/*}}}*/
+
+        friend ostream& operator << (ostream& os, const LineSlice& ls)
+        {/*{{{*/
+            os.write(ls.m_data, ls.m_len);
+            return os;
+        }/*}}}*/
+
+    private:
+        const char *m_data;
+        size_t m_len;
+        RefCounted *m_owner;
+        off_t m_offset;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_LINE_SLICE_H_
@@ -35,6 +35,8 @@ using namespace rapidjson;
 
 namespace logkafka {
 
+const int Manager::PRODUCER_FLUSH_MAX_MS = 10000;
+
 Manager::Manager(const Config *config)
     : m_config(config)
 {/*{{{*/
@@ -42,9 +44,15 @@ Manager::Manager(const Config *config)
     m_refresh_interval = config->refresh_interval;
     m_line_max_bytes = config->line_max_bytes;
     m_read_max_bytes = config->read_max_bytes;
+    m_mmap_min_bytes = config->mmap_min_bytes;
+    m_direct_io_min_bytes = config->direct_io_min_bytes;
+    m_pagecache_dontneed = config->pagecache_dontneed;
+    m_delivery_inflight_max_bytes = config->delivery_inflight_max_bytes;
     m_stat_silent_max_ms = config->stat_silent_max_ms;
 
     m_refresh_trigger = NULL;
+    m_uring_engine = NULL;
+    m_filter_pool = NULL;
     m_loop = NULL;
     m_pos_file = NULL;
     m_position_file = NULL;
@@ -80,6 +88,10 @@ Manager::~Manager()
     }
 
     OutputKafka::stopProducers();
+
+    /* all the requests are cancelled by the deleted watchers */
+    delete m_uring_engine; m_uring_engine = NULL;
+    delete m_filter_pool; m_filter_pool = NULL;
 }/*}}}*/
 
 bool Manager::init(uv_loop_t *loop)
@@ -88,6 +100,41 @@ bool Manager::init(uv_loop_t *loop)
 
     initKafkaConf();
     initZookeeper();
+    initUringEngine();
+    initFilterPool();
+
+    return true;
+}/*}}}*/
+
+bool Manager::initUringEngine()
+{/*{{{*/
+    if (m_config->io_engine != "uring") {
+        return true;
+    }
+
+    m_uring_engine = new UringEngine();
+    if (!m_uring_engine->init(m_loop, m_config->io_uring_entries)) {
+        LWARNING << "Fail to init io_uring engine, fall back to synchronous io";
+        delete m_uring_engine; m_uring_engine = NULL;
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+bool Manager::initFilterPool()
+{/*{{{*/
+    if (0 == m_config->filter_threads) {
+        return true;
+    }
+
+    m_filter_pool = new FilterPool();
+    if (!m_filter_pool->init(m_loop, m_config->filter_threads,
+                m_config->filter_queue_size)) {
+        LWARNING << "Fail to init filter pool, fall back to filtering in the loop";
+        delete m_filter_pool; m_filter_pool = NULL;
+        return false;
+    }
 
     return true;
 }/*}}}*/
@@ -97,6 +144,18 @@ bool Manager::initKafkaConf()
     m_kafka_conf.message_max_bytes = m_config->line_max_bytes + m_config->key_max_bytes;
     m_kafka_conf.message_send_max_retries = m_config->message_send_max_retries;
     m_kafka_conf.queue_buffering_max_messages = m_config->queue_buffering_max_messages;
+    m_kafka_conf.queue_high_watermark_bytes = m_config->queue_high_watermark_bytes;
+    m_kafka_conf.queue_low_watermark_bytes = m_config->queue_low_watermark_bytes;
+
+    map<string, ProducerPoolConf>::const_iterator iter;
+    for (iter = m_config->producer_pools.begin(); 
+            iter != m_config->producer_pools.end(); ++iter) {
+        KafkaConf kafka_conf = m_kafka_conf;
+        kafka_conf.queue_buffering_max_messages = iter->second.queue_buffering_max_messages;
+        kafka_conf.queue_high_watermark_bytes = iter->second.queue_high_watermark_bytes;
+        kafka_conf.queue_low_watermark_bytes = iter->second.queue_low_watermark_bytes;
+        m_pool_kafka_confs[iter->first] = kafka_conf;
+    }
 
     return true;
 }/*}}}*/
@@ -117,6 +176,121 @@ bool Manager::initZookeeper()
     return true;
 }/*}}}*/
 
+/* e.g. [{"action": "include", "pattern": "ERROR"},
+ *       {"action": "exclude", "patterns": ["DEBUG", "TRACE"]}] */
+void Manager::parseFilterStages(const string &json,
+        vector<FilterStageConf> &stages)
+{/*{{{*/
+    Document d;
+    d.Parse(json.c_str());
+    if (d.HasParseError() || !d.IsArray()) {
+        throw JsonErr("json string is not a valid array");
+    }
+
+    stages.clear();
+    for (SizeType i = 0; i < d.Size(); ++i) {
+        FilterStageConf stage;
+
+        string action;
+        Json::getValue(d[i], "action", action);
+        if ("include" == action) {
+            stage.include = true;
+        } else if ("exclude" != action) {
+            throw JsonErr("the action of stage " + int2Str(i)
+                    + " is neither include nor exclude");
+        }
+
+        Value::ConstMemberIterator itr = d[i].FindMember("pattern");
+        if (itr != d[i].MemberEnd()) {
+            string pattern;
+            Json::getValue(d[i], "pattern", pattern);
+            stage.patterns.push_back(pattern);
+        }
+
+        itr = d[i].FindMember("patterns");
+        if (itr != d[i].MemberEnd()) {
+            if (!itr->value.IsArray()) {
+                throw JsonErr("the patterns of stage " + int2Str(i)
+                        + " is not array");
+            }
+            for (SizeType k = 0; k < itr->value.Size(); ++k) {
+                if (!itr->value[k].IsString()) {
+                    throw JsonErr("the patterns of stage " + int2Str(i)
+                            + " has non-string item");
+                }
+                stage.patterns.push_back(itr->value[k].GetString());
+            }
+        }
+
+        stages.push_back(stage);
+    }
+}/*}}}*/
+
+void Manager::parseJsonPredicates(const string &json,
+        vector<JsonPredicateConf> &predicates)
+{/*{{{*/
+    Document d;
+    d.Parse(json.c_str());
+    if (d.HasParseError() || !d.IsArray()) {
+        throw JsonErr("json string is not a valid array");
+    }
+
+    predicates.clear();
+    for (SizeType i = 0; i < d.Size(); ++i) {
+        JsonPredicateConf predicate;
+        Json::getValue(d[i], "field", predicate.field);
+        Json::getValue(d[i], "op", predicate.op);
+
+        /* "value" for eq, ne and the compares, "values" for in */
+        Value::ConstMemberIterator itr = d[i].FindMember("value");
+        if (itr != d[i].MemberEnd()) {
+            predicate.values.push_back(Json::serialize(itr->value));
+        }
+
+        itr = d[i].FindMember("values");
+        if (itr != d[i].MemberEnd()) {
+            if (!itr->value.IsArray()) {
+                throw JsonErr("the values of predicate " + int2Str(i)
+                        + " is not array");
+            }
+            for (SizeType k = 0; k < itr->value.Size(); ++k) {
+                predicate.values.push_back(Json::serialize(itr->value[k]));
+            }
+        }
+
+        predicates.push_back(predicate);
+    }
+}/*}}}*/
+
+void Manager::parseFilterPlugins(const string &json,
+        vector<FilterPluginConf> &plugins)
+{/*{{{*/
+    Document d;
+    d.Parse(json.c_str());
+    if (d.HasParseError() || !d.IsArray()) {
+        throw JsonErr("json string is not a valid array");
+    }
+
+    plugins.clear();
+    for (SizeType i = 0; i < d.Size(); ++i) {
+        FilterPluginConf plugin;
+        Json::getValue(d[i], "path", plugin.path);
+
+        /* the args are optional */
+        Value::ConstMemberIterator itr = d[i].FindMember("args");
+        if (itr != d[i].MemberEnd()) {
+            if (!itr->value.IsString()) {
+                throw JsonErr("the args of plugin " + int2Str(i)
+                        + " is not string");
+            }
+            plugin.args.assign(itr->value.GetString(),
+                    itr->value.GetStringLength());
+        }
+
+        plugins.push_back(plugin);
+    }
+}/*}}}*/
+
 bool Manager::refreshTaskConfs()
 {/*{{{*/
     string config = m_zookeeper->getLogConfig();
@@ -194,12 +368,70 @@ bool Manager::refreshTaskConfs()
             }
         } catch(...) { /* default value */ }
 
+        try {
+            string batchsize_min;
+            Json::getValue(log_item, "batchsize_min", batchsize_min);
+            item.log_conf.batchsize_min = atoi(batchsize_min.c_str());
+        } catch(...) { /* default value */ }
+
+        try {
+            string batchsize_max;
+            Json::getValue(log_item, "batchsize_max", batchsize_max);
+            item.log_conf.batchsize_max = atoi(batchsize_max.c_str());
+        } catch(...) { /* default value */ }
+
+        if (item.log_conf.batchsize_min <= 0) {
+            item.log_conf.batchsize_min = item.log_conf.batchsize;
+        }
+        if (item.log_conf.batchsize_max <= 0) {
+            item.log_conf.batchsize_max = item.log_conf.batchsize;
+        }
+        if (item.log_conf.batchsize_max > (long)m_config->queue_buffering_max_messages) {
+            LWARNING << "The max batch size " << item.log_conf.batchsize_max
+                     << " is larger than queue size "
+                     << m_config->queue_buffering_max_messages
+                     << ", path pattern " << path_pattern;
+            item.log_conf.batchsize_max = m_config->queue_buffering_max_messages;
+        }
+        if (item.log_conf.batchsize_min > item.log_conf.batchsize_max) {
+            LWARNING << "The min batch size " << item.log_conf.batchsize_min
+                     << " is larger than max batch size "
+                     << item.log_conf.batchsize_max
+                     << ", path pattern " << path_pattern;
+            item.log_conf.batchsize_min = item.log_conf.batchsize_max;
+        }
+
         try {
             string line_delimiter;
             Json::getValue(log_item, "line_delimiter", line_delimiter);
-            item.log_conf.line_delimiter = atoi(line_delimiter.c_str());
+            item.log_conf.line_delimiter = string(1, (char)atoi(line_delimiter.c_str()));
+        } catch(...) { /* default value */ }
+
+        /* multi-byte delimiter, e.g. "0d0a" for "\r\n", overrides line_delimiter */
+        try {
+            string line_delimiter_hex;
+            Json::getValue(log_item, "line_delimiter_hex", line_delimiter_hex);
+            string line_delimiter;
+            if (!hexstr2bytes(line_delimiter_hex, line_delimiter)
+                    || line_delimiter.empty()) {
+                LWARNING << "The hex line delimiter " << line_delimiter_hex
+                         << " is illegal, path pattern " << path_pattern;
+            } else {
+                item.log_conf.line_delimiter = line_delimiter;
+            }
         } catch(...) { /* default value */ }
 
+        try {
+            string length_prefix_bytes;
+            Json::getValue(log_item, "length_prefix_bytes", length_prefix_bytes);
+            item.log_conf.length_prefix_bytes = atoi(length_prefix_bytes.c_str());
+        } catch(...) { /* default value */ }
+        if (!LogConf::isLengthPrefixBytesValid(item.log_conf.length_prefix_bytes)) {
+            LWARNING << "The length prefix bytes " << item.log_conf.length_prefix_bytes
+                     << " is illegal, path pattern " << path_pattern;
+            item.log_conf.length_prefix_bytes = 0;
+        }
+
         try {
             string remove_delimiter;
             Json::getValue(log_item, "remove_delimiter", remove_delimiter);
@@ -218,6 +450,55 @@ bool Manager::refreshTaskConfs()
             item.kafka_topic_conf.key = key;
         } catch(...) { /* default value */ }
 
+        try {
+            string key_pattern;
+            Json::getValue(log_item, "key_pattern", key_pattern);
+            item.kafka_topic_conf.key_pattern = key_pattern;
+        } catch(...) { /* default value */ }
+
+        try {
+            string key_field;
+            Json::getValue(log_item, "key_field", key_field);
+            item.kafka_topic_conf.key_field = atoi(key_field.c_str());
+        } catch(...) { /* default value */ }
+
+        try {
+            string key_field_delimiter;
+            Json::getValue(log_item, "key_field_delimiter", key_field_delimiter);
+            if (!key_field_delimiter.empty()) {
+                item.kafka_topic_conf.key_field_delimiter = key_field_delimiter;
+            }
+        } catch(...) { /* default value */ }
+
+        try {
+            string key_json_field;
+            Json::getValue(log_item, "key_json_field", key_json_field);
+            item.kafka_topic_conf.key_json_field = key_json_field;
+        } catch(...) { /* default value */ }
+
+        try {
+            string producer_pool;
+            Json::getValue(log_item, "producer_pool", producer_pool);
+            item.kafka_topic_conf.producer_pool = producer_pool;
+        } catch(...) { /* default value */ }
+
+        /* a named pool may have a smaller queue than the global one */
+        map<string, ProducerPoolConf>::const_iterator pool_iter =
+            m_config->producer_pools.find(item.kafka_topic_conf.producer_pool);
+        if (pool_iter != m_config->producer_pools.end()) {
+            int pool_max = (int)pool_iter->second.queue_buffering_max_messages;
+            if (item.log_conf.batchsize_max > pool_max) {
+                LWARNING << "The max batch size " << item.log_conf.batchsize_max
+                         << " is larger than queue.buffering.max.messages "
+                         << pool_max << " of producer pool "
+                         << pool_iter->first
+                         << ", path pattern " << path_pattern;
+                item.log_conf.batchsize_max = pool_max;
+            }
+            item.log_conf.batchsize = min(item.log_conf.batchsize, pool_max);
+            item.log_conf.batchsize_min = min(item.log_conf.batchsize_min, pool_max);
+        }
+
         try {
             string partition;
             Json::getValue(log_item, "partition", partition);
@@ -248,6 +529,146 @@ bool Manager::refreshTaskConfs()
             item.filter_conf.regex_filter_pattern = regex_filter_pattern;
         } catch(...) { /* default value */ }
 
+        try {
+            string regex_filter_patterns;
+            Json::getValue(log_item, "regex_filter_patterns", regex_filter_patterns);
+            if (!regex_filter_patterns.empty()) {
+                Json::parseStringArray(regex_filter_patterns,
+                        item.filter_conf.regex_filter_patterns);
+            }
+        } catch(const JsonErr &err) {
+            LWARNING << "The regex filter patterns are illegal, " << err
+                     << ", path pattern " << path_pattern;
+        } catch(...) { /* default value */ }
+
+        try {
+            string regex_filter_chain;
+            Json::getValue(log_item, "regex_filter_chain", regex_filter_chain);
+            if (!regex_filter_chain.empty()) {
+                parseFilterStages(regex_filter_chain,
+                        item.filter_conf.stages);
+            }
+        } catch(const JsonErr &err) {
+            LWARNING << "The regex filter chain is illegal, " << err
+                     << ", path pattern " << path_pattern;
+            item.filter_conf.stages.clear();
+        } catch(...) { /* default value */ }
+
+        try {
+            string json_filter;
+            Json::getValue(log_item, "json_filter", json_filter);
+            if (!json_filter.empty()) {
+                parseJsonPredicates(json_filter,
+                        item.filter_conf.json_predicates);
+            }
+        } catch(const JsonErr &err) {
+            LWARNING << "The json filter is illegal, " << err
+                     << ", path pattern " << path_pattern;
+            item.filter_conf.json_predicates.clear();
+        } catch(...) { /* default value */ }
+
+        try {
+            string filter_plugins;
+            Json::getValue(log_item, "filter_plugins", filter_plugins);
+            if (!filter_plugins.empty()) {
+                parseFilterPlugins(filter_plugins,
+                        item.filter_conf.plugins);
+            }
+        } catch(const JsonErr &err) {
+            LWARNING << "The filter plugins are illegal, " << err
+                     << ", path pattern " << path_pattern;
+            item.filter_conf.plugins.clear();
+        } catch(...) { /* default value */ }
+
+        try {
+            string sample_rate;
+            Json::getValue(log_item, "sample_rate", sample_rate);
+            if (!sample_rate.empty()) {
+                item.filter_conf.sample_conf.rate = atof(sample_rate.c_str());
+            }
+        } catch(...) { /* default value */ }
+        if (!SampleConf::isRateValid(item.filter_conf.sample_conf.rate)) {
+            LWARNING << "The sample rate " << item.filter_conf.sample_conf.rate
+                     << " is illegal, path pattern " << path_pattern;
+            item.filter_conf.sample_conf.rate = 1.0;
+        }
+
+        try {
+            string sample_key_pattern;
+            Json::getValue(log_item, "sample_key_pattern", sample_key_pattern);
+            item.filter_conf.sample_conf.key_pattern = sample_key_pattern;
+        } catch(...) { /* default value */ }
+
+        try {
+            string sample_max_lines_per_sec;
+            Json::getValue(log_item, "sample_max_lines_per_sec", sample_max_lines_per_sec);
+            item.filter_conf.sample_conf.max_lines_per_sec =
+                strtoul(sample_max_lines_per_sec.c_str(), NULL, 10);
+        } catch(...) { /* default value */ }
+
+        try {
+            string sample_max_bytes_per_sec;
+            Json::getValue(log_item, "sample_max_bytes_per_sec", sample_max_bytes_per_sec);
+            item.filter_conf.sample_conf.max_bytes_per_sec =
+                strtoul(sample_max_bytes_per_sec.c_str(), NULL, 10);
+        } catch(...) { /* default value */ }
+
+        try {
+            string envelope_format;
+            Json::getValue(log_item, "envelope_format", envelope_format);
+            item.envelope_conf.format = envelope_format;
+        } catch(...) { /* default value */ }
+        if (!EnvelopeConf::isFormatValid(item.envelope_conf.format)) {
+            LWARNING << "The envelope format " << item.envelope_conf.format
+                     << " is illegal, path pattern " << path_pattern;
+            item.envelope_conf.format = "";
+        }
+
+        try {
+            string envelope_fields;
+            Json::getValue(log_item, "envelope_fields", envelope_fields);
+            if (!envelope_fields.empty()) {
+                Json::parseStringArray(envelope_fields,
+                        item.envelope_conf.fields);
+            }
+        } catch(const JsonErr &err) {
+            LWARNING << "The envelope fields are illegal, " << err
+                     << ", path pattern " << path_pattern;
+            item.envelope_conf.fields.clear();
+        } catch(...) { /* default value */ }
+
+        try {
+            string envelope_delimiter;
+            Json::getValue(log_item, "envelope_delimiter", envelope_delimiter);
+            if (!envelope_delimiter.empty()) {
+                item.envelope_conf.delimiter = envelope_delimiter;
+            }
+        } catch(...) { /* default value */ }
+
+        try {
+            string multiline_start_pattern;
+            Json::getValue(log_item, "multiline_start_pattern", multiline_start_pattern);
+            item.multiline_conf.start_pattern = multiline_start_pattern;
+        } catch(...) { /* default value */ }
+
+        try {
+            string multiline_max_lines;
+            Json::getValue(log_item, "multiline_max_lines", multiline_max_lines);
+            item.multiline_conf.max_lines = atoi(multiline_max_lines.c_str());
+        } catch(...) { /* default value */ }
+
+        try {
+            string multiline_max_bytes;
+            Json::getValue(log_item, "multiline_max_bytes", multiline_max_bytes);
+            item.multiline_conf.max_bytes = atoi(multiline_max_bytes.c_str());
+        } catch(...) { /* default value */ }
+
+        try {
+            string multiline_max_age_ms;
+            Json::getValue(log_item, "multiline_max_age_ms", multiline_max_age_ms);
+            item.multiline_conf.max_age_ms = atoi(multiline_max_age_ms.c_str());
+        } catch(...) { /* default value */ }
+
         if (item.isLegal()) {
             m_task_confs[path_pattern] = item;
         }
@@ -294,8 +715,22 @@ bool Manager::stop()
     }
 
     ScopedLock l(m_tail_watchers_mutex);
+
+    /* the positions are committed by the delivery reports, so that the
+     * lines in flight are not sent again after restart */
+    OutputKafka::flushProducers(PRODUCER_FLUSH_MAX_MS);
+
     stopWatchers(getTailsKeys(m_tails), true, false);
 
+    if (NULL != m_uring_engine) {
+        m_uring_engine->close();
+    }
+
+    /* the jobs of the stopped watchers are cancelled already */
+    if (NULL != m_filter_pool) {
+        m_filter_pool->close();
+    }
+
     if (NULL != m_pos_file) {
         fclose(m_pos_file); m_pos_file = NULL;
     }
@@ -343,6 +778,9 @@ void Manager::refreshWatchers(void *arg)
     manager->stopWatchers(deleted, true, true);
     manager->startWatchers(added);
     manager->updateWatchers(keeped);
+
+    /* the pools of the removed tasks */
+    OutputKafka::reapProducers();
 }/*}}}*/
 
 bool Manager::refreshTasks()
@@ -587,13 +1025,22 @@ TailWatcher* Manager::setupWatcher(
 
     OutputKafka *output = new OutputKafka();
     output->setKafkaConf(m_kafka_conf);
-    if (!output->init(m_zookeeper, conf.kafka_topic_conf.compression_codec)) {
+    output->setPoolKafkaConfs(m_pool_kafka_confs);
+    output->setLoop(m_loop);
+    if (!output->init(m_zookeeper, conf.kafka_topic_conf)) {
         LERROR << "Fail to init kafka output";
         delete output;
         return NULL;
     };
 
-    output->setKafkaTopicConf(conf.kafka_topic_conf);
+    if (!output->setKafkaTopicConf(conf.kafka_topic_conf)) {
+        LWARNING << "Fail to set kafka topic conf, path pattern " << path_pattern;
+    }
+
+    if (!output->setEnvelopeConf(conf.envelope_conf, getHostname(),
+                m_config->logkafka_id, path, getInode(path.c_str()))) {
+        LWARNING << "Fail to set envelope conf, path pattern " << path_pattern;
+    }
 
     // init tail watcher
     TailWatcher *tail_watcher = new TailWatcher();
@@ -604,15 +1051,24 @@ TailWatcher* Manager::setupWatcher(
             m_stat_silent_max_ms, 
             conf.log_conf.read_from_head,
             conf.log_conf.batchsize,
+            conf.log_conf.batchsize_min,
+            conf.log_conf.batchsize_max,
             m_line_max_bytes,
             m_read_max_bytes,
+            m_mmap_min_bytes,
+            m_direct_io_min_bytes,
+            m_pagecache_dontneed,
+            m_delivery_inflight_max_bytes,
             conf.log_conf.line_delimiter,
             conf.log_conf.remove_delimiter,
+            conf.log_conf.length_prefix_bytes,
             updateWatcherRotate, 
             receiveLines,
             conf,
             this,
-            output);
+            output,
+            m_uring_engine,
+            m_filter_pool);
 
     if (!res) {
         LERROR << "Fail to init tail watcher";
@@ -727,16 +1183,37 @@ void Manager::updateWatchers(set<string> path_patterns)
 
         if (task->conf.log_conf != tail->m_conf.log_conf 
                 || task->conf.kafka_topic_conf != tail->m_conf.kafka_topic_conf
-                || task->conf.filter_conf != tail->m_conf.filter_conf)
+                || task->conf.filter_conf != tail->m_conf.filter_conf
+                || task->conf.multiline_conf != tail->m_conf.multiline_conf
+                || task->conf.envelope_conf != tail->m_conf.envelope_conf)
         {
             closeWatcher(tail, true, false);
+            if (task->conf.kafka_topic_conf != tail->m_conf.kafka_topic_conf) {
+                /* the pool may change too, the new one may hold handles
+                 * of the topic with the old settings */
+                OutputKafka::invalidateTopic(tail->m_conf.kafka_topic_conf);
+                OutputKafka::invalidateTopic(task->conf.kafka_topic_conf);
+            }
             PositionEntryKey pek = {path_pattern, tail->getPath()};
-            m_tails[path_pattern] = setupWatcher(
+            TailWatcher *tw = setupWatcher(
                     task->conf, 
                     path_pattern, 
                     task->getPath(), 
                     (*m_position_file)[pek],
                     task->getEnabled());
+            if (NULL != tw) {
+                m_tails[path_pattern] = tw;
+            } else {
+                /* set up again as an added task on the next refresh */
+                m_tails.erase(path_pattern);
+            }
+
+            /* deleted after the new one is set up, so that an unchanged
+             * producer pool is kept, its output releases the pool, which
+             * is closed once unused */
+            delete tail;
+
+            continue;
         }
 
         if (task->getEnabled() && !tail->getEnabled()) {
@@ -802,27 +1279,29 @@ bool Manager::updateWatcherRotate(Manager *manager,
 
 bool Manager::receiveLines(void *filter, 
         void *output, 
-        const vector<string> &lines,
-        vector<string> &unsent_lines)
+        vector<LineSlice> &lines,
+        vector<LineSlice> &unsent_lines,
+        DeliveryBatch *batch)
 {/*{{{*/
     if (NULL == output) {
         LERROR << "output function is NULL";
         return false;
     }
 
+    /* lines are filtered in place, the dropped ones are not resent */
     Filter *flt = reinterpret_cast<Filter *>(filter);
-    vector<string> valid_lines = lines;
-    if (NULL != flt) {
-        flt->filter(flt, valid_lines);
+    if (NULL != flt && !flt->filter(flt, lines)) {
+        LWARNING << "Filter fails on a batch, the " << lines.size()
+                 << " lines left are sent";
     }
 
-    if (valid_lines.empty()) {
+    if (lines.empty()) {
         LINFO << "lines is empty";
         return true;
     }
 
     Output *out = reinterpret_cast<Output *>(output);
-    return out->output(out, valid_lines, unsent_lines);
+    return out->output(out, lines, unsent_lines, batch);
 }/*}}}*/
 
 void Manager::uploadCollectingState(void *arg)
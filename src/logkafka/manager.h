@@ -26,12 +26,14 @@
 
 #include "base/common.h"
 #include "logkafka/config.h"
+#include "logkafka/filter_pool.h"
 #include "logkafka/output_kafka.h"
 #include "logkafka/position_file.h"
 #include "logkafka/producer.h"
 #include "logkafka/signal_handler.h"
 #include "logkafka/tail_watcher.h"
 #include "logkafka/task_conf.h"
+#include "logkafka/uring_engine.h"
 #include "logkafka/zookeeper.h"
 
 #include <uv.h>
@@ -66,12 +68,20 @@ class Manager
 
     private:
         bool initZookeeper();
+        bool initUringEngine();
+        bool initFilterPool();
 
         /* kafka global conf relevant functions */
         bool initKafkaConf();
 
         /* task confs relevant functions */
         bool refreshTaskConfs();
+        static void parseFilterStages(const string &json,
+                vector<FilterStageConf> &stages);
+        static void parseJsonPredicates(const string &json,
+                vector<JsonPredicateConf> &predicates);
+        static void parseFilterPlugins(const string &json,
+                vector<FilterPluginConf> &plugins);
 
         /* tasks relevant functions */
         bool refreshTasks();
@@ -112,8 +122,9 @@ class Manager
         void flushBuffer(TailWatcher *tw);
         static bool receiveLines(void *filter, 
                 void *output, 
-                const vector<string> &lines,
-                vector<string> &unsent_lines);
+                vector<LineSlice> &lines,
+                vector<LineSlice> &unsent_lines,
+                DeliveryBatch *batch);
 
         set<string> getTasksKeys(const TaskMap &tasks);
         set<string> getTailsKeys(const TailMap &tails);
@@ -128,24 +139,33 @@ class Manager
         unsigned long m_refresh_interval;
         unsigned long m_line_max_bytes;
         unsigned long m_read_max_bytes;
+        unsigned long m_mmap_min_bytes;
+        unsigned long m_direct_io_min_bytes;
+        bool m_pagecache_dontneed;
+        unsigned long m_delivery_inflight_max_bytes;
         unsigned long m_stat_silent_max_ms;
         string m_pos_path;
         uv_loop_t *m_loop;
         const Config *m_config;
 
         KafkaConf m_kafka_conf;
+        KafkaConfMap m_pool_kafka_confs;
         TaskConfMap m_task_confs;
         TaskMap m_tasks;
         TailMap m_tails;
         TailVec m_tails_deleted;
 
         TimerWatcher *m_refresh_trigger;
+        UringEngine *m_uring_engine;
+        FilterPool *m_filter_pool;
 
         FILE* m_pos_file;
         PositionFile *m_position_file;
 
         Mutex m_tail_watchers_mutex;
         Mutex m_tail_watchers_deleted_mutex;
+
+        static const int PRODUCER_FLUSH_MAX_MS;
 };
 
 } // namespace logkafka
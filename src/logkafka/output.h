@@ -31,20 +31,34 @@
 #include <vector>
 
 #include "base/common.h"
+#include "logkafka/delivery_tracker.h"
+#include "logkafka/line_slice.h"
 
 using namespace std;
 
 namespace logkafka {
 
+/* called with true when the output stops taking lines, and with false
+ * when it takes them again */
+typedef void (*FlowFunc)(void *arg, bool paused);
+
+typedef vector<pair<string, string> > OutputStats;
+
 class Output
 {
     public:
         Output() {};
         virtual ~Output() {};
         virtual bool init(void *arg) = 0;
+        /* the queued lines are added to the batch if it is not NULL */
         virtual bool output(void *arg, 
-                const vector<string> &lines, 
-                vector<string> &unsent_lines) = 0;
+                const vector<LineSlice> &lines, 
+                vector<LineSlice> &unsent_lines,
+                DeliveryBatch *batch) = 0;
+        /* func is called when the output pauses or resumes, NULL func
+         * for none */
+        virtual void setFlowCallback(void *arg, FlowFunc func) {};
+        virtual void getStats(OutputStats &stats) const {};
 };
 
 } // namespace logkafka
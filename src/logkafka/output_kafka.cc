@@ -23,74 +23,314 @@
 
 namespace logkafka {
 
-map< string, Producer *> OutputKafka::m_producer_map;
+map<string, OutputKafka::ProducerPool> OutputKafka::m_producer_map;
 KafkaConf OutputKafka::m_kafka_conf;
+KafkaConfMap OutputKafka::m_pool_kafka_confs;
+uv_loop_t *OutputKafka::m_loop = NULL;
+
+OutputKafka::OutputKafka(): Output()
+{/*{{{*/
+    m_flow_arg = NULL;
+    m_producer = NULL;
+}/*}}}*/
+
+OutputKafka::~OutputKafka()
+{/*{{{*/
+    setFlowCallback(NULL, NULL);
+
+    if (NULL != m_producer) {
+        releaseProducer(m_pool_key);
+        m_producer = NULL;
+    }
+}/*}}}*/
 
 bool OutputKafka::output(void *arg, 
-        const vector<string> &lines, 
-        vector<string> &unsent_lines)
+        const vector<LineSlice> &lines, 
+        vector<LineSlice> &unsent_lines,
+        DeliveryBatch *batch)
 {/*{{{*/
     OutputKafka *ok = reinterpret_cast<OutputKafka *>(arg);
-    KafkaTopicConf kafka_topic_conf = ok->m_kafka_topic_conf;
-    Producer *producer = ok->m_producer_map[kafka_topic_conf.compression_codec];
+    const KafkaTopicConf &kafka_topic_conf = ok->m_kafka_topic_conf;
+    Producer *producer = ok->m_producer;
+    if (NULL == producer) {
+        LERROR << "No producer of topic " << kafka_topic_conf.topic;
+        return false;
+    }
+
+    /* the keys point into the lines, which outlive the send */
+    ok->m_keys.clear();
+    if (ok->m_key_extractor.isEnabled()) {
+        ok->m_keys.resize(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            MessageKey &key = ok->m_keys[i];
+            if (!ok->m_key_extractor.extract(lines[i].data(), lines[i].length(),
+                        &key.data, &key.len)) {
+                key.data = NULL;
+                key.len = 0;
+            }
+        }
+    }
+
+    if (!ok->m_envelope.isEnabled()) {
+        return producer->send(lines,
+                    ok->m_keys,
+                    unsent_lines,
+                    "", 
+                    kafka_topic_conf.topic, 
+                    kafka_topic_conf.key, 
+                    kafka_topic_conf.required_acks,
+                    kafka_topic_conf.partition,
+                    kafka_topic_conf.message_timeout_ms,
+                    batch);
+    }
+
+    if (!ok->m_envelope.wrap(lines, ok->m_envelopes)) {
+        LERROR << "Fail to wrap lines into envelopes";
+        return false;
+    }
 
-    return producer->send(lines,
-                unsent_lines,
+    vector<LineSlice> unsent_envelopes;
+    bool ret = producer->send(ok->m_envelopes,
+                ok->m_keys,
+                unsent_envelopes,
                 "", 
                 kafka_topic_conf.topic, 
                 kafka_topic_conf.key, 
                 kafka_topic_conf.required_acks,
                 kafka_topic_conf.partition,
-                kafka_topic_conf.message_timeout_ms);
+                kafka_topic_conf.message_timeout_ms,
+                batch);
+
+    /* the lines, not their envelopes, are resent, the unsent envelopes
+     * are in the order of the batch */
+    size_t k = 0;
+    for (size_t i = 0; i < lines.size() && k < unsent_envelopes.size(); ++i) {
+        if (ok->m_envelopes[i].data() == unsent_envelopes[k].data()) {
+            unsent_lines.push_back(lines[i]);
+            ++k;
+        }
+    }
+
+    /* librdkafka holds its own references of the arenas */
+    ok->m_envelopes.clear();
+
+    return ret;
 }/*}}}*/
 
-bool OutputKafka::init(void *arg, string compression_codec)
+void OutputKafka::setFlowCallback(void *arg, FlowFunc func)
 {/*{{{*/
-    return OutputKafka::initProducer(arg, compression_codec);
+    if (NULL == m_producer) {
+        return;
+    }
+
+    if (NULL != m_flow_arg) {
+        m_producer->removeFlowListener(m_flow_arg);
+        m_flow_arg = NULL;
+    }
+
+    if (NULL == func) {
+        return;
+    }
+
+    m_flow_arg = arg;
+    m_producer->addFlowListener(arg, func);
 }/*}}}*/
 
-bool OutputKafka::initProducer(void *arg, string compression_codec)
+void OutputKafka::getStats(OutputStats &stats) const
 {/*{{{*/
-    Zookeeper *zookeeper = reinterpret_cast<Zookeeper *>(arg);
+    map<string, ProducerPool>::const_iterator iter 
+        = m_producer_map.find(m_pool_key);
+    if (NULL == m_producer || iter == m_producer_map.end()) {
+        return;
+    }
 
-    map<string, int>::const_iterator iter 
-        = Producer::cc_map.find(compression_codec);
-    if (iter == Producer::cc_map.end())
-        return false;
+    stats.push_back(make_pair("pool", m_pool_key));
+    stats.push_back(make_pair("users", int2Str(iter->second.users)));
+    stats.push_back(make_pair("queued_messages",
+                int2Str(m_producer->getQueuedMessages())));
+    stats.push_back(make_pair("queued_bytes",
+                int2Str(m_producer->getQueuedBytes())));
+    stats.push_back(make_pair("paused",
+                string(m_producer->isPaused()? "true": "false")));
+    stats.push_back(make_pair("delivered_messages",
+                int2Str(m_producer->getDeliveredMessages())));
+    stats.push_back(make_pair("failed_messages",
+                int2Str(m_producer->getFailedMessages())));
+}/*}}}*/
 
-    if (NULL == m_producer_map[iter->first]) {
-        LINFO << "Try to init producer, compression_codec is "
-              << iter->first;
-        Producer *producer = new Producer();
-        if (!producer->init(*zookeeper, iter->first, m_kafka_conf))
-        {
-            LERROR << "Fail to init producer, compression_codec is "
-                   << iter->first;
-            delete producer;
-            return false;
-        }
-        m_producer_map[iter->first] = producer;
+bool OutputKafka::init(void *arg, const KafkaTopicConf &kafka_topic_conf)
+{/*{{{*/
+    m_producer = acquireProducer(arg, kafka_topic_conf);
+    if (NULL == m_producer) {
+        return false;
     }
 
+    m_pool_key = getPoolKey(kafka_topic_conf);
+
     return true;
 }/*}}}*/
 
+string OutputKafka::getPoolKey(const KafkaTopicConf &kafka_topic_conf)
+{/*{{{*/
+    const string &pool = kafka_topic_conf.producer_pool;
+    const string &codec = kafka_topic_conf.compression_codec;
+
+    /* the codec is set on the rd_kafka_t, so it always splits the pools */
+    if ("" == pool || "shared" == pool) {
+        return codec;
+    } else if ("topic" == pool) {
+        return codec + "/topic/" + kafka_topic_conf.topic;
+    }
+
+    return codec + "/group/" + pool;
+}/*}}}*/
+
+Producer *OutputKafka::acquireProducer(void *arg, 
+        const KafkaTopicConf &kafka_topic_conf)
+{/*{{{*/
+    Zookeeper *zookeeper = reinterpret_cast<Zookeeper *>(arg);
+    const string &compression_codec = kafka_topic_conf.compression_codec;
+
+    if (Producer::cc_map.find(compression_codec) == Producer::cc_map.end()) {
+        LERROR << "Unknown compression codec " << compression_codec;
+        return NULL;
+    }
+
+    string pool_key = getPoolKey(kafka_topic_conf);
+    map<string, ProducerPool>::iterator iter = m_producer_map.find(pool_key);
+    if (iter != m_producer_map.end()) {
+        ++iter->second.users;
+        return iter->second.producer;
+    }
+
+    /* the named pools may have their own queue limits */
+    KafkaConf kafka_conf = m_kafka_conf;
+    KafkaConfMap::const_iterator conf_iter 
+        = m_pool_kafka_confs.find(kafka_topic_conf.producer_pool);
+    if (conf_iter != m_pool_kafka_confs.end()) {
+        kafka_conf = conf_iter->second;
+    } else if ("" != kafka_topic_conf.producer_pool 
+            && "shared" != kafka_topic_conf.producer_pool
+            && "topic" != kafka_topic_conf.producer_pool) {
+        LWARNING << "No producer.pool section of producer pool " 
+                 << kafka_topic_conf.producer_pool 
+                 << " of topic " << kafka_topic_conf.topic
+                 << ", it takes the global queue limits";
+    }
+
+    LINFO << "Try to init producer of pool " << pool_key;
+    Producer *producer = new Producer();
+    if (!producer->init(*zookeeper, compression_codec, kafka_conf, m_loop))
+    {
+        LERROR << "Fail to init producer of pool " << pool_key;
+        producer->close();
+        delete producer;
+        return NULL;
+    }
+
+    ProducerPool pool = {producer, 1};
+    m_producer_map[pool_key] = pool;
+
+    return producer;
+}/*}}}*/
+
+void OutputKafka::releaseProducer(const string &pool_key)
+{/*{{{*/
+    map<string, ProducerPool>::iterator iter = m_producer_map.find(pool_key);
+    if (iter == m_producer_map.end()) {
+        return;
+    }
+
+    if (--iter->second.users > 0) {
+        return;
+    }
+
+    /* the reports of the messages left still commit their positions */
+    if (iter->second.producer->getQueuedMessages() > 0) {
+        LINFO << "Producer pool " << pool_key << " is unused, close it "
+              << "once its messages are delivered";
+        return;
+    }
+
+    LINFO << "Close unused producer pool " << pool_key;
+    iter->second.producer->close();
+    delete iter->second.producer;
+    m_producer_map.erase(iter);
+}/*}}}*/
+
+void OutputKafka::reapProducers()
+{/*{{{*/
+    map<string, ProducerPool>::iterator iter = m_producer_map.begin();
+    while (iter != m_producer_map.end()) {
+        if (iter->second.users > 0 
+                || iter->second.producer->getQueuedMessages() > 0) {
+            ++iter;
+            continue;
+        }
+
+        LINFO << "Close unused producer pool " << iter->first;
+        iter->second.producer->close();
+        delete iter->second.producer;
+        m_producer_map.erase(iter++);
+    }
+}/*}}}*/
+
 bool OutputKafka::setKafkaTopicConf(KafkaTopicConf kafka_topic_conf)
 {/*{{{*/
     m_kafka_topic_conf = kafka_topic_conf;
+
+    if (!m_key_extractor.init(kafka_topic_conf)) {
+        LERROR << "Fail to init key extractor, the fixed key is used";
+        return false;
+    }
+
     return true;
 }/*}}}*/
 
+bool OutputKafka::setEnvelopeConf(const EnvelopeConf &envelope_conf,
+        const string &hostname,
+        const string &logkafka_id,
+        const string &path,
+        ino_t inode)
+{/*{{{*/
+    if (envelope_conf.format == "") {
+        return true;
+    }
+
+    if (!m_envelope.init(envelope_conf, hostname, logkafka_id, path, inode)) {
+        LERROR << "Fail to init envelope, the lines are sent as is";
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+void OutputKafka::invalidateTopic(const KafkaTopicConf &kafka_topic_conf)
+{/*{{{*/
+    map<string, ProducerPool>::iterator iter 
+        = m_producer_map.find(getPoolKey(kafka_topic_conf));
+    if (iter == m_producer_map.end())
+        return;
+
+    iter->second.producer->invalidateTopic(kafka_topic_conf.topic);
+}/*}}}*/
+
+void OutputKafka::flushProducers(int timeout_ms)
+{/*{{{*/
+    map<string, ProducerPool>::iterator iter;
+    for (iter = m_producer_map.begin(); iter != m_producer_map.end(); ++iter) {
+        iter->second.producer->flush(timeout_ms);
+    }
+}/*}}}*/
+
 bool OutputKafka::stopProducers()
 {/*{{{*/
-    map<string, int>::const_iterator iter;
-    for (iter = Producer::cc_map.begin(); iter != Producer::cc_map.end(); ++iter) {
-        if (NULL != m_producer_map[iter->first]) {
-            m_producer_map[iter->first]->close();
-            delete m_producer_map[iter->first];
-            m_producer_map[iter->first] = NULL;
-        }
+    map<string, ProducerPool>::iterator iter;
+    for (iter = m_producer_map.begin(); iter != m_producer_map.end(); ++iter) {
+        iter->second.producer->close();
+        delete iter->second.producer;
     }
+    m_producer_map.clear();
 
     return true;
 }/*}}}*/
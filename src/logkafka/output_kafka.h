@@ -31,6 +31,8 @@
 #include <vector>
 
 #include "base/common.h"
+#include "logkafka/envelope.h"
+#include "logkafka/key_extractor.h"
 #include "logkafka/output.h"
 #include "logkafka/producer.h"
 #include "logkafka/task_conf.h"
@@ -40,33 +42,92 @@ using namespace base;
 
 namespace logkafka {
 
+/* The messages of a task are queued on the producer of its pool, so that
+ * a slow topic only stalls the tasks sharing its pool. A pool is one
+ * rd_kafka_t with its own queue limits, see KafkaTopicConf::producer_pool,
+ * it is created by the first output using it, and closed once no output
+ * uses it and its messages are delivered. */
 class OutputKafka: public virtual Output
 {
     public:
-        OutputKafka(): Output() {};
-        virtual ~OutputKafka() {};
+        OutputKafka();
+        virtual ~OutputKafka();
         bool init(void *arg) { return true; };
 
         /* NOTE: not thread-safe */
-        bool init(void *arg, string compression_codec);
+        bool init(void *arg, const KafkaTopicConf &kafka_topic_conf);
         bool output(void *arg, 
-                const vector<string> &lines, 
-                vector<string> &unsent_lines);
+                const vector<LineSlice> &lines, 
+                vector<LineSlice> &unsent_lines,
+                DeliveryBatch *batch);
+        /* NOTE: call it after init, the producer of the pool tells the
+         * flow changes */
+        void setFlowCallback(void *arg, FlowFunc func);
+        void getStats(OutputStats &stats) const;
         bool setKafkaTopicConf(KafkaTopicConf kafka_topic_conf);
-
-        /* NOTE: not thread-safe */
-        static bool initProducer(void *arg, string compression_codec);
+        bool setEnvelopeConf(const EnvelopeConf &envelope_conf,
+                const string &hostname,
+                const string &logkafka_id,
+                const string &path,
+                ino_t inode);
 
         static bool stopProducers();
+        /* close the unused pools whose messages are delivered */
+        static void reapProducers();
+        /* wait for the queued messages until timeout */
+        static void flushProducers(int timeout_ms);
+
+        /* NOTE: not thread-safe, call it when the topic conf of a task
+         * changes, the cached topic handles are created again */
+        static void invalidateTopic(const KafkaTopicConf &kafka_topic_conf);
         static bool setKafkaConf(KafkaConf kafka_conf) { 
             m_kafka_conf = kafka_conf;
             return true;
         };
+        /* the confs of the named pools, the others take the one above */
+        static bool setPoolKafkaConfs(const KafkaConfMap &kafka_confs) {
+            m_pool_kafka_confs = kafka_confs;
+            return true;
+        };
+        /* the loop serving the delivery reports */
+        static bool setLoop(uv_loop_t *loop) {
+            m_loop = loop;
+            return true;
+        };
 
     private:
-        static map< string, Producer *> m_producer_map;
+        struct ProducerPool {
+            Producer *producer;
+            /* the number of outputs using it */
+            long users;
+        };
+
+        static string getPoolKey(const KafkaTopicConf &kafka_topic_conf);
+        static Producer *acquireProducer(void *arg, 
+                const KafkaTopicConf &kafka_topic_conf);
+        static void releaseProducer(const string &pool_key);
+
+    private:
+        /* keyed by the pool key, see getPoolKey */
+        static map<string, ProducerPool> m_producer_map;
         KafkaTopicConf m_kafka_topic_conf;
         static KafkaConf m_kafka_conf;
+        static KafkaConfMap m_pool_kafka_confs;
+        static uv_loop_t *m_loop;
+
+        Producer *m_producer;
+        string m_pool_key;
+
+        KeyExtractor m_key_extractor;
+        /* reused for each batch */
+        vector<MessageKey> m_keys;
+
+        Envelope m_envelope;
+        /* reused for each batch */
+        vector<LineSlice> m_envelopes;
+
+        /* the arg the flow callback is added with, NULL for none */
+        void *m_flow_arg;
 };
 
 } // namespace logkafka
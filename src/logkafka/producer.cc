@@ -25,8 +25,10 @@
 #include <unistd.h>
 #include <signal.h>
 #include <syslog.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -41,12 +43,24 @@ using namespace base;
 namespace logkafka {
 
 const map<string, int> Producer::cc_map = Producer::createCompressionCodecMap();
+const int Producer::CLOSE_FLUSH_MAX_MS = 10000;
 
 Producer::Producer()
 {/*{{{*/
     m_compression_codec = "";
     m_conf = NULL;
     m_rk = NULL;
+    m_queued_bytes = 0;
+    m_queued_messages = 0;
+    m_high_watermark_bytes = 0;
+    m_low_watermark_bytes = 0;
+    m_low_watermark_messages = 0;
+    m_paused = false;
+    m_delivered_messages = 0;
+    m_failed_messages = 0;
+    m_queue = NULL;
+    m_event_fd = -1;
+    m_poll_handle = NULL;
 }/*}}}*/
 
 Producer::~Producer()
@@ -64,7 +78,8 @@ void Producer::rdkafkaLogger(const rd_kafka_t *rk,
 
 bool Producer::init(Zookeeper& zookeeper, 
     const string &compression_codec,
-    const KafkaConf &kafka_conf)
+    const KafkaConf &kafka_conf,
+    uv_loop_t *loop)
 {/*{{{*/
     char errstr[512];
 
@@ -102,6 +117,19 @@ bool Producer::init(Zookeeper& zookeeper,
         return false;
     }
 
+    m_high_watermark_bytes = kafka_conf.queue_high_watermark_bytes;
+    m_low_watermark_bytes = kafka_conf.queue_low_watermark_bytes;
+    if (m_low_watermark_bytes > m_high_watermark_bytes) {
+        LWARNING << "Queue low watermark " << m_low_watermark_bytes
+                 << " is above the high watermark " << m_high_watermark_bytes
+                 << ", use half of the high watermark";
+        m_low_watermark_bytes = m_high_watermark_bytes / 2;
+    }
+    m_low_watermark_messages = kafka_conf.queue_buffering_max_messages / 2;
+
+    /* the delivery reports find the producer by the opaque */
+    rd_kafka_conf_set_opaque(m_conf, this);
+
     /* If offset reporting (-o report) is enabled, use the
      * richer dr_msg_cb instead. */
     bool report_offsets = false;
@@ -128,14 +156,92 @@ bool Producer::init(Zookeeper& zookeeper,
         return false;
     }
 
+    if (NULL != loop && !initEvents(loop)) {
+        return false;
+    }
+
     return true;
 }/*}}}*/
 
-void Producer::close()
+bool Producer::initEvents(uv_loop_t *loop)
+{/*{{{*/
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (-1 == m_event_fd) {
+        LERROR << "Fail to create eventfd, " << strerror(errno);
+        return false;
+    }
+
+    m_poll_handle = new uv_poll_t();
+    int res = uv_poll_init(loop, m_poll_handle, m_event_fd);
+    if (res < 0) {
+        LERROR << "Fail to init uv poll, " << uv_strerror(res);
+        delete m_poll_handle; m_poll_handle = NULL;
+        closeEvents();
+        return false;
+    }
+    m_poll_handle->data = this;
+    uv_poll_start(m_poll_handle, UV_READABLE, onPoll);
+
+    /* an eventfd is written 8 bytes at a time */
+    uint64_t count = 1;
+    m_queue = rd_kafka_queue_get_main(m_rk);
+    rd_kafka_queue_io_event_enable(m_queue, m_event_fd, &count, sizeof(count));
+
+    return true;
+}/*}}}*/
+
+void Producer::closeEvents()
+{/*{{{*/
+    if (NULL != m_queue) {
+        rd_kafka_queue_io_event_enable(m_queue, -1, NULL, 0);
+        rd_kafka_queue_destroy(m_queue); m_queue = NULL;
+    }
+
+    if (NULL != m_poll_handle) {
+        uv_close((uv_handle_t *)m_poll_handle, onCloseComplete);
+        m_poll_handle = NULL;
+    }
+
+    if (-1 != m_event_fd) {
+        ::close(m_event_fd); m_event_fd = -1;
+    }
+}/*}}}*/
+
+void Producer::onPoll(uv_poll_t *handle, int status, int events)
 {/*{{{*/
-    /* Wait for messages to be delivered */
-    while (rd_kafka_outq_len(m_rk) > 0)
-        rd_kafka_poll(m_rk, 100);
+    Producer *producer = reinterpret_cast<Producer *>(handle->data);
+
+    /* read before serving, the reports queued after the serve write
+     * the eventfd again */
+    uint64_t count = 0;
+    if (sizeof(count) != ::read(producer->m_event_fd, &count, sizeof(count))
+            && EAGAIN != errno) {
+        LERROR << "Fail to read eventfd, " << strerror(errno);
+    }
+
+    producer->poll();
+}/*}}}*/
+
+void Producer::onCloseComplete(uv_handle_t *handle)
+{/*{{{*/
+    delete (uv_poll_t *)handle;
+}/*}}}*/
+
+void Producer::close(int timeout_ms)
+{/*{{{*/
+    destroyTopics();
+
+    /* the reports left are served by the flush below */
+    closeEvents();
+
+    /* NOTE: librdkafka 0.11 has no purge, the messages left are dropped
+     * by destroy, their positions are not committed */
+    if (NULL != m_rk 
+            && RD_KAFKA_RESP_ERR__TIMED_OUT == rd_kafka_flush(m_rk, timeout_ms)) {
+        LWARNING << "Drop " << m_queued_messages
+                 << " undelivered messages of kafka instance " 
+                 << rd_kafka_name(m_rk) << " after " << timeout_ms << " ms";
+    }
 
     if (NULL != m_rk) {
         LINFO << "Destroying kafka instance: " << rd_kafka_name(m_rk);
@@ -144,55 +250,79 @@ void Producer::close()
     }
 }/*}}}*/
 
-bool Producer::send(const vector<string> &messages,
-        vector<string> &unsent_messages,
+void Producer::poll()
+{/*{{{*/
+    if (NULL != m_rk) {
+        rd_kafka_poll(m_rk, 0);
+    }
+}/*}}}*/
+
+void Producer::flush(int timeout_ms)
+{/*{{{*/
+    if (NULL == m_rk) {
+        return;
+    }
+
+    /* the delivery reports are served while waiting */
+    if (RD_KAFKA_RESP_ERR__TIMED_OUT == rd_kafka_flush(m_rk, timeout_ms)) {
+        LWARNING << "Fail to flush kafka instance " << rd_kafka_name(m_rk)
+                 << " in " << timeout_ms << " ms, "
+                 << m_queued_messages << " messages left";
+    }
+}/*}}}*/
+
+bool Producer::send(const vector<LineSlice> &messages,
+        const vector<MessageKey> &keys,
+        vector<LineSlice> &unsent_messages,
         const string &brokers, 
         const string &topic, 
         const string &key, 
         int required_acks,
         int partition,
-        int message_timeout_ms) 
+        int message_timeout_ms,
+        DeliveryBatch *batch) 
 {/*{{{*/
     bool ret = true;
     long r;
     rd_kafka_topic_t *rkt;
-    rd_kafka_topic_conf_t *topic_conf;
     long msgcnt = messages.size();
     long failcnt = 0;
     long i;
+    size_t queued_bytes = 0;
+    long queued_messages = 0;
+    bool queue_full = false;
     rd_kafka_message_t *rkmessages;
 
-    char errstr[512];
-
-    /* Topic configuration */
-    topic_conf = rd_kafka_topic_conf_new();
-    rd_kafka_topic_conf_set(topic_conf,
-        "produce.offset.report",
-        "true", errstr, sizeof(errstr));
-    rd_kafka_topic_conf_set(topic_conf,
-        "message.timeout.ms",
-        int2Str(message_timeout_ms).c_str(), errstr, sizeof(errstr));
-
-    /* Create topic */
-    rkt = rd_kafka_topic_new(m_rk, topic.c_str(), topic_conf);
-    if (!rkt) {
-        LERROR << "Failed to create topic: " << strerror(errno);
+    rkt = getTopic(topic, required_acks, message_timeout_ms, !keys.empty());
+    if (NULL == rkt) {
+        /* the batch is kept and resent */
+        return false;
     }
-    
+
     /* Create messages */
     rkmessages = (rd_kafka_message_t*)calloc(sizeof(*rkmessages), msgcnt);
     for (i = 0 ; i < msgcnt ; ++i) {
-        long *msgidp = (long *)malloc(sizeof(*msgidp));
-        *msgidp = i;
-
         rkmessages[i].len     = messages[i].length();
-        rkmessages[i].payload = strndup(messages[i].c_str(), rkmessages[i].len);
-        rkmessages[i].key_len = key.length();
-        rkmessages[i].key     = strndup(key.c_str(), rkmessages[i].key_len);
-        rkmessages[i]._private = msgidp;
+        rkmessages[i].payload = const_cast<char *>(messages[i].data());
+        if (!keys.empty() && keys[i].len > 0) {
+            rkmessages[i].key_len = keys[i].len;
+            rkmessages[i].key     = const_cast<char *>(keys[i].data);
+        } else {
+            rkmessages[i].key_len = key.length();
+            rkmessages[i].key     = const_cast<char *>(key.data());
+        }
+        if (NULL != batch) {
+            batch->hold(messages[i].owner());
+            batch->ref();
+            rkmessages[i]._private = batch;
+        } else {
+            rkmessages[i]._private = messages[i].refOwner();
+        }
     }
 
-    r = rd_kafka_produce_batch(rkt, partition, RD_KAFKA_MSG_F_FREE,
+    /* Note: payloads point into the read buffer, which is kept alive by
+     * the owner references until the delivery report callback */
+    r = rd_kafka_produce_batch(rkt, partition, 0,
             rkmessages, msgcnt);
 
     /* Scan through messages to check for errors. */
@@ -207,12 +337,24 @@ bool Producer::send(const vector<string> &messages,
 
             /* Just keep unsent messages due to queue full error */
             if (rkmessages[i].err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
-                string msg((const char*)rkmessages[i].payload, rkmessages[i].len);
-                unsent_messages.push_back(msg);
+                unsent_messages.push_back(messages[i]);
+                queue_full = true;
             }
+
+            /* No delivery report for failed messages, the ones above
+             * are sent again by the caller */
+            releaseMessageOwner(rkmessages[i]._private,
+                    RD_KAFKA_RESP_ERR__QUEUE_FULL == rkmessages[i].err?
+                    RD_KAFKA_RESP_ERR_NO_ERROR: rkmessages[i].err);
+        } else {
+            queued_bytes += rkmessages[i].len;
+            ++queued_messages;
         }
     }
 
+    /* counted before the poll below reports any of them */
+    onQueued(queued_bytes, queued_messages, queue_full);
+
     /* All messages should've been produced. */
     if (r < msgcnt) {
         LERROR << "Not all messages were accepted "
@@ -227,23 +369,157 @@ bool Producer::send(const vector<string> &messages,
         ret = true;
     }
 
-    rd_kafka_poll(m_rk, 0);
-
-    /* Note: librdkafka will duplicate the key once more, 
-     * so we can free the original one after producing*/
-    for (i = 0 ; i < msgcnt ; ++i) {
-        free(rkmessages[i].key);
+    /* the loop serves the reports otherwise, not from inside send */
+    if (NULL == m_poll_handle) {
+        rd_kafka_poll(m_rk, 0);
     }
 
+    /* Note: librdkafka duplicates the key, nothing to free here */
     free(rkmessages);
     LINFO << "Partitioner: Produced "<< r << " messages, waiting for deliveries";
 
-    /* Destroy topic */
-    rd_kafka_topic_destroy(rkt);
-
     return ret;
 }/*}}}*/
 
+rd_kafka_topic_t *Producer::getTopic(const string &topic,
+        int required_acks,
+        int message_timeout_ms,
+        bool keyed)
+{/*{{{*/
+    string settings = "required acks " + int2Str(required_acks)
+        + ", message timeout ms " + int2Str(message_timeout_ms)
+        + ", keyed " + int2Str(keyed);
+
+    map<string, TopicHandle>::iterator iter = m_topics.find(topic);
+    if (iter != m_topics.end()) {
+        TopicHandle &handle = iter->second;
+        if (handle.settings != settings && !handle.warned) {
+            LWARNING << "Topic " << topic << " is sent with " << settings
+                     << " on a producer whose handle has " << handle.settings
+                     << ", librdkafka keeps the first ones,"
+                     << " use another producer pool to keep them apart";
+            handle.warned = true;
+        }
+        return handle.rkt;
+    }
+
+    char errstr[512];
+
+    /* Topic configuration */
+    rd_kafka_topic_conf_t *topic_conf = rd_kafka_topic_conf_new();
+    rd_kafka_topic_conf_set(topic_conf,
+        "produce.offset.report",
+        "true", errstr, sizeof(errstr));
+    rd_kafka_topic_conf_set(topic_conf,
+        "message.timeout.ms",
+        int2Str(message_timeout_ms).c_str(), errstr, sizeof(errstr));
+    if (rd_kafka_topic_conf_set(topic_conf,
+                "request.required.acks",
+                int2Str(required_acks).c_str(), 
+                errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        LWARNING << "Fail to set required acks of topic " << topic
+                 << ", " << errstr;
+    }
+    if (keyed) {
+        rd_kafka_topic_conf_set_partitioner_cb(topic_conf, partitionByKey);
+    }
+
+    /* Create topic, NOTE: librdkafka keeps one topic per name, a handle
+     * of a topic still referenced, e.g. by the undelivered messages of an
+     * invalidated handle, takes its conf rather than this one */
+    rd_kafka_topic_t *rkt = rd_kafka_topic_new(m_rk, topic.c_str(), topic_conf);
+    if (NULL == rkt) {
+        LERROR << "Failed to create topic " << topic
+               << ", " << strerror(errno);
+        return NULL;
+    }
+
+    LINFO << "Create topic handle " << topic << ", " << settings;
+    TopicHandle handle = {rkt, settings, false};
+    m_topics[topic] = handle;
+
+    return rkt;
+}/*}}}*/
+
+void Producer::invalidateTopic(const string &topic)
+{/*{{{*/
+    map<string, TopicHandle>::iterator iter = m_topics.find(topic);
+    if (iter == m_topics.end()) {
+        return;
+    }
+
+    LINFO << "Destroy topic handle " << topic;
+    rd_kafka_topic_destroy(iter->second.rkt);
+    m_topics.erase(iter);
+}/*}}}*/
+
+void Producer::addFlowListener(void *arg, FlowFunc func)
+{/*{{{*/
+    m_flow_listeners[arg] = func;
+
+    if (m_paused) {
+        (*func)(arg, true);
+    }
+}/*}}}*/
+
+void Producer::removeFlowListener(void *arg)
+{/*{{{*/
+    m_flow_listeners.erase(arg);
+}/*}}}*/
+
+void Producer::onQueued(size_t bytes, long messages, bool queue_full)
+{/*{{{*/
+    m_queued_bytes += bytes;
+    m_queued_messages += messages;
+
+    if (!m_paused && (queue_full || (0 != m_high_watermark_bytes
+                    && m_queued_bytes >= m_high_watermark_bytes))) {
+        setPaused(true);
+    }
+}/*}}}*/
+
+void Producer::onDelivered(size_t bytes, rd_kafka_resp_err_t err)
+{/*{{{*/
+    m_queued_bytes -= min(bytes, m_queued_bytes);
+    if (m_queued_messages > 0) {
+        --m_queued_messages;
+    }
+    if (RD_KAFKA_RESP_ERR_NO_ERROR == err) {
+        ++m_delivered_messages;
+    } else {
+        ++m_failed_messages;
+    }
+
+    if (m_paused && m_queued_bytes <= m_low_watermark_bytes
+            && m_queued_messages <= m_low_watermark_messages) {
+        setPaused(false);
+    }
+}/*}}}*/
+
+void Producer::setPaused(bool paused)
+{/*{{{*/
+    m_paused = paused;
+
+    LINFO << (paused? "Pause": "Resume") << " kafka instance "
+          << rd_kafka_name(m_rk) << ", queued bytes " << m_queued_bytes
+          << ", queued messages " << m_queued_messages;
+
+    map<void *, FlowFunc>::iterator iter;
+    for (iter = m_flow_listeners.begin(); 
+            iter != m_flow_listeners.end(); ++iter) {
+        (*iter->second)(iter->first, paused);
+    }
+}/*}}}*/
+
+void Producer::destroyTopics()
+{/*{{{*/
+    map<string, TopicHandle>::iterator iter;
+    for (iter = m_topics.begin(); iter != m_topics.end(); ++iter) {
+        rd_kafka_topic_destroy(iter->second.rkt);
+    }
+    m_topics.clear();
+}/*}}}*/
+
 /**
  * Message delivery report callback using the richer rd_kafka_message_t object.
  */
@@ -251,6 +527,13 @@ void Producer::msgDelivered2(rd_kafka_t *rk,
         const rd_kafka_message_t *rkmessage, 
         void *opaque) 
 {/*{{{*/
+    releaseMessageOwner(rkmessage->_private, rkmessage->err);
+
+    Producer *producer = reinterpret_cast<Producer *>(opaque);
+    if (NULL != producer) {
+        producer->onDelivered(rkmessage->len, rkmessage->err);
+    }
+
     bool quiet = true;
     if (rkmessage->err) {
         LERROR << "Message delivery failed: "
@@ -274,12 +557,76 @@ void Producer::msgDelivered(rd_kafka_t *rk,
         void *opaque, 
         void *msg_opaque) 
 {/*{{{*/
-    free(msg_opaque);
+    releaseMessageOwner(msg_opaque, err);
+
+    Producer *producer = reinterpret_cast<Producer *>(opaque);
+    if (NULL != producer) {
+        producer->onDelivered(len, err);
+    }
 
     if (err != RD_KAFKA_RESP_ERR_NO_ERROR)
         LERROR << "Message delivery failed: "<< rd_kafka_err2str(err);
 }/*}}}*/
 
+/**
+ * Partitioner of per-message keys, the messages without key are spread
+ * randomly rather than piled on one partition.
+ */
+int32_t Producer::partitionByKey(const rd_kafka_topic_t *rkt,
+        const void *key,
+        size_t keylen,
+        int32_t partition_cnt,
+        void *rkt_opaque,
+        void *msg_opaque)
+{/*{{{*/
+    if (0 == keylen) {
+        return rd_kafka_msg_partitioner_random(rkt, key, keylen,
+                partition_cnt, rkt_opaque, msg_opaque);
+    }
+
+    return rd_kafka_msg_partitioner_consistent(rkt, key, keylen,
+            partition_cnt, rkt_opaque, msg_opaque);
+}/*}}}*/
+
+void Producer::releaseMessageOwner(void *msg_opaque,
+        rd_kafka_resp_err_t err)
+{/*{{{*/
+    RefCounted *owner = reinterpret_cast<RefCounted *>(msg_opaque);
+    if (NULL == owner) {
+        return;
+    }
+
+    DeliveryBatch *batch = dynamic_cast<DeliveryBatch *>(owner);
+    if (RD_KAFKA_RESP_ERR_NO_ERROR == err || NULL == batch) {
+        owner->unref();
+        return;
+    }
+
+    /* the lines of a failed message are read again, except the ones
+     * the broker would never accept, e.g. too large */
+    if (isPermanentError(err)) {
+        LERROR << "Drop a message of the lines after offset "
+               << batch->getStartPos() << ", " << rd_kafka_err2str(err);
+    } else {
+        batch->fail();
+    }
+
+    owner->unref();
+}/*}}}*/
+
+bool Producer::isPermanentError(rd_kafka_resp_err_t err)
+{/*{{{*/
+    switch (err) {
+        case RD_KAFKA_RESP_ERR_INVALID_MSG:
+        case RD_KAFKA_RESP_ERR_INVALID_MSG_SIZE:
+        case RD_KAFKA_RESP_ERR_MSG_SIZE_TOO_LARGE:
+        case RD_KAFKA_RESP_ERR_RECORD_LIST_TOO_LARGE:
+            return true;
+        default:
+            return false;
+    }
+}/*}}}*/
+
 map<string, int> Producer::createCompressionCodecMap()
 {/*{{{*/
     map<string, int> cc_map;
@@ -29,6 +29,9 @@
 #include <string>
 #include <vector>
 
+#include "logkafka/delivery_tracker.h"
+#include "logkafka/line_slice.h"
+#include "logkafka/output.h"
 #include "logkafka/zookeeper.h"
 
 #ifdef __cplusplus
@@ -39,6 +42,8 @@ extern "C" {
 }
 #endif
 
+#include <uv.h>
+
 using namespace std;
 
 namespace logkafka {
@@ -47,6 +52,17 @@ struct KafkaConf {
     long long message_max_bytes;
     long long message_send_max_retries; 
     long long queue_buffering_max_messages;
+    long long queue_high_watermark_bytes;
+    long long queue_low_watermark_bytes;
+};
+
+typedef map<string, KafkaConf> KafkaConfMap;
+
+
+/* the key of a message, it points into the payload or the conf */
+struct MessageKey {
+    const char *data;
+    size_t len;
 };
 
 class Producer 
@@ -55,25 +71,88 @@ class Producer
         Producer();
         ~Producer();
 
+        /* the delivery reports are served in the loop as soon as they
+         * arrive, NULL loop for serving them only in send and poll */
         bool init(Zookeeper& zookeeper, 
                 const string &compression_codec,
-                const KafkaConf &kafka_conf);
-        void close();
+                const KafkaConf &kafka_conf,
+                uv_loop_t *loop = NULL);
+        /* wait up to timeout_ms for the queued messages, the ones left
+         * are dropped and read again after restart */
+        void close(int timeout_ms = CLOSE_FLUSH_MAX_MS);
 
-        bool send(const vector<string> &messages,
-                vector<string> &unsent_messages,
+        /* NOTE: the payloads are not copied, librdkafka holds one reference
+         * of each message owner until the message is delivered.
+         * If keys is not empty, keys[i] is the key of messages[i], the
+         * fixed key is used for an empty one, and a message is sent to
+         * the partition its key hashes to.
+         * If batch is not NULL, the queued messages are added to it, and
+         * it fails if one of them times out. */
+        bool send(const vector<LineSlice> &messages,
+                const vector<MessageKey> &keys,
+                vector<LineSlice> &unsent_messages,
                 const string &brokers, 
                 const string &topic, 
                 const string &key, 
                 int required_acks,
                 int partition,
-                int message_timeout_ms);
+                int message_timeout_ms,
+                DeliveryBatch *batch = NULL);
+
+        /* serve the delivery reports */
+        void poll();
+        /* wait for the queued messages until timeout */
+        void flush(int timeout_ms);
+
+        /* The queue is paused above the high watermark of the queued
+         * bytes, or when it is full, and resumed once it drains below the
+         * low watermarks, the listeners are told about both.
+         * NOTE: the listener is called from send and poll, it must not
+         * send in the callback */
+        void addFlowListener(void *arg, FlowFunc func);
+        void removeFlowListener(void *arg);
+        bool isPaused() { return m_paused; };
+
+        /* stats */
+        long getQueuedMessages() { return m_queued_messages; };
+        size_t getQueuedBytes() { return m_queued_bytes; };
+        unsigned long getDeliveredMessages() { return m_delivered_messages; };
+        unsigned long getFailedMessages() { return m_failed_messages; };
+
+        /* Drop the cached handle of the topic, the next send creates it
+         * with the current settings.
+         * NOTE: not thread-safe, call it from the thread of send */
+        void invalidateTopic(const string &topic);
 
     public:
         static const map<string, int> cc_map;
+        static const int CLOSE_FLUSH_MAX_MS;
 
     private:
+        rd_kafka_topic_t *getTopic(const string &topic,
+                int required_acks,
+                int message_timeout_ms,
+                bool keyed);
+        void destroyTopics();
+        bool initEvents(uv_loop_t *loop);
+        void closeEvents();
+        static void onPoll(uv_poll_t *handle, int status, int events);
+        static void onCloseComplete(uv_handle_t *handle);
+        void onQueued(size_t bytes, long messages, bool queue_full);
+        void onDelivered(size_t bytes, rd_kafka_resp_err_t err);
+        void setPaused(bool paused);
+
         static map<string, int> createCompressionCodecMap();
+        /* the failures a message would meet again if it were resent */
+        static bool isPermanentError(rd_kafka_resp_err_t err);
+        static void releaseMessageOwner(void *msg_opaque,
+                rd_kafka_resp_err_t err);
+        static int32_t partitionByKey(const rd_kafka_topic_t *rkt,
+                const void *key,
+                size_t keylen,
+                int32_t partition_cnt,
+                void *rkt_opaque,
+                void *msg_opaque);
         static void rdkafkaLogger(const rd_kafka_t *rk,
                 int level, const char *fac, const char *buf);
         static void msgDelivered2(rd_kafka_t *rk,
@@ -91,6 +170,39 @@ class Producer
         rd_kafka_t *m_rk;
         string m_brokers;
         string m_compression_codec;
+
+        /* librdkafka keeps one topic per name on a producer, a handle
+         * of a known topic takes the conf of the first one, so the
+         * handles are keyed by the topic only, they are kept until
+         * invalidated or closed */
+        struct TopicHandle {
+            rd_kafka_topic_t *rkt;
+            /* the settings the handle is created with */
+            string settings;
+            /* a send with other settings has been warned about */
+            bool warned;
+        };
+        map<string, TopicHandle> m_topics;
+
+        /* librdkafka writes to the eventfd once its main queue, which
+         * holds the delivery reports, becomes non-empty */
+        rd_kafka_queue_t *m_queue;
+        int m_event_fd;
+        uv_poll_t *m_poll_handle;
+
+        /* flow control, the bytes and messages queued and not yet
+         * reported, 0 high watermark for pausing only on a full queue.
+         * NOTE: rd_kafka_outq_len also counts the events not served */
+        size_t m_queued_bytes;
+        long m_queued_messages;
+        size_t m_high_watermark_bytes;
+        size_t m_low_watermark_bytes;
+        long m_low_watermark_messages;
+        bool m_paused;
+        map<void *, FlowFunc> m_flow_listeners;
+
+        unsigned long m_delivered_messages;
+        unsigned long m_failed_messages;
 };
 
 } // namespace logkafka
@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/record_assembler.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "base/ref_counted.h"
+
+#include "easylogging/easylogging++.h"
+
+namespace logkafka {
+
+namespace {
+
+/* heap copy of a record whose lines are not contiguous */
+class RecordBuffer : public RefCounted
+{
+    public:
+        explicit RecordBuffer(size_t len): m_data((char *)malloc(len)) {};
+        char *data() { return m_data; };
+
+    protected:
+        virtual ~RecordBuffer() { free(m_data); };
+
+    private:
+        char *m_data;
+};
+
+} // namespace
+
+RecordAssembler::RecordAssembler()
+{/*{{{*/
+    m_max_lines = 0;
+    m_max_bytes = 0;
+    m_max_age_ms = 0;
+    m_line_delimiter = "\n";
+    m_remove_delimiter = true;
+    m_pending_offset = 0;
+    m_pending_lines = 0;
+    m_pending_bytes = 0;
+    m_pending_time = (struct timeval){0};
+}/*}}}*/
+
+RecordAssembler::~RecordAssembler()
+{/*{{{*/
+}/*}}}*/
+
+bool RecordAssembler::init(const MultilineConf &conf,
+        const string &line_delimiter,
+        bool remove_delimiter)
+{/*{{{*/
+    if (conf.start_pattern == "") {
+        LINFO << "Multiline start pattern is not set";
+        return false;
+    }
+
+    if (!m_start_regex.init(conf.start_pattern)) {
+        return false;
+    }
+
+    m_max_lines = max(conf.max_lines, 1);
+    m_max_bytes = max(conf.max_bytes, 1);
+    m_max_age_ms = max(conf.max_age_ms, 0);
+    m_line_delimiter = line_delimiter;
+    m_remove_delimiter = remove_delimiter;
+
+    return true;
+}/*}}}*/
+
+void RecordAssembler::assemble(vector<LineSlice> &lines,
+        const vector<off_t> &offsets, size_t first)
+{/*{{{*/
+    /* at most one record is completed by each line, so the records
+     * never overtake the lines which are not assembled yet */
+    size_t out = first;
+
+    for (size_t i = first; i < lines.size(); ++i) {
+        LineSlice line = lines[i];
+        size_t joined_bytes = m_pending_bytes + line.length()
+            + (m_remove_delimiter? m_line_delimiter.length(): 0);
+
+        if (m_pending.empty()) {
+            /* continuation lines without start line are a record too */
+            begin(line, offsets[i]);
+        } else if (m_start_regex.match(line.data(), line.length())
+                || joined_bytes > m_max_bytes) {
+            lines[out++] = join();
+            begin(line, offsets[i]);
+        } else {
+            m_pending.push_back(line);
+            m_pending_lines += 1;
+            m_pending_bytes = joined_bytes;
+        }
+
+        if (m_pending_lines >= m_max_lines) {
+            lines[out++] = join();
+        }
+    }
+
+    lines.resize(out);
+}/*}}}*/
+
+bool RecordAssembler::flush(vector<LineSlice> &lines, bool force)
+{/*{{{*/
+    if (m_pending.empty()) {
+        return false;
+    }
+
+    if (!force) {
+        struct timeval cur_tv = (struct timeval){0};
+        if (0 != gettimeofday(&cur_tv, NULL)) {
+            LERROR << "Fail to get time";
+            return false;
+        }
+
+        long age_ms = (cur_tv.tv_sec - m_pending_time.tv_sec) * 1000L
+            + (cur_tv.tv_usec - m_pending_time.tv_usec) / 1000L;
+        if (age_ms < (long)m_max_age_ms) {
+            return false;
+        }
+    }
+
+    lines.push_back(join());
+
+    return true;
+}/*}}}*/
+
+void RecordAssembler::begin(const LineSlice &line, off_t offset)
+{/*{{{*/
+    m_pending.push_back(line);
+    m_pending_offset = offset;
+    m_pending_lines = 1;
+    m_pending_bytes = line.length();
+    if (0 != gettimeofday(&m_pending_time, NULL)) {
+        LERROR << "Fail to get time";
+    }
+}/*}}}*/
+
+LineSlice RecordAssembler::join()
+{/*{{{*/
+    LineSlice record;
+
+    if (1 == m_pending.size()) {
+        record = m_pending[0];
+        m_pending.clear();
+        m_pending_lines = 0;
+        m_pending_bytes = 0;
+        return record;
+    }
+
+    /* lines cut from the same buffer one after another, only the
+     * delimiters between them are removed */
+    size_t gap = m_remove_delimiter? m_line_delimiter.length(): 0;
+    bool contiguous = true;
+    for (size_t i = 1; i < m_pending.size(); ++i) {
+        const LineSlice &prev = m_pending[i - 1];
+        const LineSlice &cur = m_pending[i];
+        const char *prev_end = prev.data() + prev.length();
+        if (cur.owner() != prev.owner() || (cur.data() != prev_end
+                    && cur.data() != prev_end + gap)) {
+            contiguous = false;
+            break;
+        }
+    }
+
+    const LineSlice &front = m_pending.front();
+    const LineSlice &back = m_pending.back();
+
+    if (contiguous) {
+        record = LineSlice(front.data(),
+                back.data() + back.length() - front.data(), front.owner(),
+                front.offset());
+    } else {
+        record = copy();
+    }
+
+    m_pending.clear();
+    m_pending_lines = 0;
+    m_pending_bytes = 0;
+
+    return record;
+}/*}}}*/
+
+LineSlice RecordAssembler::copy()
+{/*{{{*/
+    size_t len = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        len += m_pending[i].length();
+    }
+    if (m_remove_delimiter) {
+        len += (m_pending.size() - 1) * m_line_delimiter.length();
+    }
+
+    RecordBuffer *buffer = new RecordBuffer(len);
+    char *p = buffer->data();
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        if (0 != i && m_remove_delimiter) {
+            memcpy(p, m_line_delimiter.data(), m_line_delimiter.length());
+            p += m_line_delimiter.length();
+        }
+        memcpy(p, m_pending[i].data(), m_pending[i].length());
+        p += m_pending[i].length();
+    }
+
+    LineSlice record(buffer->data(), len, buffer, m_pending.front().offset());
+    buffer->unref();
+
+    return record;
+}/*}}}*/
+
+void RecordAssembler::detach()
+{/*{{{*/
+    if (m_pending.empty()) {
+        return;
+    }
+
+    LineSlice record = copy();
+    m_pending.clear();
+    m_pending.push_back(record);
+    m_pending_bytes = record.length();
+}/*}}}*/
+
+void RecordAssembler::reset()
+{/*{{{*/
+    m_pending.clear();
+    m_pending_lines = 0;
+    m_pending_bytes = 0;
+}/*}}}*/
+
+} // namespace logkafka
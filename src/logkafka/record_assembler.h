@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_RECORD_ASSEMBLER_H_
+#define LOGKAFKA_RECORD_ASSEMBLER_H_
+
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "logkafka/line_slice.h"
+#include "logkafka/regex.h"
+#include "logkafka/task_conf.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Join multi-line records (e.g. stack traces) into one message.
+ *
+ * A line matching the start pattern begins a new record, the lines after
+ * it are joined to the record until the next start line, or the record
+ * reaches its max lines or bytes. The last record of a batch is kept
+ * pending, since its continuation lines may not have been written yet.
+ *
+ * The lines of one record are contiguous in the read buffer mostly, the
+ * record then refers to them in place, otherwise they are copied.
+ * */
+class RecordAssembler
+{
+    public:
+        RecordAssembler();
+        ~RecordAssembler();
+        bool init(const MultilineConf &conf,
+                const string &line_delimiter,
+                bool remove_delimiter);
+
+        /* Join lines[first, end) into records in place, offsets are the
+         * file offsets of these lines.
+         * */
+        void assemble(vector<LineSlice> &lines,
+                const vector<off_t> &offsets, size_t first);
+
+        /* Append the pending record to lines if it is older than max age,
+         * or force is set, return true if it is appended.
+         * */
+        bool flush(vector<LineSlice> &lines, bool force);
+
+        /* Copy the pending record out of the read buffer, so that the
+         * buffer can be reused before the record is completed.
+         * */
+        void detach();
+
+        /* Drop the pending record, e.g. the file is read again from an
+         * earlier offset.
+         * */
+        void reset();
+
+        bool hasPending() const { return !m_pending.empty(); };
+        /* the lines before this offset have been assembled */
+        off_t getPendingOffset() const { return m_pending_offset; };
+
+    private:
+        void begin(const LineSlice &line, off_t offset);
+        LineSlice join();
+        LineSlice copy();
+
+    private:
+        Regex m_start_regex;
+        unsigned long m_max_lines;
+        unsigned long m_max_bytes;
+        unsigned long m_max_age_ms;
+        string m_line_delimiter;
+        bool m_remove_delimiter;
+
+        vector<LineSlice> m_pending;
+        off_t m_pending_offset;
+        /* the lines may have been merged by detach */
+        size_t m_pending_lines;
+        size_t m_pending_bytes;
+        struct timeval m_pending_time;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_RECORD_ASSEMBLER_H_
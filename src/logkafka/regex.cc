@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/regex.h"
+
+#include <cctype>
+#include <cstring>
+
+#include "easylogging/easylogging++.h"
+
+namespace logkafka {
+
+const size_t Regex::JIT_STACK_MIN_BYTES = 32 * 1024;
+const size_t Regex::JIT_STACK_MAX_BYTES = 1024 * 1024;
+
+Regex::Regex()
+{/*{{{*/
+    m_re = NULL;
+    m_match_data = NULL;
+    m_match_context = NULL;
+    m_jit_stack = NULL;
+    m_jit = false;
+}/*}}}*/
+
+Regex::~Regex()
+{/*{{{*/
+    pcre2_match_context_free(m_match_context); m_match_context = NULL;
+    pcre2_jit_stack_free(m_jit_stack); m_jit_stack = NULL;
+    pcre2_match_data_free(m_match_data); m_match_data = NULL;
+    pcre2_code_free(m_re); m_re = NULL;
+}/*}}}*/
+
+bool Regex::init(const string &pattern)
+{/*{{{*/
+    PCRE2_SIZE erroffset;
+    int errorcode;
+
+    m_re = pcre2_compile((PCRE2_SPTR)pattern.c_str(), pattern.length(),
+            0, &errorcode, &erroffset, NULL);
+    if (NULL == m_re) {
+        PCRE2_UCHAR8 buffer[120];
+        (void)pcre2_get_error_message(errorcode, buffer, 120);
+        LERROR << "Fail to compile pattern " << pattern
+               << " at offset " << erroffset << ", " << buffer;
+        return false;
+    }
+
+    /* fall back to the interpreter if JIT is not supported */
+    int rc = pcre2_jit_compile(m_re, PCRE2_JIT_COMPLETE);
+    if (0 != rc) {
+        PCRE2_UCHAR8 buffer[120];
+        (void)pcre2_get_error_message(rc, buffer, 120);
+        LWARNING << "Fail to JIT compile pattern " << pattern
+                 << ", " << buffer;
+    } else {
+        /* the default JIT stack of 32K on machine stack is too small for
+         * some patterns, each instance has its own since it is not
+         * shared between threads */
+        m_jit_stack = pcre2_jit_stack_create(JIT_STACK_MIN_BYTES,
+                JIT_STACK_MAX_BYTES, NULL);
+        m_match_context = pcre2_match_context_create(NULL);
+        if (NULL == m_jit_stack || NULL == m_match_context) {
+            LERROR << "Fail to create JIT stack";
+            return false;
+        }
+        pcre2_jit_stack_assign(m_match_context, NULL, m_jit_stack);
+        m_jit = true;
+    }
+
+    /* the offsets of whole match and the first group are used */
+    m_match_data = pcre2_match_data_create(2, NULL);
+    if (NULL == m_match_data) {
+        LERROR << "Fail to create match data";
+        pcre2_code_free(m_re); m_re = NULL;
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+bool Regex::match(const char *data, size_t len)
+{/*{{{*/
+    /* the subject may not be NULL even if it is empty */
+    if (NULL == data) data = "";
+
+    /* the sanity checks of pcre2_match are skipped in JIT fast path */
+    int rc = m_jit? pcre2_jit_match(m_re, (PCRE2_SPTR)data, len, 0, 0,
+                        m_match_data, m_match_context):
+                    pcre2_match(m_re, (PCRE2_SPTR)data, len, 0, 0,
+                        m_match_data, NULL);
+
+    if (rc < 0 && PCRE2_ERROR_NOMATCH != rc) {
+        LWARNING << "Fail to match, error " << rc;
+    }
+
+    /* 0 is returned if the match data is too small for the groups */
+    return rc >= 0;
+}/*}}}*/
+
+bool Regex::capture(const char *data, size_t len,
+        const char **begin, size_t *length)
+{/*{{{*/
+    if (!match(data, len)) return false;
+
+    PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(m_match_data);
+    size_t group = (pcre2_get_ovector_count(m_match_data) > 1
+            && PCRE2_UNSET != ovector[2])? 1: 0;
+
+    *begin = data + ovector[2 * group];
+    *length = ovector[2 * group + 1] - ovector[2 * group];
+
+    return true;
+}/*}}}*/
+
+/* skip the group or class begins at pattern[i], return the position after
+ * it, or string::npos if it is not closed */
+static size_t skipBracket(const string &pattern, size_t i)
+{/*{{{*/
+    if ('[' == pattern[i]) {
+        size_t k = i + 1;
+        if (k < pattern.length() && '^' == pattern[k]) ++k;
+        /* "]" right after "[" or "[^" is a literal */
+        if (k < pattern.length() && ']' == pattern[k]) ++k;
+        for (; k < pattern.length(); ++k) {
+            if ('\\' == pattern[k]) {
+                ++k;
+            } else if ('[' == pattern[k] && k + 1 < pattern.length()
+                    && strchr(":.=", pattern[k + 1])) {
+                /* [:alpha:], [.a.] or [=a=] */
+                k = pattern.find(string(1, pattern[k + 1]) + "]", k + 2);
+                if (string::npos == k) return k;
+                ++k;
+            } else if (']' == pattern[k]) {
+                return k + 1;
+            }
+        }
+        return string::npos;
+    }
+
+    int depth = 0;
+    for (size_t k = i; k < pattern.length(); ++k) {
+        char c = pattern[k];
+        if ('\\' == c) {
+            ++k;
+        } else if ('[' == c) {
+            k = skipBracket(pattern, k);
+            if (string::npos == k) return k;
+            --k;
+        } else if ('(' == c) {
+            ++depth;
+        } else if (')' == c) {
+            if (0 == --depth) return k + 1;
+        }
+    }
+    return string::npos;
+}/*}}}*/
+
+string Regex::requiredLiteral(const string &pattern)
+{/*{{{*/
+    /* option settings (e.g. "(?i)") and verbs (e.g. "(*UTF)") change how
+     * literals match, \Q...\E is not worth the trouble */
+    for (size_t i = 0; i + 1 < pattern.length(); ++i) {
+        if ('\\' == pattern[i]) {
+            if ('Q' == pattern[i + 1]) return "";
+            ++i;
+        } else if ('(' == pattern[i]
+                && ('*' == pattern[i + 1] || ('?' == pattern[i + 1]
+                        && i + 2 < pattern.length()
+                        && strchr("imnsxJU-^)", pattern[i + 2])))) {
+            return "";
+        }
+    }
+
+    string best, run;
+    /* the last atom is the last byte of run */
+    bool last_literal = false;
+
+    for (size_t i = 0; i < pattern.length(); ) {
+        char c = pattern[i];
+        int literal = -1;
+
+        if ('\\' == c) {
+            if (i + 1 >= pattern.length()) return "";
+            /* \d, \b, \1, \x{..} etc. are not literals */
+            if (!isalnum((unsigned char)pattern[i + 1])) {
+                literal = (unsigned char)pattern[i + 1];
+            }
+            i += 2;
+        } else if ('|' == c || ')' == c) {
+            /* alternation at top level */
+            return "";
+        } else if ('(' == c || '[' == c) {
+            i = skipBracket(pattern, i);
+            if (string::npos == i) return "";
+        } else if ('*' == c || '?' == c) {
+            /* the quantified atom may be absent */
+            if (last_literal) run.erase(run.length() - 1);
+            ++i;
+        } else if ('+' == c) {
+            ++i;
+        } else if ('{' == c) {
+            size_t end = pattern.find('}', i);
+            string bounds = string::npos == end? "":
+                pattern.substr(i + 1, end - i - 1);
+            if (!bounds.empty() && string::npos
+                    == bounds.find_first_not_of("0123456789,")) {
+                /* {0}, {0,n} or {,n} */
+                if (last_literal && ('0' == bounds[0] || ',' == bounds[0])) {
+                    run.erase(run.length() - 1);
+                }
+                i = end + 1;
+            } else {
+                literal = (unsigned char)c;
+                ++i;
+            }
+        } else if ('.' == c || '^' == c || '$' == c) {
+            ++i;
+        } else {
+            literal = (unsigned char)c;
+            ++i;
+        }
+
+        if (-1 != literal) {
+            run += (char)literal;
+            last_literal = true;
+        } else {
+            /* a quantified literal ends the run too */
+            if (run.length() > best.length()) best = run;
+            run.clear();
+            last_literal = false;
+        }
+    }
+
+    if (run.length() > best.length()) best = run;
+
+    return best;
+}/*}}}*/
+
+} // namespace logkafka
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_REGEX_H_
+#define LOGKAFKA_REGEX_H_
+
+#include <string>
+
+#include "base/noncopyable.h"
+#include "logkafka/common.h"
+
+#include "pcre2.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* Compiled PCRE2 pattern with its own match data and JIT stack,
+ * not thread-safe */
+class Regex : base::noncopyable
+{
+    public:
+        Regex();
+        ~Regex();
+        bool init(const string &pattern);
+        bool isValid() const { return NULL != m_re; };
+        bool isJit() const { return m_jit; };
+
+        /* match data[0, len), the data need not be NUL-terminated */
+        bool match(const char *data, size_t len);
+
+        /* match data[0, len), the first capturing group, or the whole
+         * match if the group is unset, is returned with begin and length,
+         * no data is copied */
+        bool capture(const char *data, size_t len,
+                const char **begin, size_t *length);
+
+        /* The longest literal which every match of pattern contains, ""
+         * if none is found, e.g. "GET /health" of "^GET /health(z)?$".
+         * The extraction is conservative, it gives up on alternation at
+         * top level and on option settings. */
+        static string requiredLiteral(const string &pattern);
+
+    private:
+        pcre2_code *m_re;
+        pcre2_match_data *m_match_data;
+        pcre2_match_context *m_match_context;
+        pcre2_jit_stack *m_jit_stack;
+        bool m_jit;
+
+        static const size_t JIT_STACK_MIN_BYTES;
+        static const size_t JIT_STACK_MAX_BYTES;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_REGEX_H_
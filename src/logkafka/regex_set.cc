@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/regex_set.h"
+
+#include <algorithm>
+
+#include "easylogging/easylogging++.h"
+
+namespace logkafka {
+
+RegexSet::~RegexSet()
+{/*{{{*/
+    for (size_t i = 0; i < m_regexes.size(); ++i) {
+        delete m_regexes[i];
+    }
+    m_regexes.clear();
+}/*}}}*/
+
+bool RegexSet::init(const vector<string> &patterns)
+{/*{{{*/
+    m_patterns = patterns;
+
+    vector<string> literals;
+    for (size_t i = 0; i < m_patterns.size(); ++i) {
+        Regex *regex = new Regex();
+        m_regexes.push_back(regex);
+        if (!regex->init(m_patterns[i])) {
+            return false;
+        }
+
+        literals.push_back(Regex::requiredLiteral(m_patterns[i]));
+        if (literals.back().empty()) {
+            LINFO << "No literal is required by pattern " << m_patterns[i]
+                  << ", it is matched with every line";
+            m_unfiltered.push_back(i);
+        }
+    }
+
+    return m_prefilter.init(literals);
+}/*}}}*/
+
+int RegexSet::match(const char *data, size_t len)
+{/*{{{*/
+    m_candidates.assign(m_unfiltered.begin(), m_unfiltered.end());
+    m_prefilter.search(data, len, m_candidates);
+    if (m_candidates.empty()) return -1;
+
+    sort(m_candidates.begin(), m_candidates.end());
+    for (size_t i = 0; i < m_candidates.size(); ++i) {
+        size_t idx = m_candidates[i];
+        if (m_regexes[idx]->match(data, len)) {
+            return idx;
+        }
+    }
+
+    return -1;
+}/*}}}*/
+
+} // namespace logkafka
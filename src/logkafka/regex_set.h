@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_REGEX_SET_H_
+#define LOGKAFKA_REGEX_SET_H_
+
+#include <string>
+#include <vector>
+
+#include "base/aho_corasick.h"
+#include "base/noncopyable.h"
+#include "logkafka/regex.h"
+
+using namespace std;
+
+namespace logkafka {
+
+/* A list of patterns matched together, not thread-safe.
+ *
+ * The literal required by each pattern is searched for in one
+ * Aho-Corasick pass over the data, only the patterns whose literal is
+ * found, and the ones without literal, are matched with PCRE2.
+ * */
+class RegexSet : base::noncopyable
+{
+    public:
+        RegexSet() {};
+        ~RegexSet();
+        bool init(const vector<string> &patterns);
+        size_t size() const { return m_patterns.size(); };
+        const string &getPattern(size_t i) const { return m_patterns[i]; };
+
+        /* the index of the first pattern of the list matching
+         * data[0, len), -1 if none matches */
+        int match(const char *data, size_t len);
+
+    private:
+        vector<string> m_patterns;
+        vector<Regex *> m_regexes;
+
+        base::AhoCorasick m_prefilter;
+        /* patterns without required literal, always matched */
+        vector<size_t> m_unfiltered;
+        vector<size_t> m_candidates;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_REGEX_SET_H_
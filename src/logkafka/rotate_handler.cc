@@ -26,11 +26,18 @@
 
 namespace logkafka {
 
+RotateHandler::~RotateHandler()
+{
+    stop();
+}
+
 bool RotateHandler::init(string path,
                          void *rotate_func_arg,
-                         RotateFunc on_rotate)
+                         RotateFunc on_rotate,
+                         UringEngine *engine)
 {
     m_path = path;
+    m_engine = engine;
     m_rotate_func_arg = rotate_func_arg;
     m_rotate_func = on_rotate;
     m_inode = INO_NONE;
@@ -53,7 +60,13 @@ void RotateHandler::onNotify(void *arg)
         return;
     }
 
-    FILE *file = NULL;
+    if (NULL != rh->m_engine) {
+        /* the last stat is not completed yet */
+        if (NULL != rh->m_stat_request) return;
+
+        rh->m_stat_request = rh->m_engine->stat(rh->m_path, onStatComplete, rh);
+        if (NULL != rh->m_stat_request) return;
+    }
 
     struct stat buf;
     off_t fsize;
@@ -66,12 +79,44 @@ void RotateHandler::onNotify(void *arg)
         inode = INO_NONE;
     }
 
-    if (rh->m_inode != inode || fsize < rh->m_fsize) {
-        LINFO << "Opening file " << rh->m_path;
+    rh->checkRotate(fsize, inode);
+}
+
+void RotateHandler::stop()
+{
+    if (NULL != m_stat_request) {
+        m_engine->cancel(m_stat_request);
+        m_stat_request = NULL;
+    }
+}
+
+void RotateHandler::onStatComplete(void *arg, int res, const UringRequest *req)
+{
+    RotateHandler *rh = (RotateHandler *)arg;
+    rh->m_stat_request = NULL;
+
+    off_t fsize = 0;
+    ino_t inode = INO_NONE;
+#ifdef STATX_INO
+    if (0 == res) {
+        fsize = req->stx.stx_size;
+        inode = req->stx.stx_ino;
+    }
+#endif
+
+    rh->checkRotate(fsize, inode);
+}
+
+void RotateHandler::checkRotate(off_t fsize, ino_t inode)
+{
+    FILE *file = NULL;
+
+    if (m_inode != inode || fsize < m_fsize) {
+        LINFO << "Opening file " << m_path;
 
-        file = fopen(rh->m_path.c_str(), "r");
+        file = fopen(m_path.c_str(), "r");
         if (file == NULL) {
-            LWARNING << "Fail to open file " << rh->m_path << ", " << strerror(errno);
+            LWARNING << "Fail to open file " << m_path << ", " << strerror(errno);
             return;
         }
 
@@ -80,18 +125,18 @@ void RotateHandler::onNotify(void *arg)
                << ", inode: " << getInode(file);
 
         /* we can update inode and fsize of rotate handler only when rotating done */
-        if (!(*rh->m_rotate_func)(rh->m_rotate_func_arg, file)) {
-            LWARNING << "Fail to rotate " << rh->m_path;
+        if (!(*m_rotate_func)(m_rotate_func_arg, file)) {
+            LWARNING << "Fail to rotate " << m_path;
         } else {
-            LINFO << "Finish rotating " << rh->m_path;
-            rh->updateLastRotateTime();
-            rh->m_inode = inode;
-            rh->m_fsize = fsize;
+            LINFO << "Finish rotating " << m_path;
+            updateLastRotateTime();
+            m_inode = inode;
+            m_fsize = fsize;
             file = NULL;
         }
-    } else if (fsize > rh->m_fsize) {
+    } else if (fsize > m_fsize) {
         /* inode is the same, and file is not truncated, we should update recorded file size */
-        rh->m_fsize = fsize;
+        m_fsize = fsize;
     }
 
     if (NULL != file) {
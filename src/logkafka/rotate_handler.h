@@ -33,6 +33,7 @@
 #include "base/common.h"
 #include "base/mutex.h"
 #include "base/scoped_lock.h"
+#include "logkafka/uring_engine.h"
 
 #include "easylogging/easylogging++.h"
 
@@ -46,11 +47,18 @@ typedef bool (*RotateFunc)(void *, FILE *);
 class RotateHandler
 {
     public:
-        RotateHandler() {m_last_rotate_time = (struct timeval){0};};
+        RotateHandler() {
+            m_last_rotate_time = (struct timeval){0};
+            m_engine = NULL;
+            m_stat_request = NULL;
+        };
+        ~RotateHandler();
         bool init(string path,
                   void *rotate_func_arg,
-                  RotateFunc on_rotate);
+                  RotateFunc on_rotate,
+                  UringEngine *engine = NULL);
         static void onNotify(void *arg);
+        void stop();
         void updateLastRotateTime();
         bool getLastRotateTime(struct timeval &tv);
 
@@ -62,6 +70,12 @@ class RotateHandler
         off_t m_fsize;
 
     private:
+        static void onStatComplete(void *arg, int res, const UringRequest *req);
+        void checkRotate(off_t fsize, ino_t inode);
+
+    private:
+        UringEngine *m_engine;
+        UringRequest *m_stat_request;
         struct timeval m_last_rotate_time;
         Mutex m_last_rotate_time_mutex;
 };
@@ -30,17 +30,25 @@ TailWatcher::TailWatcher()
 {/*{{{*/
     m_receive_func = NULL;
     m_timer_trigger = NULL;
+    m_resume_trigger = NULL;
     m_stat_trigger = NULL;
     m_rotate_handler = NULL;
     m_output = NULL;
+    m_engine = NULL;
+    m_filter_pool = NULL;
     m_manager = NULL;
     m_filter = NULL;
+    m_output_paused = false;
 }/*}}}*/
 
 TailWatcher::~TailWatcher()
 {/*{{{*/
     m_timer_trigger->close();
     delete m_timer_trigger; m_timer_trigger = NULL;
+    if (NULL != m_resume_trigger) {
+        m_resume_trigger->close();
+        delete m_resume_trigger; m_resume_trigger = NULL;
+    }
     m_stat_trigger->close();
     delete m_stat_trigger; m_stat_trigger = NULL;
     {
@@ -62,15 +70,24 @@ bool TailWatcher::init(uv_loop_t *loop,
         unsigned long stat_silent_max_ms,
         bool read_from_head,
         unsigned long max_line_at_once,
+        unsigned long batch_min_lines,
+        unsigned long batch_max_lines,
         unsigned long line_max_bytes, 
         unsigned long read_max_bytes,
-        char line_delimiter,
+        unsigned long mmap_min_bytes,
+        unsigned long direct_min_bytes,
+        bool pagecache_dontneed,
+        unsigned long max_inflight_bytes,
+        const string &line_delimiter,
         bool remove_delimiter,
+        unsigned int length_prefix_bytes,
         UpdateFunc updateWatcher,
         ReceiveFunc receiveLines,
         TaskConf conf,
         Manager *manager,
-        Output *output)
+        Output *output,
+        UringEngine *engine,
+        FilterPool *filter_pool)
 {/*{{{*/
     /* We will not close watch until stat change time expired m_stat_silent_max_ms, 
      * remove or change state_wait to infinite */
@@ -81,24 +98,74 @@ bool TailWatcher::init(uv_loop_t *loop,
     m_position_entry = position_entry; 
     m_read_from_head = read_from_head;
     m_max_line_at_once = max_line_at_once;
+    m_batch_min_lines = batch_min_lines;
+    m_batch_max_lines = batch_max_lines;
     m_line_max_bytes = line_max_bytes;
     m_read_max_bytes = read_max_bytes;
+    m_mmap_min_bytes = mmap_min_bytes;
+    m_direct_min_bytes = direct_min_bytes;
+    m_pagecache_dontneed = pagecache_dontneed;
+    m_max_inflight_bytes = max_inflight_bytes;
     m_line_delimiter = line_delimiter;
     m_remove_delimiter = remove_delimiter;
+    m_length_prefix_bytes = length_prefix_bytes;
     m_updateWatcher = updateWatcher;
     m_receive_func = receiveLines;
     m_conf = conf;
     m_manager = manager;
     m_output = output; 
+    m_engine = engine;
+    m_filter_pool = filter_pool;
 
     m_loop = loop;
 
-    m_filter = new FilterRegex(conf.filter_conf);
+    if (!conf.filter_conf.stages.empty()) {
+        m_filter = new FilterChain(conf.filter_conf);
+    } else if (!conf.filter_conf.regex_filter_patterns.empty()) {
+        m_filter = new FilterMultiRegex(conf.filter_conf);
+    } else {
+        m_filter = new FilterRegex(conf.filter_conf);
+    }
     if (!m_filter->init(NULL)) {
         LWARNING << "Fail to init filter";
         delete m_filter; m_filter = NULL;
     }
 
+    /* the json filter, the plugins and the sample filter wrap the
+     * filter above, if any */
+    if (!conf.filter_conf.json_predicates.empty()) {
+        FilterJson *filter_json = new FilterJson(conf.filter_conf);
+        if (filter_json->init(m_filter)) {
+            m_filter = filter_json;
+        } else {
+            LWARNING << "Fail to init json filter";
+            delete filter_json;
+        }
+    }
+
+    for (size_t i = 0; i < conf.filter_conf.plugins.size(); ++i) {
+        FilterPlugin *filter_plugin =
+            new FilterPlugin(conf.filter_conf.plugins[i]);
+        if (filter_plugin->init(m_filter)) {
+            m_filter = filter_plugin;
+        } else {
+            LWARNING << "Fail to init filter plugin "
+                     << conf.filter_conf.plugins[i].path;
+            delete filter_plugin;
+        }
+    }
+
+    if (conf.filter_conf.sample_conf.isEnabled()) {
+        FilterSample *filter_sample =
+            new FilterSample(conf.filter_conf.sample_conf);
+        if (filter_sample->init(m_filter)) {
+            m_filter = filter_sample;
+        } else {
+            LWARNING << "Fail to init sample filter";
+            delete filter_sample;
+        }
+    }
+
     m_timer_trigger = new TimerWatcher();
     if (!m_timer_trigger->init(m_loop, 0, TIMER_WATCHER_DEFAULT_REPEAT,
                 this, &onNotify)) {
@@ -107,6 +174,15 @@ bool TailWatcher::init(uv_loop_t *loop,
         return false;
     }
 
+    /* started by onFlowChange */
+    m_resume_trigger = new TimerWatcher();
+    if (!m_resume_trigger->init(m_loop, 0, 0, this, &onNotify)) {
+        LERROR << "Fail to init resume watcher";
+        delete m_resume_trigger; m_resume_trigger = NULL;
+        return false;
+    }
+    m_resume_trigger->stop();
+
     m_stat_trigger = new StatWatcher();
     if (!m_stat_trigger->init(m_loop, path, STAT_WATCHER_DEFAULT_INTERVAL,
                 this, &onNotify)) {
@@ -120,13 +196,17 @@ bool TailWatcher::init(uv_loop_t *loop,
     {
         ScopedLock l(m_rotate_handler_mutex);
         m_rotate_handler = new RotateHandler(); 
-        if (!m_rotate_handler->init(path, this, onRotate)) {
+        if (!m_rotate_handler->init(path, this, onRotate, m_engine)) {
             LERROR << "Fail to init rotate handler";
             delete m_rotate_handler; m_rotate_handler = NULL;
             return false;
         }
     }
 
+    if (NULL != m_output) {
+        m_output->setFlowCallback(this, &onFlowChange);
+    }
+
     return true;
 }/*}}}*/
 
@@ -144,8 +224,26 @@ void TailWatcher::onNotify(void *arg)
     {
         /* handle io */
         ScopedLock l(tw->m_io_handler_mutex);
-        if (NULL != tw->m_io_handler)
+        if (NULL != tw->m_io_handler) {
+            tw->m_io_handler->setOutputPaused(tw->m_output_paused);
             tw->m_io_handler->onNotify((void *)tw->m_io_handler);
+        }
+    }
+}/*}}}*/
+
+void TailWatcher::onFlowChange(void *arg, bool paused)
+{/*{{{*/
+    TailWatcher *tw = (TailWatcher *)arg;
+
+    /* NOTE: it may be called while the io handler is sending, so that
+     * the reading stops at once, and the notify is deferred */
+    tw->m_output_paused = paused;
+    if (NULL != tw->m_io_handler) {
+        tw->m_io_handler->setOutputPaused(paused);
+    }
+
+    if (!paused && NULL != tw->m_resume_trigger) {
+        tw->m_resume_trigger->start();
     }
 }/*}}}*/
 
@@ -154,10 +252,16 @@ bool TailWatcher::onRotate(void *arg, FILE *file)
     TailWatcher *tw = (TailWatcher *)arg;
     PositionEntry *pe = tw->m_position_entry;
     unsigned int max_line_at_once = tw->m_max_line_at_once;
+    unsigned int batch_min_lines = tw->m_batch_min_lines;
+    unsigned int batch_max_lines = tw->m_batch_max_lines;
     unsigned int line_max_bytes = tw->m_line_max_bytes;
     unsigned int read_max_bytes = tw->m_read_max_bytes;
-    char line_delimiter = tw->m_line_delimiter;
+    unsigned long mmap_min_bytes = tw->m_mmap_min_bytes;
+    unsigned long direct_min_bytes = tw->m_direct_min_bytes;
+    bool pagecache_dontneed = tw->m_pagecache_dontneed;
+    string line_delimiter = tw->m_line_delimiter;
     bool remove_delimiter = tw->m_remove_delimiter;
+    unsigned int length_prefix_bytes = tw->m_length_prefix_bytes;
     ReceiveFunc receiveLines = tw->m_receive_func;
     UpdateFunc updateWatcher = tw->m_updateWatcher;
 
@@ -188,9 +292,13 @@ bool TailWatcher::onRotate(void *arg, FILE *file)
 
             tw->m_io_handler = new IOHandler();
             bool res = tw->m_io_handler->init(file, pe, max_line_at_once, 
-                    line_max_bytes, read_max_bytes,
-                    line_delimiter, remove_delimiter,
-                    tw->m_filter, tw->m_output, receiveLines);
+                    batch_min_lines, batch_max_lines,
+                    line_max_bytes, read_max_bytes, mmap_min_bytes,
+                    direct_min_bytes, pagecache_dontneed,
+                    line_delimiter, remove_delimiter, length_prefix_bytes,
+                    tw->m_conf.multiline_conf,
+                    tw->m_filter, tw->m_output, receiveLines, tw->m_engine,
+                    tw->m_filter_pool, tw->m_max_inflight_bytes);
             if (!res) {
                 LERROR << "Fail to init io handler, inode: " << inode;
                 delete tw->m_io_handler; tw->m_io_handler = NULL;
@@ -210,15 +318,20 @@ bool TailWatcher::onRotate(void *arg, FILE *file)
 
                 IOHandler *io_handler = new IOHandler();
                 bool res = io_handler->init(file, pe, max_line_at_once, 
-                        line_max_bytes, read_max_bytes,
-                        line_delimiter, remove_delimiter,
-                        tw->m_filter, tw->m_output, receiveLines);
+                        batch_min_lines, batch_max_lines,
+                        line_max_bytes, read_max_bytes, mmap_min_bytes,
+                        direct_min_bytes, pagecache_dontneed,
+                        line_delimiter, remove_delimiter, length_prefix_bytes,
+                    tw->m_conf.multiline_conf,
+                        tw->m_filter, tw->m_output, receiveLines, tw->m_engine,
+                        tw->m_filter_pool, tw->m_max_inflight_bytes);
                 if (!res) {
                     LERROR << "Fail to init io handler, inode: " << inode;
                     delete io_handler;
                     return false;
                 }
 
+                tw->m_io_handler->flushRecord(false);
                 tw->m_io_handler->close();
 
                 delete tw->m_io_handler;
@@ -229,15 +342,20 @@ bool TailWatcher::onRotate(void *arg, FILE *file)
 
                 IOHandler *io_handler = new IOHandler();
                 bool res = io_handler->init(file, pe, max_line_at_once, 
-                        line_max_bytes, read_max_bytes,
-                        line_delimiter, remove_delimiter,
-                        tw->m_filter, tw->m_output, receiveLines);
+                        batch_min_lines, batch_max_lines,
+                        line_max_bytes, read_max_bytes, mmap_min_bytes,
+                        direct_min_bytes, pagecache_dontneed,
+                        line_delimiter, remove_delimiter, length_prefix_bytes,
+                    tw->m_conf.multiline_conf,
+                        tw->m_filter, tw->m_output, receiveLines, tw->m_engine,
+                        tw->m_filter_pool, tw->m_max_inflight_bytes);
                 if (!res) {
                     LERROR << "Fail to init io handler, inode: " << inode;
                     delete io_handler;
                     return false;
                 }
 
+                tw->m_io_handler->flushRecord(false);
                 delete tw->m_io_handler;
                 tw->m_io_handler = io_handler;
             } else {
@@ -277,10 +395,19 @@ void TailWatcher::stop(bool close_io)
 {/*{{{*/
     if (NULL != m_timer_trigger) m_timer_trigger->stop();
     if (NULL != m_stat_trigger) m_stat_trigger->stop();
+    if (NULL != m_resume_trigger) m_resume_trigger->stop();
+    if (NULL != m_output) m_output->setFlowCallback(NULL, NULL);
+    m_output_paused = false;
+
+    {
+        ScopedLock l(m_rotate_handler_mutex);
+        if (NULL != m_rotate_handler) m_rotate_handler->stop();
+    }
 
     ScopedLock l(m_io_handler_mutex);
     if (close_io && NULL != m_io_handler) {
         m_io_handler->onNotify(this->m_io_handler);
+        m_io_handler->flushRecord(true);
         m_io_handler->close();
     }
 }/*}}}*/
@@ -289,6 +416,7 @@ void TailWatcher::start()
 {/*{{{*/
     if (m_timer_trigger) m_timer_trigger->start();
     if (m_stat_trigger) m_stat_trigger->start();
+    if (m_output) m_output->setFlowCallback(this, &onFlowChange);
     onNotify(this);
 }/*}}}*/
 
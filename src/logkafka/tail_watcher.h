@@ -33,7 +33,12 @@
 #include "base/timer_watcher.h"
 #include "logkafka/io_handler.h"
 #include "logkafka/filter.h"
+#include "logkafka/filter_chain.h"
+#include "logkafka/filter_json.h"
+#include "logkafka/filter_multi_regex.h"
+#include "logkafka/filter_plugin.h"
 #include "logkafka/filter_regex.h"
+#include "logkafka/filter_sample.h"
 #include "logkafka/manager.h"
 #include "logkafka/memory_position_entry.h"
 #include "logkafka/output.h"
@@ -64,17 +69,27 @@ class TailWatcher
                 unsigned long stat_silent_max_ms,
                 bool read_from_head,
                 unsigned long max_line_at_once,
+                unsigned long batch_min_lines,
+                unsigned long batch_max_lines,
                 unsigned long line_max_bytes, 
                 unsigned long read_max_bytes,
-                char line_delimiter,
+                unsigned long mmap_min_bytes,
+                unsigned long direct_min_bytes,
+                bool pagecache_dontneed,
+                unsigned long max_inflight_bytes,
+                const string &line_delimiter,
                 bool remove_delimiter,
+                unsigned int length_prefix_bytes,
                 UpdateFunc updateWatcher,
                 ReceiveFunc receiveLines,
                 TaskConf conf,
                 Manager *manager,
-                Output *output);
+                Output *output,
+                UringEngine *engine,
+                FilterPool *filter_pool);
 
         static void onNotify(void *arg);
+        static void onFlowChange(void *arg, bool paused);
         static bool onRotate(void *arg, FILE *file);
         static PositionEntry * swapState(PositionEntry **pep, IOHandler *io_handler);
 
@@ -101,6 +116,8 @@ class TailWatcher
         struct event_base *m_base;
         uv_loop_t *m_loop;
         TimerWatcher *m_timer_trigger;
+        /* fires once when the output resumes */
+        TimerWatcher *m_resume_trigger;
         StatWatcher *m_stat_trigger;
         RotateHandler *m_rotate_handler;
         IOHandler *m_io_handler;
@@ -109,14 +126,24 @@ class TailWatcher
         ReceiveFunc m_receive_func;
         Manager *m_manager;
         Output *m_output;
+        UringEngine *m_engine;
+        FilterPool *m_filter_pool;
         bool m_read_from_head;
         unsigned long m_max_line_at_once;
+        unsigned long m_batch_min_lines;
+        unsigned long m_batch_max_lines;
         unsigned long m_line_max_bytes;
         unsigned long m_read_max_bytes;
-        char m_line_delimiter;
+        unsigned long m_mmap_min_bytes;
+        unsigned long m_direct_min_bytes;
+        bool m_pagecache_dontneed;
+        unsigned long m_max_inflight_bytes;
+        string m_line_delimiter;
         bool m_remove_delimiter;
+        unsigned int m_length_prefix_bytes;
         unsigned long m_stat_silent_max_ms;
         Filter *m_filter;
+        bool m_output_paused;
 
     private:
         Mutex m_io_handler_mutex;
@@ -133,6 +160,8 @@ void TailWatcher::Serialize(JsonWriter& writer)
     long inode = INO_NONE;
     long filepos = -1;
     long filesize = 0;
+    long pagecache = 0;
+    long batchsize = 0;
     struct timeval last_rotate_time = (struct timeval){0};
 
     {
@@ -141,6 +170,8 @@ void TailWatcher::Serialize(JsonWriter& writer)
             inode = m_io_handler->getFileInode();
             filepos = m_io_handler->getFilePos();
             filesize = m_io_handler->getFileSize();
+            pagecache = m_io_handler->getPageCacheBytes();
+            batchsize = m_io_handler->getBatchSize();
         }
     }
 
@@ -164,6 +195,41 @@ void TailWatcher::Serialize(JsonWriter& writer)
     writer.String(int2Str(filepos).c_str());
     writer.String("filesize");
     writer.String(int2Str(filesize).c_str());
+    writer.String("pagecache");
+    writer.String(int2Str(pagecache).c_str());
+    writer.String("batchsize");
+    writer.String(int2Str(batchsize).c_str());
+
+    FilterStats filter_stats;
+    if (NULL != m_filter) {
+        m_filter->getStats(filter_stats);
+    }
+    if (!filter_stats.empty()) {
+        writer.String("filter");
+        writer.StartObject();
+        for (size_t i = 0; i < filter_stats.size(); ++i) {
+            const string &name = filter_stats[i].first;
+            writer.String(name.c_str(), (rapidjson::SizeType)name.length());
+            writer.String(int2Str(filter_stats[i].second).c_str());
+        }
+        writer.EndObject();
+    }
+
+    OutputStats output_stats;
+    if (NULL != m_output) {
+        m_output->getStats(output_stats);
+    }
+    if (!output_stats.empty()) {
+        writer.String("output");
+        writer.StartObject();
+        for (size_t i = 0; i < output_stats.size(); ++i) {
+            const string &name = output_stats[i].first;
+            const string &value = output_stats[i].second;
+            writer.String(name.c_str(), (rapidjson::SizeType)name.length());
+            writer.String(value.c_str(), (rapidjson::SizeType)value.length());
+        }
+        writer.EndObject();
+    }
     writer.String("last_rotate_time_sec");
     writer.String(int2Str(last_rotate_time_sec).c_str());
 
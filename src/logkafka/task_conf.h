@@ -25,6 +25,7 @@
 #include <ostream>
 #include <queue>
 #include <string>
+#include <vector>
 
 #include "base/tools.h"
 #include "logkafka/config.h"
@@ -47,20 +48,33 @@ struct LogConf {
      /* max lines of messages to be sent */
     int batchsize;
 
+    /* bounds of the batch size adjusted by lag, both equal
+     * to batchsize if not set, i.e. the batch size is fixed */
+    int batchsize_min;
+    int batchsize_max;
+
     bool read_from_head;
 
-    char line_delimiter;
+    /* one or more bytes, e.g. "\r\n" */
+    string line_delimiter;
 
     bool remove_delimiter;
 
+    /* if not 0, lines are framed by a big-endian length prefix
+     * of 1, 2, 4 or 8 bytes instead of line_delimiter */
+    int length_prefix_bytes;
+
     LogConf()
     {/*{{{*/
         log_path = "";
         follow_last = true;
         batchsize = 200;
+        batchsize_min = 0;
+        batchsize_max = 0;
         read_from_head = true;
-        line_delimiter = '\n';
+        line_delimiter = "\n";
         remove_delimiter = true;
+        length_prefix_bytes = 0;
     }/*}}}*/
 
     bool operator==(const LogConf& hs) const
@@ -68,8 +82,11 @@ struct LogConf {
         return (log_path == hs.log_path) &&
             (follow_last == hs.follow_last) &&
             (batchsize == hs.batchsize) &&
+            (batchsize_min == hs.batchsize_min) &&
+            (batchsize_max == hs.batchsize_max) &&
             (line_delimiter == hs.line_delimiter) &&
-            (remove_delimiter == hs.remove_delimiter);
+            (remove_delimiter == hs.remove_delimiter) &&
+            (length_prefix_bytes == hs.length_prefix_bytes);
     };/*}}}*/
 
     bool operator!=(const LogConf& hs) const
@@ -82,9 +99,12 @@ struct LogConf {
         os << "log path: " << lc.log_path
            << "follow last" << lc.follow_last
            << "batchsize" << lc.batchsize
+           << "batchsize min" << lc.batchsize_min
+           << "batchsize max" << lc.batchsize_max
            << "read from head" << lc.read_from_head
            << "line delimiter" << lc.line_delimiter
-           << "remove delimiter" << lc.remove_delimiter;
+           << "remove delimiter" << lc.remove_delimiter
+           << "length prefix bytes" << lc.length_prefix_bytes;
 
         return os;
     }/*}}}*/
@@ -93,6 +113,11 @@ struct LogConf {
     {/*{{{*/
         return isPathPatternLegal();
     }/*}}}*/
+
+    static bool isLengthPrefixBytesValid(int bytes)
+    {/*{{{*/
+        return 0 == bytes || 1 == bytes || 2 == bytes || 4 == bytes || 8 == bytes;
+    }/*}}}*/
     
     bool isPathPatternLegal()
     {/*{{{*/
@@ -104,9 +129,138 @@ struct LogConf {
     }/*}}}*/
 };
 
+struct FilterStageConf {
+    /* keep the matching lines if true, drop them otherwise */
+    bool include;
+
+    /* any of them matches, every line matches if empty */
+    vector<string> patterns;
+
+    FilterStageConf()
+    {/*{{{*/
+        include = false;
+    }/*}}}*/
+
+    bool operator==(const FilterStageConf& hs) const
+    {/*{{{*/
+        return (include == hs.include) &&
+            (patterns == hs.patterns);
+    };/*}}}*/
+
+    bool operator!=(const FilterStageConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+};
+
+struct JsonPredicateConf {
+    /* dot separated path of object fields, e.g. "user.id" */
+    string field;
+
+    /* eq, ne, in, exists, lt, le, gt or ge */
+    string op;
+
+    /* the operands as json scalars, e.g. "\"DEBUG\"" or "100" */
+    vector<string> values;
+
+    bool operator==(const JsonPredicateConf& hs) const
+    {/*{{{*/
+        return (field == hs.field) &&
+            (op == hs.op) &&
+            (values == hs.values);
+    };/*}}}*/
+
+    bool operator!=(const JsonPredicateConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+};
+
+struct SampleConf {
+    /* the fraction of lines kept, 1.0 keeps all */
+    double rate;
+
+    /* the lines with the same key, the first capturing group or the whole
+     * match, are kept or dropped together, empty to sample by count */
+    string key_pattern;
+
+    /* the rate is lowered to keep the task under these budgets, 0 for
+     * no budget */
+    unsigned long max_lines_per_sec;
+    unsigned long max_bytes_per_sec;
+
+    SampleConf()
+    {/*{{{*/
+        rate = 1.0;
+        key_pattern = "";
+        max_lines_per_sec = 0;
+        max_bytes_per_sec = 0;
+    }/*}}}*/
+
+    bool isEnabled() const
+    {/*{{{*/
+        return rate < 1.0 || max_lines_per_sec > 0 || max_bytes_per_sec > 0;
+    }/*}}}*/
+
+    bool operator==(const SampleConf& hs) const
+    {/*{{{*/
+        return (rate == hs.rate) &&
+            (key_pattern == hs.key_pattern) &&
+            (max_lines_per_sec == hs.max_lines_per_sec) &&
+            (max_bytes_per_sec == hs.max_bytes_per_sec);
+    };/*}}}*/
+
+    bool operator!=(const SampleConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+
+    static bool isRateValid(double rate)
+    {/*{{{*/
+        return rate >= 0.0 && rate <= 1.0;
+    }/*}}}*/
+};
+
+struct FilterPluginConf {
+    /* path of the shared object, see filter_plugin_abi.h */
+    string path;
+
+    /* passed to the create function of plugin */
+    string args;
+
+    bool operator==(const FilterPluginConf& hs) const
+    {/*{{{*/
+        return (path == hs.path) &&
+            (args == hs.args);
+    };/*}}}*/
+
+    bool operator!=(const FilterPluginConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+};
+
 struct FilterConf {
     string regex_filter_pattern;
 
+    /* dropped if any of them matches, see FilterMultiRegex */
+    vector<string> regex_filter_patterns;
+
+    /* the first stage matching a line decides, the lines matching no
+     * stage are kept, see FilterChain */
+    vector<FilterStageConf> stages;
+
+    /* the json lines not satisfying all of them are dropped,
+     * see FilterJson */
+    vector<JsonPredicateConf> json_predicates;
+
+    /* run in order on the lines kept by the filters above,
+     * see FilterPlugin */
+    vector<FilterPluginConf> plugins;
+
+    /* applied to the lines kept by the filters above, see FilterSample */
+    SampleConf sample_conf;
+
     FilterConf()
     {/*{{{*/
         regex_filter_pattern = "";
@@ -114,7 +268,12 @@ struct FilterConf {
 
     bool operator==(const FilterConf& hs) const
     {/*{{{*/
-        return (regex_filter_pattern == hs.regex_filter_pattern);
+        return (regex_filter_pattern == hs.regex_filter_pattern) &&
+            (regex_filter_patterns == hs.regex_filter_patterns) &&
+            (stages == hs.stages) &&
+            (json_predicates == hs.json_predicates) &&
+            (plugins == hs.plugins) &&
+            (sample_conf == hs.sample_conf);
     };/*}}}*/
 
     bool operator!=(const FilterConf& hs) const
@@ -124,10 +283,104 @@ struct FilterConf {
 
     friend ostream& operator << (ostream& os, const FilterConf& fc)
     {/*{{{*/
-        os << "regex filter pattern: " << fc.regex_filter_pattern;
+        os << "regex filter pattern: " << fc.regex_filter_pattern
+           << "regex filter patterns: " << fc.regex_filter_patterns.size()
+           << "regex filter stages: " << fc.stages.size()
+           << "json predicates: " << fc.json_predicates.size()
+           << "filter plugins: " << fc.plugins.size()
+           << "sample rate: " << fc.sample_conf.rate
+           << "sample key pattern: " << fc.sample_conf.key_pattern
+           << "sample max lines per sec: " << fc.sample_conf.max_lines_per_sec
+           << "sample max bytes per sec: " << fc.sample_conf.max_bytes_per_sec;
+
+        return os;
+    }/*}}}*/
+};
+
+struct MultilineConf {
+    /* a line matching this pattern starts a new record, the following
+     * lines not matching it are joined to the record, empty to disable */
+    string start_pattern;
+
+    /* the record is sent when it reaches one of these limits */
+    int max_lines;
+    int max_bytes;
+    int max_age_ms;
+
+    MultilineConf()
+    {/*{{{*/
+        start_pattern = "";
+        max_lines = 500;
+        max_bytes = 1048576;
+        max_age_ms = 3000;
+    }/*}}}*/
+
+    bool operator==(const MultilineConf& hs) const
+    {/*{{{*/
+        return (start_pattern == hs.start_pattern) &&
+            (max_lines == hs.max_lines) &&
+            (max_bytes == hs.max_bytes) &&
+            (max_age_ms == hs.max_age_ms);
+    };/*}}}*/
+
+    bool operator!=(const MultilineConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+
+    friend ostream& operator << (ostream& os, const MultilineConf& mc)
+    {/*{{{*/
+        os << "start pattern: " << mc.start_pattern
+           << "max lines" << mc.max_lines
+           << "max bytes" << mc.max_bytes
+           << "max age ms" << mc.max_age_ms;
+
+        return os;
+    }/*}}}*/
+};
+
+struct EnvelopeConf {
+    /* "json" wraps each line into a json object, "prefix" prepends the
+     * fields to it, empty to send the line as is */
+    string format;
+
+    /* the fields of the envelope, in order, of hostname, logkafka_id,
+     * path, inode and offset */
+    vector<string> fields;
+
+    /* the separator of fields and the line in prefix format */
+    string delimiter;
+
+    EnvelopeConf()
+    {/*{{{*/
+        format = "";
+        delimiter = "\t";
+    }/*}}}*/
+
+    bool operator==(const EnvelopeConf& hs) const
+    {/*{{{*/
+        return (format == hs.format) &&
+            (fields == hs.fields) &&
+            (delimiter == hs.delimiter);
+    };/*}}}*/
+
+    bool operator!=(const EnvelopeConf& hs) const
+    {/*{{{*/
+        return !operator==(hs);
+    };/*}}}*/
+
+    friend ostream& operator << (ostream& os, const EnvelopeConf& ec)
+    {/*{{{*/
+        os << "format: " << ec.format
+           << "fields: " << ec.fields.size();
 
         return os;
     }/*}}}*/
+
+    static bool isFormatValid(const string &format)
+    {/*{{{*/
+        return "" == format || "json" == format || "prefix" == format;
+    }/*}}}*/
 };
 
 struct KafkaTopicConf {
@@ -138,6 +391,19 @@ struct KafkaTopicConf {
     string key;
     int partition;
     int message_timeout_ms;
+
+    /* the key of each message is taken from its line by the first of
+     * these set, the fixed key above is used if none is found,
+     * see KeyExtractor */
+    string key_pattern;
+    int key_field;
+    string key_field_delimiter;
+    string key_json_field;
+
+    /* the producer the messages are queued on, "" or "shared" for the
+     * one of the compression codec, "topic" for one of the topic, any
+     * other name for the one of that group, see OutputKafka */
+    string producer_pool;
     
     KafkaTopicConf()
     {/*{{{*/
@@ -148,6 +414,11 @@ struct KafkaTopicConf {
         key = "";
         partition = -1;
         message_timeout_ms = 0;
+        key_pattern = "";
+        key_field = 0;
+        key_field_delimiter = " ";
+        key_json_field = "";
+        producer_pool = "";
     }/*}}}*/
 
     bool operator==(const KafkaTopicConf& hs) const
@@ -158,7 +429,12 @@ struct KafkaTopicConf {
             (required_acks == hs.required_acks) &&
             (key == hs.key) &&
             (partition == hs.partition) && 
-            (message_timeout_ms == hs.message_timeout_ms);
+            (message_timeout_ms == hs.message_timeout_ms) &&
+            (key_pattern == hs.key_pattern) &&
+            (key_field == hs.key_field) &&
+            (key_field_delimiter == hs.key_field_delimiter) &&
+            (key_json_field == hs.key_json_field) &&
+            (producer_pool == hs.producer_pool);
     };/*}}}*/
 
     bool operator!=(const KafkaTopicConf& hs) const
@@ -185,13 +461,17 @@ struct TaskConf
     LogConf log_conf;
     KafkaTopicConf kafka_topic_conf;
     FilterConf filter_conf;
+    MultilineConf multiline_conf;
+    EnvelopeConf envelope_conf;
 
     bool operator==(const TaskConf& hs) const
     {/*{{{*/
         return (valid == hs.valid) &&
             (log_conf == hs.log_conf) &&
             (kafka_topic_conf == hs.kafka_topic_conf) &&
-            (filter_conf == hs.filter_conf);
+            (filter_conf == hs.filter_conf) &&
+            (multiline_conf == hs.multiline_conf) &&
+            (envelope_conf == hs.envelope_conf);
     };/*}}}*/
 
     friend ostream& operator << (ostream& os, const TaskConf& tc)
@@ -199,7 +479,9 @@ struct TaskConf
         os << "valid: " << tc.valid
            << "log conf" << tc.log_conf 
            << "kafka topic conf" << tc.kafka_topic_conf
-           << "filter conf" << tc.filter_conf;
+           << "filter conf" << tc.filter_conf
+           << "multiline conf" << tc.multiline_conf
+           << "envelope conf" << tc.envelope_conf;
 
         return os;
     }/*}}}*/
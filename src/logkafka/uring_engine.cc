@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#include "logkafka/uring_engine.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace logkafka {
+
+UringEngine::UringEngine()
+{/*{{{*/
+    m_event_fd = -1;
+    m_inflight = 0;
+    m_loop = NULL;
+    m_prepare_handle = NULL;
+    m_poll_handle = NULL;
+}/*}}}*/
+
+UringEngine::~UringEngine()
+{/*{{{*/
+    close();
+}/*}}}*/
+
+bool UringEngine::init(uv_loop_t *loop, unsigned entries)
+{/*{{{*/
+#if defined(BASE_HAVE_IO_URING) && defined(STATX_INO)
+    m_loop = loop;
+
+    if (!m_ring.init(entries)) {
+        return false;
+    }
+
+    if (!m_ring.isOpSupported(IORING_OP_READ) ||
+        !m_ring.isOpSupported(IORING_OP_STATX)) {
+        LWARNING << "io_uring of the kernel does not support read or statx";
+        close();
+        return false;
+    }
+
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (-1 == m_event_fd) {
+        LERROR << "Fail to create eventfd, " << strerror(errno);
+        close();
+        return false;
+    }
+
+    if (!m_ring.registerEventFd(m_event_fd)) {
+        close();
+        return false;
+    }
+
+    m_prepare_handle = new uv_prepare_t();
+    uv_prepare_init(m_loop, m_prepare_handle);
+    m_prepare_handle->data = this;
+    uv_prepare_start(m_prepare_handle, onPrepare);
+
+    m_poll_handle = new uv_poll_t();
+    int res = uv_poll_init(m_loop, m_poll_handle, m_event_fd);
+    if (res < 0) {
+        LERROR << "Fail to init uv poll, " << uv_strerror(res);
+        delete m_poll_handle; m_poll_handle = NULL;
+        close();
+        return false;
+    }
+    m_poll_handle->data = this;
+    uv_poll_start(m_poll_handle, UV_READABLE, onPoll);
+
+    LINFO << "Using io_uring read engine, entries: " << entries;
+
+    return true;
+#else
+    LWARNING << "io_uring read engine is not supported on this platform";
+    return false;
+#endif
+}/*}}}*/
+
+void UringEngine::close()
+{/*{{{*/
+    if (NULL != m_prepare_handle) {
+        uv_close((uv_handle_t *)m_prepare_handle, onCloseComplete);
+        m_prepare_handle = NULL;
+    }
+
+    if (NULL != m_poll_handle) {
+        uv_close((uv_handle_t *)m_poll_handle, onCloseComplete);
+        m_poll_handle = NULL;
+    }
+
+    /* the memory of inflight reads must not be freed under the kernel */
+    m_ring.submit();
+    while (m_inflight > 0 && m_ring.submit(1) >= 0) {
+        reap();
+    }
+    reap();
+
+    m_ring.close();
+
+    if (-1 != m_event_fd) {
+        ::close(m_event_fd); m_event_fd = -1;
+    }
+}/*}}}*/
+
+UringRequest *UringEngine::newRequest(RefCounted *holder,
+        UringFunc func, void *arg)
+{/*{{{*/
+    UringRequest *req = new UringRequest();
+    req->func = func;
+    req->arg = arg;
+    req->holder = holder;
+    if (NULL != holder) holder->ref();
+
+    return req;
+}/*}}}*/
+
+UringRequest *UringEngine::read(int fd, char *buf, size_t len, off_t offset,
+        RefCounted *holder, UringFunc func, void *arg)
+{/*{{{*/
+#ifdef BASE_HAVE_IO_URING
+    struct io_uring_sqe *sqe = m_ring.getSqe();
+    if (NULL == sqe) {
+        /* the queue is full, make room for the next ones */
+        submit();
+        return NULL;
+    }
+
+    UringRequest *req = newRequest(holder, func, arg);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    ++m_inflight;
+
+    return req;
+#else
+    return NULL;
+#endif
+}/*}}}*/
+
+UringRequest *UringEngine::stat(const string &path, UringFunc func, void *arg)
+{/*{{{*/
+#if defined(BASE_HAVE_IO_URING) && defined(STATX_INO)
+    struct io_uring_sqe *sqe = m_ring.getSqe();
+    if (NULL == sqe) {
+        submit();
+        return NULL;
+    }
+
+    UringRequest *req = newRequest(NULL, func, arg);
+    req->path = path;
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)req->path.c_str();
+    sqe->len = STATX_INO | STATX_SIZE;
+    sqe->off = (uint64_t)(uintptr_t)&req->stx;
+    sqe->statx_flags = 0;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    ++m_inflight;
+
+    return req;
+#else
+    return NULL;
+#endif
+}/*}}}*/
+
+void UringEngine::cancel(UringRequest *req)
+{/*{{{*/
+    if (NULL == req) return;
+
+    /* the fd of a prepared request may be closed right after, let the
+     * kernel take its reference now */
+    submit();
+    req->func = NULL;
+}/*}}}*/
+
+void UringEngine::submit()
+{/*{{{*/
+    unsigned pending = m_ring.getPending();
+    if (0 == pending) return;
+
+    int res = m_ring.submit();
+    if (res < 0) {
+        LERROR << "Fail to submit " << pending << " io_uring requests"
+               << ", " << strerror(-res);
+    }
+
+    LDEBUG << "Submit " << pending << " io_uring requests";
+}/*}}}*/
+
+void UringEngine::reap()
+{/*{{{*/
+    uint64_t user_data = 0;
+    int res = 0;
+
+    while (m_ring.popCqe(user_data, res)) {
+        UringRequest *req = reinterpret_cast<UringRequest *>(user_data);
+        --m_inflight;
+
+        if (NULL != req->func) {
+            (*req->func)(req->arg, res, req);
+        }
+
+        if (NULL != req->holder) req->holder->unref();
+        delete req;
+    }
+}/*}}}*/
+
+void UringEngine::onPrepare(uv_prepare_t *handle)
+{/*{{{*/
+    UringEngine *engine = reinterpret_cast<UringEngine *>(handle->data);
+    engine->submit();
+}/*}}}*/
+
+void UringEngine::onPoll(uv_poll_t *handle, int status, int events)
+{/*{{{*/
+    UringEngine *engine = reinterpret_cast<UringEngine *>(handle->data);
+
+    uint64_t count = 0;
+    if (sizeof(count) != ::read(engine->m_event_fd, &count, sizeof(count))
+            && EAGAIN != errno) {
+        LERROR << "Fail to read eventfd, " << strerror(errno);
+    }
+
+    engine->reap();
+}/*}}}*/
+
+void UringEngine::onCloseComplete(uv_handle_t *handle)
+{/*{{{*/
+    if (UV_PREPARE == handle->type) {
+        delete (uv_prepare_t *)handle;
+    } else {
+        delete (uv_poll_t *)handle;
+    }
+}/*}}}*/
+
+} // namespace logkafka
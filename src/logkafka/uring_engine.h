@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// logkafka - Collect logs and send lines to Apache Kafka v0.8+
+//
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015 Qihoo 360 Technology Co., Ltd. All rights reserved.
+//
+// Licensed under the MIT License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////
+#ifndef LOGKAFKA_URING_ENGINE_H_
+#define LOGKAFKA_URING_ENGINE_H_
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "base/common.h"
+#include "base/io_uring.h"
+#include "base/ref_counted.h"
+
+#include <uv.h>
+#include "easylogging/easylogging++.h"
+
+using namespace std;
+using namespace base;
+
+namespace logkafka {
+
+struct UringRequest;
+
+/* Completion callback, res is the result of the operation (-errno on
+ * failure), called on the loop thread */
+typedef void (*UringFunc)(void *arg, int res, const UringRequest *req);
+
+struct UringRequest
+{
+    UringFunc func;
+    void *arg;
+    /* keeps the target memory alive until the kernel is done with it */
+    RefCounted *holder;
+    string path;
+#ifdef STATX_INO
+    struct statx stx;
+#endif
+};
+
+/* Shared io_uring of the loop, the reads and stats requested by all the
+ * watchers in one loop iteration are submitted with one syscall (in the
+ * prepare phase), the completions are handed back through an eventfd
+ * polled by the loop.
+ *
+ * If a request can not be queued (NULL is returned), the caller should
+ * fall back to the synchronous call.
+ * */
+class UringEngine
+{
+    public:
+        UringEngine();
+        ~UringEngine();
+
+        /* return false if the kernel has no (usable) io_uring support */
+        bool init(uv_loop_t *loop, unsigned entries);
+        void close();
+
+        UringRequest *read(int fd, char *buf, size_t len, off_t offset,
+                RefCounted *holder, UringFunc func, void *arg);
+        UringRequest *stat(const string &path, UringFunc func, void *arg);
+
+        /* the callback of a cancelled request is never called */
+        void cancel(UringRequest *req);
+        void submit();
+
+    private:
+        UringRequest *newRequest(RefCounted *holder, UringFunc func, void *arg);
+        void reap();
+
+        static void onPrepare(uv_prepare_t *handle);
+        static void onPoll(uv_poll_t *handle, int status, int events);
+        static void onCloseComplete(uv_handle_t *handle);
+
+    private:
+        IOUring m_ring;
+        int m_event_fd;
+        unsigned m_inflight;
+        uv_loop_t *m_loop;
+        uv_prepare_t *m_prepare_handle;
+        uv_poll_t *m_poll_handle;
+};
+
+} // namespace logkafka
+
+#endif // LOGKAFKA_URING_ENGINE_H_
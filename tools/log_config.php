@@ -70,6 +70,37 @@ function main()
         return is_string($value);
     });
 
+    $key_patternOpt = new Option(null, 'key_pattern', Getopt::REQUIRED_ARGUMENT);
+    $key_patternOpt -> setDescription('Optional regex pattern of the message key, the first capturing group
+                          or the whole match of each message is its key, e.g. "session=(\\w+)"');
+    $key_patternOpt -> setDefaultValue('');
+    $key_patternOpt -> setValidation(function($value) {
+        return AdminUtils::isRegexFilterPatternValid($value);
+    });
+
+    $key_fieldOpt = new Option(null, 'key_field', Getopt::REQUIRED_ARGUMENT);
+    $key_fieldOpt -> setDescription('If not 0, the n-th (from 1) field of each message, separated by
+                          key_field_delimiter, is its key');
+    $key_fieldOpt -> setDefaultValue('0');
+    $key_fieldOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
+    $key_field_delimiterOpt = new Option(null, 'key_field_delimiter', Getopt::REQUIRED_ARGUMENT);
+    $key_field_delimiterOpt -> setDescription('The delimiter of fields for key_field');
+    $key_field_delimiterOpt -> setDefaultValue(' ');
+    $key_field_delimiterOpt -> setValidation(function($value) {
+        return is_string($value) && $value !== '';
+    });
+
+    $key_json_fieldOpt = new Option(null, 'key_json_field', Getopt::REQUIRED_ARGUMENT);
+    $key_json_fieldOpt -> setDescription('Optional dot separated path of the json field of each message
+                          which is its key, e.g. "user.id"');
+    $key_json_fieldOpt -> setDefaultValue('');
+    $key_json_fieldOpt -> setValidation(function($value) {
+        return $value === '' || preg_match('/^[^.]+(\.[^.]+)*$/', $value);
+    });
+
     $requiredAcksOpt = new Option(null, 'required_acks', Getopt::REQUIRED_ARGUMENT);
     $requiredAcksOpt -> setDescription('Required ack number');
     $requiredAcksOpt -> setDefaultValue('1');
@@ -77,6 +108,15 @@ function main()
         return is_numeric($value);
     });
 
+    $producer_poolOpt = new Option(null, 'producer_pool', Getopt::REQUIRED_ARGUMENT);
+    $producer_poolOpt -> setDescription('Optional producer pool of the messages: "shared" (default),
+                          "topic" for a producer of the topic, or the name of a
+                          producer.pool section in logkafka.conf');
+    $producer_poolOpt -> setDefaultValue('');
+    $producer_poolOpt -> setValidation(function($value) {
+        return is_string($value);
+    });
+
     $compression_codecOpt = new Option(null, 'compression_codec', Getopt::REQUIRED_ARGUMENT);
     $compression_codecOpt -> setDescription("Optional compression method of messages: ".
         implode(", ", AdminUtils::$COMPRESSION_CODECS)
@@ -93,6 +133,22 @@ function main()
         return (is_numeric($value) && (int)$value > 0);
     });
 
+    $batchsize_minOpt = new Option(null, 'batchsize_min', Getopt::REQUIRED_ARGUMENT);
+    $batchsize_minOpt -> setDescription('The min batch size when it is adjusted by the lag of log file, 
+                          0 means the same as batchsize');
+    $batchsize_minOpt -> setDefaultValue('0');
+    $batchsize_minOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
+    $batchsize_maxOpt = new Option(null, 'batchsize_max', Getopt::REQUIRED_ARGUMENT);
+    $batchsize_maxOpt -> setDescription('The max batch size when it is adjusted by the lag of log file, 
+                          0 means the same as batchsize');
+    $batchsize_maxOpt -> setDefaultValue('0');
+    $batchsize_maxOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
     $follow_lastOpt = new Option(null, 'follow_last', Getopt::REQUIRED_ARGUMENT);
     $follow_lastOpt -> setDescription('If set to "false", when restarting logkafka process, 
                           the log_path formatted with current time will be collect;
@@ -118,6 +174,22 @@ function main()
         return (is_numeric($value) && (int)$value >= 0 && (int)$value <= 255);
     });
 
+    $line_delimiter_hexOpt = new Option(null, 'line_delimiter_hex', Getopt::REQUIRED_ARGUMENT);
+    $line_delimiter_hexOpt -> setDescription('The line delimiter of log file in hex, e.g. "0d0a" for "\\r\\n",
+                          overrides line_delimiter if not empty');
+    $line_delimiter_hexOpt -> setDefaultValue('');
+    $line_delimiter_hexOpt -> setValidation(function($value) {
+        return $value === '' || (strlen($value) % 2 == 0 && ctype_xdigit($value));
+    });
+
+    $length_prefix_bytesOpt = new Option(null, 'length_prefix_bytes', Getopt::REQUIRED_ARGUMENT);
+    $length_prefix_bytesOpt -> setDescription('If not 0, lines are framed by a big-endian length
+                          prefix of this many bytes instead of the line delimiter');
+    $length_prefix_bytesOpt -> setDefaultValue('0');
+    $length_prefix_bytesOpt -> setValidation(function($value) {
+        return in_array($value, array('0', '1', '2', '4', '8'));
+    });
+
     $remove_delimiterOpt = new Option(null, 'remove_delimiter', Getopt::REQUIRED_ARGUMENT);
     $remove_delimiterOpt -> setDescription('If set to "false", when collecting lines,
                           the line delimiter will NOT be removed; If set to "true",
@@ -143,6 +215,126 @@ function main()
         return AdminUtils::isRegexFilterPatternValid($value);
     });
 
+    $regex_filter_patternsOpt = new Option(null, 'regex_filter_patterns', Getopt::REQUIRED_ARGUMENT);
+    $regex_filter_patternsOpt -> setDescription('Optional json array of regex filter patterns, e.g. \'["^GET /health", "bot"]\',
+                          the messages matching any of them will be dropped');
+    $regex_filter_patternsOpt -> setDefaultValue('');
+    $regex_filter_patternsOpt -> setValidation(function($value) {
+        return AdminUtils::isRegexFilterPatternsValid($value);
+    });
+
+    $regex_filter_chainOpt = new Option(null, 'regex_filter_chain', Getopt::REQUIRED_ARGUMENT);
+    $regex_filter_chainOpt -> setDescription('Optional json array of include (keep) and exclude (drop) stages,
+                          e.g. \'[{"action":"include","pattern":"ERROR"},{"action":"exclude","patterns":["DEBUG","TRACE"]}]\',
+                          the first stage matching a message decides, a stage without patterns matches every message,
+                          the messages matching no stage are kept');
+    $regex_filter_chainOpt -> setDefaultValue('');
+    $regex_filter_chainOpt -> setValidation(function($value) {
+        return AdminUtils::isRegexFilterChainValid($value);
+    });
+
+    $json_filterOpt = new Option(null, 'json_filter', Getopt::REQUIRED_ARGUMENT);
+    $json_filterOpt -> setDescription('Optional json array of predicates on the fields of json messages,
+                          e.g. \'[{"field":"level","op":"ne","value":"DEBUG"},{"field":"user.id","op":"in","values":["u1","u2"]}]\',
+                          op is one of eq, ne, in, exists, lt, le, gt, ge, the json messages not satisfying all of them are dropped');
+    $json_filterOpt -> setDefaultValue('');
+    $json_filterOpt -> setValidation(function($value) {
+        return AdminUtils::isJsonFilterValid($value);
+    });
+
+    $filter_pluginsOpt = new Option(null, 'filter_plugins', Getopt::REQUIRED_ARGUMENT);
+    $filter_pluginsOpt -> setDescription('Optional json array of filter plugins run in order,
+                          e.g. \'[{"path":"/usr/local/logkafka/lib/logkafka_mask_digits.so","args":"#"}]\',
+                          path is the shared object on the logkafka host, args is passed to the plugin');
+    $filter_pluginsOpt -> setDefaultValue('');
+    $filter_pluginsOpt -> setValidation(function($value) {
+        return AdminUtils::isFilterPluginsValid($value);
+    });
+
+    $sample_rateOpt = new Option(null, 'sample_rate', Getopt::REQUIRED_ARGUMENT);
+    $sample_rateOpt -> setDescription('The fraction of messages kept, from 0 to 1, e.g. 0.1,
+                          1 keeps all messages');
+    $sample_rateOpt -> setDefaultValue('1');
+    $sample_rateOpt -> setValidation(function($value) {
+        return AdminUtils::isSampleRateValid($value);
+    });
+
+    $sample_key_patternOpt = new Option(null, 'sample_key_pattern', Getopt::REQUIRED_ARGUMENT);
+    $sample_key_patternOpt -> setDescription('Optional regex pattern of the sampling key, the first capturing group
+                          or the whole match, the messages with the same key are kept or dropped together');
+    $sample_key_patternOpt -> setDefaultValue('');
+    $sample_key_patternOpt -> setValidation(function($value) {
+        return AdminUtils::isRegexFilterPatternValid($value);
+    });
+
+    $sample_max_lines_per_secOpt = new Option(null, 'sample_max_lines_per_sec', Getopt::REQUIRED_ARGUMENT);
+    $sample_max_lines_per_secOpt -> setDescription('If not 0, the sample rate is lowered to keep
+                          at most this many messages per second');
+    $sample_max_lines_per_secOpt -> setDefaultValue('0');
+    $sample_max_lines_per_secOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
+    $sample_max_bytes_per_secOpt = new Option(null, 'sample_max_bytes_per_sec', Getopt::REQUIRED_ARGUMENT);
+    $sample_max_bytes_per_secOpt -> setDescription('If not 0, the sample rate is lowered to keep
+                          at most this many bytes of messages per second');
+    $sample_max_bytes_per_secOpt -> setDefaultValue('0');
+    $sample_max_bytes_per_secOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
+    $envelope_formatOpt = new Option(null, 'envelope_format', Getopt::REQUIRED_ARGUMENT);
+    $envelope_formatOpt -> setDescription('If "json", each message is wrapped into a json object with the envelope fields,
+                          if "prefix", the envelope fields are prepended to each message, empty to send messages as is');
+    $envelope_formatOpt -> setDefaultValue('');
+    $envelope_formatOpt -> setValidation(function($value) {
+        return in_array($value, array('', 'json', 'prefix'));
+    });
+
+    $envelope_fieldsOpt = new Option(null, 'envelope_fields', Getopt::REQUIRED_ARGUMENT);
+    $envelope_fieldsOpt -> setDescription('Optional json array of the envelope fields in order, e.g. \'["hostname", "path", "offset"]\',
+                          of hostname, logkafka_id, path, inode and offset, all of them if empty');
+    $envelope_fieldsOpt -> setDefaultValue('');
+    $envelope_fieldsOpt -> setValidation(function($value) {
+        return AdminUtils::isEnvelopeFieldsValid($value);
+    });
+
+    $envelope_delimiterOpt = new Option(null, 'envelope_delimiter', Getopt::REQUIRED_ARGUMENT);
+    $envelope_delimiterOpt -> setDescription('The separator of the envelope fields and the message in prefix format');
+    $envelope_delimiterOpt -> setDefaultValue("\t");
+    $envelope_delimiterOpt -> setValidation(function($value) {
+        return is_string($value) && $value !== '';
+    });
+
+    $multiline_start_patternOpt = new Option(null, 'multiline_start_pattern', Getopt::REQUIRED_ARGUMENT);
+    $multiline_start_patternOpt -> setDescription("Optional regex pattern of the first line of multi-line messages (e.g. stack traces), 
+                          the following lines not matching it are joined to the message");
+    $multiline_start_patternOpt -> setDefaultValue('');
+    $multiline_start_patternOpt -> setValidation(function($value) {
+        return AdminUtils::isRegexFilterPatternValid($value);
+    });
+
+    $multiline_max_linesOpt = new Option(null, 'multiline_max_lines', Getopt::REQUIRED_ARGUMENT);
+    $multiline_max_linesOpt -> setDescription("Max lines of one multi-line message");
+    $multiline_max_linesOpt -> setDefaultValue('500');
+    $multiline_max_linesOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value > 0);
+    });
+
+    $multiline_max_bytesOpt = new Option(null, 'multiline_max_bytes', Getopt::REQUIRED_ARGUMENT);
+    $multiline_max_bytesOpt -> setDescription("Max bytes of one multi-line message");
+    $multiline_max_bytesOpt -> setDefaultValue('1048576');
+    $multiline_max_bytesOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value > 0);
+    });
+
+    $multiline_max_age_msOpt = new Option(null, 'multiline_max_age_ms', Getopt::REQUIRED_ARGUMENT);
+    $multiline_max_age_msOpt -> setDescription("Max milliseconds to wait for the rest of one multi-line message");
+    $multiline_max_age_msOpt -> setDefaultValue('3000');
+    $multiline_max_age_msOpt -> setValidation(function($value) {
+        return (is_numeric($value) && (int)$value >= 0);
+    });
+
     $lagging_max_bytesOpt = new Option(null, 'lagging_max_bytes', Getopt::REQUIRED_ARGUMENT);
     $lagging_max_bytesOpt -> setDescription("log lagging max bytes, the monitor will alarm according to this setting");
     $lagging_max_bytesOpt -> setDefaultValue('');
@@ -200,15 +392,39 @@ function main()
         $partitionOpt,
 
         $keyOpt,
+        $key_patternOpt,
+        $key_fieldOpt,
+        $key_field_delimiterOpt,
+        $key_json_fieldOpt,
+        $producer_poolOpt,
         $requiredAcksOpt,
         $compression_codecOpt,
         $batchsizeOpt,
+        $batchsize_minOpt,
+        $batchsize_maxOpt,
         $follow_lastOpt,
         $read_from_headOpt,
         $line_delimiterOpt,
+        $line_delimiter_hexOpt,
+        $length_prefix_bytesOpt,
         $remove_delimiterOpt,
         $message_timeout_msOpt,
         $regex_filter_patternOpt,
+        $regex_filter_patternsOpt,
+        $regex_filter_chainOpt,
+        $json_filterOpt,
+        $filter_pluginsOpt,
+        $sample_rateOpt,
+        $sample_key_patternOpt,
+        $sample_max_lines_per_secOpt,
+        $sample_max_bytes_per_secOpt,
+        $envelope_formatOpt,
+        $envelope_fieldsOpt,
+        $envelope_delimiterOpt,
+        $multiline_start_patternOpt,
+        $multiline_max_linesOpt,
+        $multiline_max_bytesOpt,
+        $multiline_max_age_msOpt,
         $lagging_max_bytesOpt,
         $rotate_lagging_max_secOpt,
 
@@ -475,13 +691,37 @@ class AdminUtils
         'topic'      => array('type'=>'string', 'default'=>''),
         'partition'  => array('type'=>'integer', 'default'=>'-1'),
         'key'        => array('type'=>'string','default'=>''),
+        'key_pattern'        => array('type'=>'string','default'=>''),
+        'key_field'        => array('type'=>'integer','default'=>'0'),
+        'key_field_delimiter'        => array('type'=>'string','default'=>' '),
+        'key_json_field'        => array('type'=>'string','default'=>''),
+        'producer_pool'        => array('type'=>'string','default'=>''),
         'required_acks' => array('type'=>'integer', 'default'=>'1'),
         'compression_codec' => array('type'=>'string', 'default'=>'none'),
         'batchsize'   => array('type'=>'integer', 'default'=>'1000'),
+        'batchsize_min'   => array('type'=>'integer', 'default'=>'0'),
+        'batchsize_max'   => array('type'=>'integer', 'default'=>'0'),
         'line_delimiter'   => array('type'=>'integer', 'default'=>'10'), // 10 means ascii '\n'
+        'line_delimiter_hex'   => array('type'=>'string', 'default'=>''),
+        'length_prefix_bytes'   => array('type'=>'integer', 'default'=>'0'),
         'remove_delimiter'   => array('type'=>'bool', 'default'=>'true'),
         'message_timeout_ms'   => array('type'=>'integer', 'default'=>'0'),
         'regex_filter_pattern'   => array('type'=>'string', 'default'=>''),
+        'regex_filter_patterns'   => array('type'=>'string', 'default'=>''),
+        'regex_filter_chain'   => array('type'=>'string', 'default'=>''),
+        'json_filter'   => array('type'=>'string', 'default'=>''),
+        'filter_plugins'   => array('type'=>'string', 'default'=>''),
+        'sample_rate'   => array('type'=>'string', 'default'=>'1'),
+        'sample_key_pattern'   => array('type'=>'string', 'default'=>''),
+        'sample_max_lines_per_sec'   => array('type'=>'integer', 'default'=>'0'),
+        'sample_max_bytes_per_sec'   => array('type'=>'integer', 'default'=>'0'),
+        'envelope_format'   => array('type'=>'string', 'default'=>''),
+        'envelope_fields'   => array('type'=>'string', 'default'=>''),
+        'envelope_delimiter'   => array('type'=>'string', 'default'=>"\t"),
+        'multiline_start_pattern'   => array('type'=>'string', 'default'=>''),
+        'multiline_max_lines'   => array('type'=>'integer', 'default'=>'500'),
+        'multiline_max_bytes'   => array('type'=>'integer', 'default'=>'1048576'),
+        'multiline_max_age_ms'   => array('type'=>'integer', 'default'=>'3000'),
         'lagging_max_bytes'   => array('type'=>'integer', 'default'=>'0'),
         'rotate_lagging_max_sec'   => array('type'=>'integer', 'default'=>'0'),
         'follow_last' => array('type'=>'bool', 'default'=>'true'),
@@ -913,6 +1153,129 @@ class AdminUtils
         return true;
     }/*}}}*/
 
+    static public function isRegexFilterPatternsValid($regex_filter_patterns) 
+    {/*{{{*/
+        if ($regex_filter_patterns === '') return true;
+
+        $patterns = json_decode($regex_filter_patterns, true);
+        if (!is_array($patterns)) return false;
+
+        foreach ($patterns as $pattern) {
+            if (!is_string($pattern) || !self::isRegexFilterPatternValid($pattern)) {
+                return false;
+            }
+        }
+
+        return true;
+    }/*}}}*/
+
+    static public function isRegexFilterChainValid($regex_filter_chain) 
+    {/*{{{*/
+        if ($regex_filter_chain === '') return true;
+
+        $stages = json_decode($regex_filter_chain, true);
+        if (!is_array($stages)) return false;
+
+        foreach ($stages as $stage) {
+            if (!is_array($stage) || !array_key_exists('action', $stage)
+                || !in_array($stage['action'], array('include', 'exclude'))) {
+                return false;
+            }
+            if (array_key_exists('pattern', $stage)
+                && (!is_string($stage['pattern'])
+                    || !self::isRegexFilterPatternValid($stage['pattern']))) {
+                return false;
+            }
+            if (array_key_exists('patterns', $stage)
+                && !self::isRegexFilterPatternsValid(json_encode($stage['patterns']))) {
+                return false;
+            }
+        }
+
+        return true;
+    }/*}}}*/
+
+    static public function isJsonFilterValid($json_filter) 
+    {/*{{{*/
+        if ($json_filter === '') return true;
+
+        $predicates = json_decode($json_filter, true);
+        if (!is_array($predicates)) return false;
+
+        foreach ($predicates as $predicate) {
+            if (!is_array($predicate)
+                || !array_key_exists('field', $predicate) || !is_string($predicate['field'])
+                || !array_key_exists('op', $predicate)) {
+                return false;
+            }
+
+            $op = $predicate['op'];
+            if ($op === 'exists') {
+                continue;
+            } else if ($op === 'in') {
+                if (!array_key_exists('values', $predicate) || !is_array($predicate['values'])) {
+                    return false;
+                }
+            } else if (in_array($op, array('eq', 'ne'))) {
+                if (!array_key_exists('value', $predicate) || is_array($predicate['value'])) {
+                    return false;
+                }
+            } else if (in_array($op, array('lt', 'le', 'gt', 'ge'))) {
+                if (!array_key_exists('value', $predicate) || !is_numeric($predicate['value'])) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+
+        return true;
+    }/*}}}*/
+
+    static public function isFilterPluginsValid($filter_plugins) 
+    {/*{{{*/
+        if ($filter_plugins === '') return true;
+
+        $plugins = json_decode($filter_plugins, true);
+        if (!is_array($plugins)) return false;
+
+        foreach ($plugins as $plugin) {
+            if (!is_array($plugin)
+                || !array_key_exists('path', $plugin) || !is_string($plugin['path'])
+                || $plugin['path'] === '') {
+                return false;
+            }
+
+            if (array_key_exists('args', $plugin) && !is_string($plugin['args'])) {
+                return false;
+            }
+        }
+
+        return true;
+    }/*}}}*/
+
+    static public function isSampleRateValid($sample_rate) 
+    {/*{{{*/
+        return is_numeric($sample_rate)
+            && (float)$sample_rate >= 0 && (float)$sample_rate <= 1;
+    }/*}}}*/
+
+    static public function isEnvelopeFieldsValid($envelope_fields) 
+    {/*{{{*/
+        if ($envelope_fields === '') return true;
+
+        $fields = json_decode($envelope_fields, true);
+        if (!is_array($fields)) return false;
+
+        foreach ($fields as $field) {
+            if (!in_array($field, array('hostname', 'logkafka_id', 'path', 'inode', 'offset'), true)) {
+                return false;
+            }
+        }
+
+        return true;
+    }/*}}}*/
+
     static public function isMonitorNameValid($monitor_name) 
     {/*{{{*/
         // TODO
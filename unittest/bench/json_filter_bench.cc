@@ -0,0 +1,149 @@
+#include "logkafka/filter_json.h"
+
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "easylogging/easylogging++.h"
+#include "rapidjson/document.h"
+
+_INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace logkafka;
+
+/* Usage: jsonFilterBench [json lines] [rounds]
+ *
+ * Compares a DOM parse of each line (copied to be NUL-terminated, as
+ * base::Json does) with FilterJson (SAX in place, stopping early) for
+ * the predicates level ne "DEBUG" and ms ge 100.
+ * */
+
+struct Line
+{
+    const char *data;
+    size_t len;
+};
+
+static double now()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}/*}}}*/
+
+static void generate(string &content)
+{/*{{{*/
+    const char *levels[] = {"DEBUG", "DEBUG", "INFO", "WARN", "ERROR"};
+    char buf[1024];
+
+    srand(0);
+    for (int i = 0; i < 200000; ++i) {
+        int n = snprintf(buf, sizeof(buf),
+                "{\"ts\":\"2026-10-17T10:%02d:%02d.%03d+08:00\",\"level\":\"%s\","
+                "\"ms\":%d,\"host\":\"web-%02d\",\"path\":\"/api/v1/users/%d\","
+                "\"user\":{\"id\":\"u%d\",\"roles\":[\"reader\",\"writer\"]},"
+                "\"msg\":\"request served, cache %s, upstream \\\"users\\\"\","
+                "\"headers\":{\"ua\":\"Mozilla/5.0 (X11; Linux x86_64)\","
+                "\"accept\":\"application/json\"}}\n",
+                rand() % 60, rand() % 60, rand() % 1000, levels[rand() % 5],
+                rand() % 300, rand() % 40, rand() % 100000, rand() % 100000,
+                rand() % 2? "hit": "miss");
+        content.append(buf, n);
+    }
+}/*}}}*/
+
+static bool domMatch(const Line &line)
+{/*{{{*/
+    string copy(line.data, line.len);
+    rapidjson::Document d;
+    d.Parse(copy.c_str());
+    if (d.HasParseError() || !d.IsObject()) return true;
+
+    rapidjson::Value::ConstMemberIterator level = d.FindMember("level");
+    if (level != d.MemberEnd() && level->value.IsString() &&
+            0 == strcmp(level->value.GetString(), "DEBUG")) {
+        return false;
+    }
+
+    rapidjson::Value::ConstMemberIterator ms = d.FindMember("ms");
+    return ms != d.MemberEnd() && ms->value.IsNumber() &&
+        ms->value.GetDouble() >= 100;
+}/*}}}*/
+
+int main(int argc, char *argv[])
+{/*{{{*/
+    string content;
+    if (argc > 1) {
+        ifstream in(argv[1], ios::in | ios::binary);
+        if (!in) {
+            fprintf(stderr, "Fail to open %s\n", argv[1]);
+            return 1;
+        }
+        content.assign(istreambuf_iterator<char>(in),
+                istreambuf_iterator<char>());
+    } else {
+        generate(content);
+    }
+
+    int rounds = argc > 2? atoi(argv[2]): 10;
+
+    vector<Line> lines;
+    size_t cur = 0;
+    while (cur < content.size()) {
+        size_t pos = content.find('\n', cur);
+        if (string::npos == pos) pos = content.size();
+        Line line = {content.data() + cur, pos - cur};
+        lines.push_back(line);
+        cur = pos + 1;
+    }
+
+    FilterConf conf;
+    JsonPredicateConf level, ms;
+    level.field = "level";
+    level.op = "ne";
+    level.values.push_back("\"DEBUG\"");
+    ms.field = "ms";
+    ms.op = "ge";
+    ms.values.push_back("100");
+    conf.json_predicates.push_back(level);
+    conf.json_predicates.push_back(ms);
+
+    FilterJson filter(conf);
+    if (!filter.init(NULL)) {
+        fprintf(stderr, "Fail to init json filter\n");
+        return 1;
+    }
+
+    size_t dom_kept = 0, sax_kept = 0;
+    double dom_secs = 0, sax_secs = 0;
+    for (int i = 0; i < rounds; ++i) {
+        double start = now();
+        dom_kept = 0;
+        for (size_t k = 0; k < lines.size(); ++k) {
+            if (domMatch(lines[k])) ++dom_kept;
+        }
+        dom_secs += now() - start;
+
+        start = now();
+        sax_kept = 0;
+        for (size_t k = 0; k < lines.size(); ++k) {
+            if (filter.match(lines[k].data, lines[k].len)) ++sax_kept;
+        }
+        sax_secs += now() - start;
+    }
+
+    size_t total = lines.size() * rounds;
+    printf("lines: %zu, bytes: %zu, rounds: %d\n",
+            lines.size(), content.size(), rounds);
+    printf("dom: %8.1f ns/line, kept %zu\n", dom_secs * 1e9 / total, dom_kept);
+    printf("sax: %8.1f ns/line, kept %zu\n", sax_secs * 1e9 / total, sax_kept);
+    printf("speedup: %.2fx\n", dom_secs / sax_secs);
+
+    return dom_kept == sax_kept? 0: 1;
+}/*}}}*/
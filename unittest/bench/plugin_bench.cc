@@ -0,0 +1,112 @@
+#include "logkafka/filter_plugin.h"
+
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "easylogging/easylogging++.h"
+
+_INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace logkafka;
+
+/* Usage: pluginBench [plugin] [rounds]
+ *
+ * Runs the sample plugin (masking digits, half of the lines have digits)
+ * through FilterPlugin over generated lines, calling it once per line as
+ * a per-line plugin interface would, and once per batch of BATCH_SIZE
+ * lines. The rewritten lines are copied out of the plugin in both.
+ * */
+
+static const size_t BATCH_SIZE = 200;
+
+static double now()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}/*}}}*/
+
+static void generate(vector<string> &lines)
+{/*{{{*/
+    char buf[512];
+
+    srand(0);
+    for (int i = 0; i < 200000; ++i) {
+        int n = 0;
+        if (rand() % 2) {
+            n = snprintf(buf, sizeof(buf),
+                    "user login, id=%d, phone=1%010d, session=%x",
+                    rand(), rand(), rand());
+        } else {
+            n = snprintf(buf, sizeof(buf),
+                    "cache miss on key user:profile, falling back to db");
+        }
+        lines.push_back(string(buf, n));
+    }
+}/*}}}*/
+
+static size_t run(FilterPlugin &filter, const vector<string> &lines,
+        size_t batch_size)
+{/*{{{*/
+    size_t kept = 0;
+    vector<LineSlice> batch;
+    batch.reserve(batch_size);
+
+    for (size_t i = 0; i < lines.size(); i += batch_size) {
+        batch.clear();
+        size_t end = min(i + batch_size, lines.size());
+        for (size_t k = i; k < end; ++k) {
+            batch.push_back(LineSlice(lines[k].data(), lines[k].length(), NULL));
+        }
+        filter.filter(&filter, batch);
+        kept += batch.size();
+    }
+
+    return kept;
+}/*}}}*/
+
+int main(int argc, char *argv[])
+{/*{{{*/
+    string path = argc > 1? argv[1]:
+        string(LOGKAFKA_PLUGIN_DIR) + "/logkafka_mask_digits.so";
+    int rounds = argc > 2? atoi(argv[2]): 10;
+
+    vector<string> lines;
+    generate(lines);
+
+    FilterPluginConf conf;
+    conf.path = path;
+    FilterPlugin filter(conf);
+    if (!filter.init(NULL)) {
+        fprintf(stderr, "Fail to load plugin %s\n", path.c_str());
+        return 1;
+    }
+
+    size_t line_kept = 0, batch_kept = 0;
+    double line_secs = 0, batch_secs = 0;
+    for (int i = 0; i < rounds; ++i) {
+        double start = now();
+        line_kept = run(filter, lines, 1);
+        line_secs += now() - start;
+
+        start = now();
+        batch_kept = run(filter, lines, BATCH_SIZE);
+        batch_secs += now() - start;
+    }
+
+    size_t total = lines.size() * rounds;
+    printf("lines: %zu, rounds: %d, batch: %zu, plugin: %s\n",
+            lines.size(), rounds, BATCH_SIZE, path.c_str());
+    printf("per line:  %8.1f ns/line, kept %zu\n",
+            line_secs * 1e9 / total, line_kept);
+    printf("per batch: %8.1f ns/line, kept %zu\n",
+            batch_secs * 1e9 / total, batch_kept);
+    printf("speedup: %.2fx\n", line_secs / batch_secs);
+
+    return line_kept == batch_kept? 0: 1;
+}/*}}}*/
@@ -0,0 +1,154 @@
+#include "logkafka/regex.h"
+
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "easylogging/easylogging++.h"
+
+_INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+using namespace logkafka;
+
+/* Usage: regexBench [access log] [pattern] [rounds]
+ *
+ * Compares the filter path before JIT (a new match data per batch, a
+ * copy of each line, NUL-terminated matching, interpreted) with Regex
+ * (JIT, reused match data and JIT stack, explicit lengths).
+ * */
+
+static const size_t BATCH_SIZE = 200;
+
+struct Line
+{
+    const char *data;
+    size_t len;
+};
+
+static double now()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}/*}}}*/
+
+static void generate(string &content)
+{/*{{{*/
+    const char *paths[] = {"/index.html", "/static/app.js", "/static/logo.png",
+        "/api/v1/users?id=1024&fields=name,email", "/favicon.ico"};
+    const int codes[] = {200, 200, 200, 304, 404, 500};
+    char buf[512];
+
+    srand(0);
+    for (int i = 0; i < 200000; ++i) {
+        int n = snprintf(buf, sizeof(buf),
+                "10.%d.%d.%d - - [17/Oct/2026:10:%02d:%02d +0800] "
+                "\"GET %s HTTP/1.1\" %d %d \"-\" "
+                "\"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\"\n",
+                rand() % 256, rand() % 256, rand() % 256, rand() % 60,
+                rand() % 60, paths[rand() % 5], codes[rand() % 6],
+                rand() % 100000);
+        content.append(buf, n);
+    }
+}/*}}}*/
+
+static size_t legacyFilter(pcre2_code *re, const vector<Line> &lines)
+{/*{{{*/
+    size_t matched = 0;
+
+    for (size_t i = 0; i < lines.size(); i += BATCH_SIZE) {
+        pcre2_match_data *match_data =
+            pcre2_match_data_create_from_pattern(re, NULL);
+        size_t end = min(i + BATCH_SIZE, lines.size());
+        for (size_t k = i; k < end; ++k) {
+            string line(lines[k].data, lines[k].len);
+            int rc = pcre2_match(re, (PCRE2_SPTR)line.c_str(),
+                    PCRE2_ZERO_TERMINATED, 0, 0, match_data, NULL);
+            if (rc >= 0) ++matched;
+        }
+        pcre2_match_data_free(match_data);
+    }
+
+    return matched;
+}/*}}}*/
+
+static size_t regexFilter(Regex &regex, const vector<Line> &lines)
+{/*{{{*/
+    size_t matched = 0;
+
+    for (size_t k = 0; k < lines.size(); ++k) {
+        if (regex.match(lines[k].data, lines[k].len)) ++matched;
+    }
+
+    return matched;
+}/*}}}*/
+
+int main(int argc, char *argv[])
+{/*{{{*/
+    string content;
+    if (argc > 1) {
+        ifstream in(argv[1], ios::in | ios::binary);
+        if (!in) {
+            fprintf(stderr, "Fail to open %s\n", argv[1]);
+            return 1;
+        }
+        content.assign(istreambuf_iterator<char>(in),
+                istreambuf_iterator<char>());
+    } else {
+        generate(content);
+    }
+
+    string pattern = argc > 2? argv[2]: "\" (4|5)\\d\\d |\\.(png|ico) ";
+    int rounds = argc > 3? atoi(argv[3]): 10;
+
+    vector<Line> lines;
+    size_t cur = 0;
+    while (cur < content.size()) {
+        size_t pos = content.find('\n', cur);
+        if (string::npos == pos) pos = content.size();
+        Line line = {content.data() + cur, pos - cur};
+        lines.push_back(line);
+        cur = pos + 1;
+    }
+
+    PCRE2_SIZE erroffset;
+    int errorcode;
+    pcre2_code *re = pcre2_compile((PCRE2_SPTR)pattern.c_str(),
+            PCRE2_ZERO_TERMINATED, 0, &errorcode, &erroffset, NULL);
+    Regex regex;
+    if (NULL == re || !regex.init(pattern)) {
+        fprintf(stderr, "Fail to compile pattern %s\n", pattern.c_str());
+        return 1;
+    }
+
+    size_t legacy_matched = 0, regex_matched = 0;
+    double legacy_secs = 0, regex_secs = 0;
+    for (int i = 0; i < rounds; ++i) {
+        double start = now();
+        legacy_matched = legacyFilter(re, lines);
+        legacy_secs += now() - start;
+
+        start = now();
+        regex_matched = regexFilter(regex, lines);
+        regex_secs += now() - start;
+    }
+
+    size_t total = lines.size() * rounds;
+    printf("lines: %zu, bytes: %zu, rounds: %d, pattern: %s\n",
+            lines.size(), content.size(), rounds, pattern.c_str());
+    printf("legacy: %8.1f ns/line, matched %zu\n",
+            legacy_secs * 1e9 / total, legacy_matched);
+    printf("regex:  %8.1f ns/line, matched %zu, jit %s\n",
+            regex_secs * 1e9 / total, regex_matched,
+            regex.isJit()? "on": "off");
+    printf("speedup: %.2fx\n", legacy_secs / regex_secs);
+
+    pcre2_code_free(re);
+
+    return legacy_matched == regex_matched? 0: 1;
+}/*}}}*/
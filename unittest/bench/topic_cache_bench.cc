@@ -0,0 +1,135 @@
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <librdkafka/rdkafka.h>
+#ifdef __cplusplus
+}
+#endif
+
+using namespace std;
+
+/* Usage: topicCacheBench [batches] [rounds]
+ *
+ * Compares getting the topic of a batch before the cache (a new topic
+ * conf, rd_kafka_topic_new and rd_kafka_topic_destroy per batch) with
+ * Producer's cached handles (a map lookup). No broker is needed, one
+ * handle is held during the run as the undelivered messages do, so the
+ * topic itself is not torn down between batches in either. The produce
+ * itself is the same in both and left out.
+ * */
+
+static const char *TOPIC = "logkafka_bench";
+static const int MESSAGE_TIMEOUT_MS = 0;
+
+static double now()
+{/*{{{*/
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}/*}}}*/
+
+static rd_kafka_topic_conf_t *newTopicConf()
+{/*{{{*/
+    char errstr[512];
+    char timeout[32];
+    snprintf(timeout, sizeof(timeout), "%d", MESSAGE_TIMEOUT_MS);
+
+    rd_kafka_topic_conf_t *topic_conf = rd_kafka_topic_conf_new();
+    rd_kafka_topic_conf_set(topic_conf,
+        "produce.offset.report",
+        "true", errstr, sizeof(errstr));
+    rd_kafka_topic_conf_set(topic_conf,
+        "message.timeout.ms",
+        timeout, errstr, sizeof(errstr));
+
+    return topic_conf;
+}/*}}}*/
+
+static size_t legacyTopics(rd_kafka_t *rk, long batches)
+{/*{{{*/
+    size_t got = 0;
+
+    for (long i = 0; i < batches; ++i) {
+        rd_kafka_topic_t *rkt = rd_kafka_topic_new(rk, TOPIC, newTopicConf());
+        if (NULL != rkt) ++got;
+        rd_kafka_poll(rk, 0);
+        rd_kafka_topic_destroy(rkt);
+    }
+
+    return got;
+}/*}}}*/
+
+static size_t cachedTopics(rd_kafka_t *rk, long batches,
+        map<string, rd_kafka_topic_t *> &topics)
+{/*{{{*/
+    size_t got = 0;
+
+    for (long i = 0; i < batches; ++i) {
+        /* the key is the topic as Producer::getTopic does */
+        string topic_key = TOPIC;
+        map<string, rd_kafka_topic_t *>::iterator iter = topics.find(topic_key);
+        rd_kafka_topic_t *rkt = NULL;
+        if (iter != topics.end()) {
+            rkt = iter->second;
+        } else {
+            rkt = rd_kafka_topic_new(rk, TOPIC, newTopicConf());
+            topics[topic_key] = rkt;
+        }
+        if (NULL != rkt) ++got;
+        rd_kafka_poll(rk, 0);
+    }
+
+    return got;
+}/*}}}*/
+
+int main(int argc, char *argv[])
+{/*{{{*/
+    long batches = argc > 1? atol(argv[1]): 100000;
+    int rounds = argc > 2? atoi(argv[2]): 10;
+
+    char errstr[512];
+    rd_kafka_t *rk = rd_kafka_new(RD_KAFKA_PRODUCER, rd_kafka_conf_new(),
+            errstr, sizeof(errstr));
+    if (NULL == rk) {
+        fprintf(stderr, "Fail to create producer, %s\n", errstr);
+        return 1;
+    }
+
+    /* held during the run, as the undelivered messages do */
+    rd_kafka_topic_t *holder = rd_kafka_topic_new(rk, TOPIC, newTopicConf());
+
+    map<string, rd_kafka_topic_t *> topics;
+    size_t legacy_got = 0, cached_got = 0;
+    double legacy_secs = 0, cached_secs = 0;
+    for (int i = 0; i < rounds; ++i) {
+        double start = now();
+        legacy_got += legacyTopics(rk, batches);
+        legacy_secs += now() - start;
+
+        start = now();
+        cached_got += cachedTopics(rk, batches, topics);
+        cached_secs += now() - start;
+    }
+
+    double total = (double)batches * rounds;
+    printf("batches: %ld, rounds: %d\n", batches, rounds);
+    printf("legacy: %8.1f ns/batch\n", legacy_secs * 1e9 / total);
+    printf("cached: %8.1f ns/batch\n", cached_secs * 1e9 / total);
+    printf("speedup: %.2fx\n", legacy_secs / cached_secs);
+
+    map<string, rd_kafka_topic_t *>::iterator iter;
+    for (iter = topics.begin(); iter != topics.end(); ++iter) {
+        rd_kafka_topic_destroy(iter->second);
+    }
+    rd_kafka_topic_destroy(holder);
+    rd_kafka_destroy(rk);
+
+    return legacy_got == cached_got? 0: 1;
+}/*}}}*/
@@ -0,0 +1,69 @@
+#include "base/aho_corasick.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace base;
+
+TEST (AhoCorasickTest, Search) {
+    vector<string> keywords;
+    keywords.push_back("he");
+    keywords.push_back("she");
+    keywords.push_back("");
+    keywords.push_back("hers");
+    keywords.push_back("his");
+
+    AhoCorasick ac;
+    ASSERT_TRUE(ac.init(keywords));
+
+    vector<size_t> ids;
+    ac.search("ushers", 6, ids);
+    sort(ids.begin(), ids.end());
+    ASSERT_EQ(3U, ids.size());
+    EXPECT_EQ(0U, ids[0]);
+    EXPECT_EQ(1U, ids[1]);
+    EXPECT_EQ(3U, ids[2]);
+
+    /* each id once */
+    ids.clear();
+    ac.search("hehehe", 6, ids);
+    ASSERT_EQ(1U, ids.size());
+    EXPECT_EQ(0U, ids[0]);
+
+    ids.clear();
+    ac.search("xyz", 3, ids);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST (AhoCorasickTest, Random) {
+    srand(0);
+    for (int round = 0; round < 100; ++round) {
+        vector<string> keywords;
+        for (int i = 0; i < 20; ++i) {
+            string keyword;
+            for (int k = rand() % 4; k >= 0; --k) keyword += 'a' + rand() % 3;
+            keywords.push_back(keyword);
+        }
+
+        AhoCorasick ac;
+        ASSERT_TRUE(ac.init(keywords));
+
+        for (int n = 0; n < 20; ++n) {
+            string data;
+            for (int k = rand() % 30; k > 0; --k) data += 'a' + rand() % 4;
+
+            vector<size_t> ids;
+            ac.search(data.data(), data.length(), ids);
+            sort(ids.begin(), ids.end());
+
+            vector<size_t> expected;
+            for (size_t i = 0; i < keywords.size(); ++i) {
+                if (string::npos != data.find(keywords[i])) {
+                    expected.push_back(i);
+                }
+            }
+            EXPECT_EQ(expected, ids);
+        }
+    }
+}
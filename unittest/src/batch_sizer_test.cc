@@ -0,0 +1,50 @@
+#include "logkafka/batch_sizer.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+TEST (BatchSizerTest, Fixed) {
+    BatchSizer sizer;
+    sizer.init(200, 200, 200);
+    sizer.update(200, 20000, 1L << 30, true);
+    EXPECT_EQ(200U, sizer.getSize());
+    sizer.update(200, 20000, 0, false);
+    EXPECT_EQ(200U, sizer.getSize());
+}
+
+TEST (BatchSizerTest, CatchUp) {
+    BatchSizer sizer;
+    sizer.init(100, 10, 1000);
+
+    /* far behind, grows by doubling up to the max */
+    sizer.update(100, 10000, 1L << 30, true);
+    EXPECT_EQ(200U, sizer.getSize());
+    sizer.update(200, 20000, 1L << 30, true);
+    EXPECT_EQ(400U, sizer.getSize());
+    for (int i = 0; i < 10; ++i) {
+        sizer.update(sizer.getSize(), sizer.getSize() * 100, 1L << 30, true);
+    }
+    EXPECT_EQ(1000U, sizer.getSize());
+
+    /* rejected by producer */
+    sizer.update(1000, 100000, 1L << 30, false);
+    EXPECT_EQ(500U, sizer.getSize());
+
+    /* caught up, about 30 lines behind */
+    sizer.update(500, 50000, 3000, true);
+    EXPECT_EQ(30U, sizer.getSize());
+    sizer.update(30, 3000, 0, true);
+    EXPECT_EQ(10U, sizer.getSize());
+    sizer.update(10, 1000, 0, false);
+    EXPECT_EQ(10U, sizer.getSize());
+}
+
+TEST (BatchSizerTest, Bounds) {
+    BatchSizer sizer;
+    sizer.init(5, 10, 1000);
+    EXPECT_EQ(10U, sizer.getSize());
+    sizer.init(5000, 10, 1000);
+    EXPECT_EQ(1000U, sizer.getSize());
+    sizer.init(50, 0, 0);
+    EXPECT_EQ(1U, sizer.getSize());
+}
@@ -67,3 +67,30 @@ TEST_F (ConfigTest, TestReadConfString) {
 
     EXPECT_STREQ("127.0.0.1:2181", config.zookeeper_connect.c_str());
 }
+
+TEST_F (ConfigTest, TestReadProducerPool) {
+
+    char filename[255] = "/tmp/logkafka_test.confXXXXXX";
+    ConfigTest::createFile(filename, 
+            "zookeeper.connect = 127.0.0.1:2181\n" \
+            "pos.path = /tmp/pos.logkafka_test\n" \
+            "queue.buffering.max.messages = 10000\n" \
+            "queue.high.watermark.bytes = 67108864\n" \
+            "queue.low.watermark.bytes = 33554432\n" \
+            "producer.pool slow {\n" \
+            "    queue.buffering.max.messages = 2000\n" \
+            "    queue.high.watermark.bytes = 8388608\n" \
+            "}\n" \
+            );
+
+    Config config;
+    config.init(filename);
+    unlink(filename);
+
+    ASSERT_EQ(1, config.producer_pools.count("slow"));
+    const ProducerPoolConf &pool = config.producer_pools["slow"];
+    EXPECT_EQ(2000, pool.queue_buffering_max_messages);
+    EXPECT_EQ(8388608, pool.queue_high_watermark_bytes);
+    /* the limits not set are the global ones */
+    EXPECT_EQ(33554432, pool.queue_low_watermark_bytes);
+}
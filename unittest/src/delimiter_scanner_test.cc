@@ -0,0 +1,145 @@
+#define protected public
+#define private public
+#include "base/delimiter_scanner.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#undef protected
+#undef private
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+
+class DelimiterScannerTest: public ::testing::Test {
+protected:
+    DelimiterScannerTest() {
+    }
+
+    virtual ~DelimiterScannerTest() {
+    }
+    
+    virtual void SetUp() {
+        srand(0);
+        for (int i = 0; i < 1000; ++i) {
+            m_buf.push_back((rand() % 7 == 0)? '\n': 'a' + rand() % 26);
+        }
+    }
+
+    virtual void TearDown() {
+    }
+
+public:
+    void check(DelimiterScanner::ScanFunc scan_func, size_t max_positions) {
+        vector<size_t> expected;
+        size_t expected_scanned = m_buf.length();
+        for (size_t i = 0; i < m_buf.length() && expected.size() < max_positions; ++i) {
+            if (m_buf[i] == '\n') {
+                expected.push_back(i);
+                if (expected.size() == max_positions) expected_scanned = i + 1;
+            }
+        }
+
+        vector<size_t> positions(max_positions + 1);
+        size_t scanned = 0;
+        size_t n = scan_func(m_buf.c_str(), m_buf.length(), '\n',
+                &positions[0], max_positions, &scanned);
+        positions.resize(n);
+
+        EXPECT_EQ(expected, positions);
+        EXPECT_EQ(expected_scanned, scanned);
+    }
+
+    string m_buf;
+};
+
+TEST_F (DelimiterScannerTest, Scalar) {
+    check(DelimiterScanner::scanScalar, 10000);
+    check(DelimiterScanner::scanScalar, 17);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+TEST_F (DelimiterScannerTest, Sse2) {
+    if (!DelimiterScanner::isSse2Supported()) return;
+    check(DelimiterScanner::scanSse2, 10000);
+    check(DelimiterScanner::scanSse2, 17);
+}
+
+TEST_F (DelimiterScannerTest, Avx2) {
+    if (!DelimiterScanner::isAvx2Supported()) return;
+    check(DelimiterScanner::scanAvx2, 10000);
+    check(DelimiterScanner::scanAvx2, 17);
+}
+#endif
+
+TEST_F (DelimiterScannerTest, Dispatch) {
+    check(DelimiterScanner::scan, 10000);
+    EXPECT_TRUE(NULL != DelimiterScanner::getImplName());
+}
+
+class DelimiterScannerStringTest: public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        srand(0);
+        /* small alphabet, so that partial and overlapping matches occur */
+        for (int i = 0; i < 3000; ++i) {
+            m_buf.push_back("ab\r\n"[rand() % 4]);
+        }
+    }
+
+public:
+    void check(DelimiterScanner::ScanStringFunc scan_func,
+            const string &delimiter, size_t max_positions) {
+        vector<size_t> expected;
+        size_t expected_scanned = m_buf.length();
+        size_t start = 0;
+        while (expected.size() < max_positions) {
+            size_t found = m_buf.find(delimiter, start);
+            if (found == string::npos) break;
+            start = found + delimiter.length();
+            expected.push_back(start - 1);
+            if (expected.size() == max_positions) expected_scanned = start;
+        }
+
+        vector<size_t> positions(max_positions + 1);
+        size_t scanned = 0;
+        size_t n = scan_func(m_buf.c_str(), m_buf.length(),
+                delimiter.c_str(), delimiter.length(),
+                &positions[0], max_positions, &scanned);
+        positions.resize(n);
+
+        EXPECT_EQ(expected, positions) << delimiter;
+        EXPECT_EQ(expected_scanned, scanned) << delimiter;
+    }
+
+    void checkAll(DelimiterScanner::ScanStringFunc scan_func) {
+        const char *delimiters[] = {"\r\n", "aa", "aba", "\r\n\r\n", "ab\r\nba"};
+        for (size_t i = 0; i < sizeof(delimiters) / sizeof(delimiters[0]); ++i) {
+            check(scan_func, delimiters[i], 10000);
+            check(scan_func, delimiters[i], 17);
+        }
+    }
+
+    string m_buf;
+};
+
+TEST_F (DelimiterScannerStringTest, Scalar) {
+    checkAll(DelimiterScanner::scanStringScalar);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+TEST_F (DelimiterScannerStringTest, Sse2) {
+    if (!DelimiterScanner::isSse2Supported()) return;
+    checkAll(DelimiterScanner::scanStringSse2);
+}
+
+TEST_F (DelimiterScannerStringTest, Avx2) {
+    if (!DelimiterScanner::isAvx2Supported()) return;
+    checkAll(DelimiterScanner::scanStringAvx2);
+}
+#endif
+
+TEST_F (DelimiterScannerStringTest, Dispatch) {
+    checkAll(DelimiterScanner::scanString);
+    check(DelimiterScanner::scanString, "\n", 10000);
+}
@@ -0,0 +1,211 @@
+#include "logkafka/delivery_tracker.h"
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace logkafka;
+
+class MemoryPositionEntry: public PositionEntry
+{
+    public:
+        MemoryPositionEntry(): pos(0), updates(0) {};
+        bool update(ino_t inode, off_t p) { pos = p; ++updates; return true; };
+        bool updatePos(off_t p) { pos = p; ++updates; return true; };
+        ino_t readInode() { return 0; };
+        off_t readPos() { return pos; };
+
+    public:
+        off_t pos;
+        int updates;
+};
+
+class Owner: public RefCounted
+{
+    public:
+        Owner(bool *released): m_released(released) {};
+
+    protected:
+        virtual void release() { *m_released = true; delete this; };
+
+    private:
+        bool *m_released;
+};
+
+/* send one batch of count messages, the caller delivers them */
+static DeliveryBatch *send(DeliveryTracker *tracker, off_t end, size_t bytes,
+        int count)
+{
+    DeliveryBatch *batch = tracker->begin();
+    for (int i = 0; i < count; ++i) batch->ref();
+    DeliveryBatch *ret = batch;
+    tracker->end(end, bytes);
+    return ret;
+}
+
+TEST(DeliveryTrackerTest, CommitDeliveredPrefix)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 100, 1000));
+
+    DeliveryBatch *b1 = send(tracker, 200, 100, 2);
+    DeliveryBatch *b2 = send(tracker, 300, 100, 1);
+    DeliveryBatch *b3 = send(tracker, 400, 100, 1);
+    EXPECT_EQ(300U, tracker->getInflightBytes());
+    EXPECT_EQ(100, b1->getStartPos());
+    EXPECT_EQ(300, b3->getStartPos());
+
+    /* out of order, nothing is committed before b1 */
+    b2->unref();
+    b3->unref();
+    EXPECT_EQ(0, pe.updates);
+    EXPECT_EQ(100, tracker->getCommitPos());
+
+    b1->unref();
+    EXPECT_EQ(0, pe.updates);
+    b1->unref();
+    EXPECT_EQ(400, pe.pos);
+    EXPECT_EQ(1, pe.updates);
+    EXPECT_EQ(0U, tracker->getInflightBytes());
+
+    tracker->close();
+    tracker->unref();
+}
+
+TEST(DeliveryTrackerTest, EmptyBatchAndSkip)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 0, 1000));
+
+    /* all lines dropped by the filter */
+    send(tracker, 50, 10, 0);
+    EXPECT_EQ(50, pe.pos);
+
+    DeliveryBatch *b = send(tracker, 80, 10, 1);
+    tracker->skip(120);
+    EXPECT_EQ(50, pe.pos);
+
+    /* the unsent lines keep the range where it is */
+    send(tracker, -1, 0, 0);
+    b->unref();
+    EXPECT_EQ(120, pe.pos);
+
+    tracker->close();
+    tracker->unref();
+}
+
+TEST(DeliveryTrackerTest, RewindOnFailure)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 0, 1000));
+
+    DeliveryBatch *b1 = send(tracker, 100, 100, 1);
+    DeliveryBatch *b2 = send(tracker, 200, 100, 1);
+    DeliveryBatch *b3 = send(tracker, 300, 100, 1);
+
+    b1->unref();
+    EXPECT_EQ(100, pe.pos);
+
+    b2->fail();
+    b2->unref();
+
+    off_t pos = 0;
+    EXPECT_TRUE(tracker->needRewind(pos));
+    EXPECT_EQ(100, pos);
+
+    /* abandoned, it never moves the position */
+    b3->unref();
+    EXPECT_EQ(100, pe.pos);
+    EXPECT_EQ(0U, tracker->getInflightBytes());
+
+    /* nothing is tracked until the reader rewinds */
+    send(tracker, 400, 10, 0);
+    EXPECT_EQ(100, pe.pos);
+
+    tracker->rewind();
+    EXPECT_FALSE(tracker->needRewind(pos));
+    send(tracker, 150, 10, 0);
+    EXPECT_EQ(150, pe.pos);
+
+    tracker->close();
+    tracker->unref();
+}
+
+TEST(DeliveryTrackerTest, InflightLimit)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 0, 250));
+
+    DeliveryBatch *b1 = send(tracker, 100, 100, 1);
+    send(tracker, 200, 100, 0);
+    EXPECT_FALSE(tracker->isFull());
+    DeliveryBatch *b3 = send(tracker, 300, 200, 1);
+    EXPECT_TRUE(tracker->isFull());
+
+    b1->unref();
+    EXPECT_FALSE(tracker->isFull());
+    b3->unref();
+    EXPECT_EQ(300, pe.pos);
+
+    tracker->close();
+    tracker->unref();
+}
+
+TEST(DeliveryTrackerTest, OwnersHeldUntilDelivered)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 0, 1000));
+
+    bool released = false;
+    Owner *owner = new Owner(&released);
+
+    DeliveryBatch *batch = tracker->begin();
+    batch->hold(owner);
+    batch->hold(owner);
+    batch->ref();
+    tracker->end(10, 10);
+    owner->unref();
+    EXPECT_FALSE(released);
+
+    /* the batch outlives the closed tracker */
+    tracker->close();
+    tracker->unref();
+
+    batch->unref();
+    EXPECT_TRUE(released);
+    EXPECT_EQ(0, pe.updates);
+}
+
+static void onCommit(void *arg, off_t pos)
+{
+    reinterpret_cast<vector<off_t> *>(arg)->push_back(pos);
+}
+
+TEST(DeliveryTrackerTest, CommitCallback)
+{
+    MemoryPositionEntry pe;
+    DeliveryTracker *tracker = new DeliveryTracker();
+    ASSERT_TRUE(tracker->init(&pe, 0, 1000));
+    vector<off_t> commits;
+    tracker->setCommitCallback(&commits, onCommit);
+
+    DeliveryBatch *b1 = send(tracker, 100, 100, 1);
+    DeliveryBatch *b2 = send(tracker, 200, 100, 1);
+    /* not before the lines are delivered */
+    EXPECT_TRUE(commits.empty());
+
+    b1->unref();
+    ASSERT_EQ(1U, commits.size());
+    EXPECT_EQ(100, commits[0]);
+
+    /* no callback once closed */
+    tracker->close();
+    b2->unref();
+    EXPECT_EQ(1U, commits.size());
+
+    tracker->unref();
+}
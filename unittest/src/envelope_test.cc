@@ -0,0 +1,109 @@
+#include "logkafka/envelope.h"
+#include "gtest/gtest.h"
+
+using namespace base;
+using namespace logkafka;
+
+static EnvelopeConf makeConf(const char *format, const char *fields[], size_t n)
+{
+    EnvelopeConf conf;
+    conf.format = format;
+    for (size_t i = 0; i < n; ++i) conf.fields.push_back(fields[i]);
+    return conf;
+}
+
+TEST (EnvelopeTest, Json) {
+    Envelope envelope;
+    ASSERT_TRUE(envelope.init(makeConf("json", NULL, 0),
+                "web-1", "id-1", "/var/log/a \"b\".log", 1024));
+
+    const char *data = "GET \"/\"\t200\\\x01";
+    vector<LineSlice> lines;
+    lines.push_back(LineSlice(data, strlen(data), NULL, 42));
+    lines.push_back(LineSlice(data, 3, NULL, 77));
+
+    vector<LineSlice> envelopes;
+    ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    ASSERT_EQ(2U, envelopes.size());
+    EXPECT_EQ("{\"hostname\":\"web-1\",\"logkafka_id\":\"id-1\","
+            "\"path\":\"/var/log/a \\\"b\\\".log\",\"inode\":1024,\"offset\":42,"
+            "\"message\":\"GET \\\"/\\\"\\t200\\\\\\u0001\"}", envelopes[0].str());
+    EXPECT_EQ(42, envelopes[0].offset());
+    EXPECT_EQ("{\"hostname\":\"web-1\",\"logkafka_id\":\"id-1\","
+            "\"path\":\"/var/log/a \\\"b\\\".log\",\"inode\":1024,\"offset\":77,"
+            "\"message\":\"GET\"}", envelopes[1].str());
+
+    /* both in one arena */
+    EXPECT_EQ(envelopes[0].owner(), envelopes[1].owner());
+}
+
+TEST (EnvelopeTest, Prefix) {
+    const char *fields[] = {"offset", "hostname", "path"};
+    EnvelopeConf conf = makeConf("prefix", fields, 3);
+    conf.delimiter = "|";
+
+    Envelope envelope;
+    ASSERT_TRUE(envelope.init(conf, "web-1", "id-1", "/a.log", 1));
+
+    vector<LineSlice> lines(1, LineSlice("line", 4, NULL, 9));
+    vector<LineSlice> envelopes;
+    ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    ASSERT_EQ(1U, envelopes.size());
+    EXPECT_EQ("9|web-1|/a.log|line", envelopes[0].str());
+}
+
+TEST (EnvelopeTest, ArenaReuse) {
+    const char *fields[] = {"hostname"};
+    Envelope envelope;
+    ASSERT_TRUE(envelope.init(makeConf("json", fields, 1), "h", "", "", 0));
+
+    string big(300 * 1024, 'a');
+    vector<LineSlice> lines;
+    lines.push_back(LineSlice(big.data(), 100, NULL));
+    lines.push_back(LineSlice(big.data(), big.length(), NULL));
+
+    vector<LineSlice> envelopes;
+    ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    ASSERT_EQ(2U, envelopes.size());
+    EXPECT_EQ(big.length() + 29, envelopes[1].length());
+    /* the long line does not fit in the first arena */
+    EXPECT_NE(envelopes[0].owner(), envelopes[1].owner());
+    EXPECT_EQ(2UL, envelope.getPool()->getAllocated());
+
+    /* the arenas come back once the envelopes are gone */
+    RefCounted *in_flight = envelopes[0].refOwner();
+    envelopes.clear();
+    ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    EXPECT_EQ(3UL, envelope.getPool()->getAllocated());
+    EXPECT_EQ(1UL, envelope.getPool()->getReused());
+
+    in_flight->unref();
+    envelopes.clear();
+    ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    EXPECT_EQ(3UL, envelope.getPool()->getAllocated());
+    EXPECT_EQ(3UL, envelope.getPool()->getReused());
+}
+
+TEST (EnvelopeTest, InvalidConf) {
+    Envelope envelope;
+    EXPECT_FALSE(envelope.init(makeConf("", NULL, 0), "h", "i", "p", 0));
+    EXPECT_FALSE(envelope.isEnabled());
+    EXPECT_FALSE(envelope.init(makeConf("xml", NULL, 0), "h", "i", "p", 0));
+
+    const char *fields[] = {"hostname", "pid"};
+    EXPECT_FALSE(envelope.init(makeConf("json", fields, 2), "h", "i", "p", 0));
+}
+
+TEST (EnvelopeTest, EnvelopeOutlivesPool) {
+    vector<LineSlice> envelopes;
+    {
+        Envelope envelope;
+        ASSERT_TRUE(envelope.init(makeConf("json", NULL, 0), "h", "i", "p", 0));
+        vector<LineSlice> lines(1, LineSlice("line", 4, NULL, 0));
+        ASSERT_TRUE(envelope.wrap(lines, envelopes));
+    }
+
+    /* the arena, and the pool with it, are freed here */
+    EXPECT_NE(string::npos, envelopes[0].str().find("\"message\":\"line\""));
+    envelopes.clear();
+}
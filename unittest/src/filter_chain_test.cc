@@ -0,0 +1,69 @@
+#include "logkafka/filter_chain.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+static FilterStageConf makeStage(bool include, const char *pattern)
+{
+    FilterStageConf stage;
+    stage.include = include;
+    if (NULL != pattern) stage.patterns.push_back(pattern);
+    return stage;
+}
+
+TEST (FilterChainTest, FirstMatchDecides) {
+    FilterConf conf;
+    conf.regex_filter_pattern = "^DEBUG";
+    conf.stages.push_back(makeStage(true, "payment"));
+    conf.stages.push_back(makeStage(false, "^INFO"));
+
+    FilterChain filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    const char *data[] = {
+        "DEBUG payment ok",
+        "INFO payment ok",
+        "INFO login",
+        "WARN login",
+    };
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); ++i) {
+        lines.push_back(LineSlice(data[i], strlen(data[i]), NULL));
+    }
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(2U, lines.size());
+    EXPECT_EQ("INFO payment ok", lines[0].str());
+    EXPECT_EQ("WARN login", lines[1].str());
+
+    FilterStats stats;
+    filter.getStats(stats);
+    ASSERT_EQ(9U, stats.size());
+    EXPECT_EQ("stage.0.exclude.in", stats[0].first);
+    EXPECT_EQ(4UL, stats[0].second);
+    EXPECT_EQ(3UL, stats[1].second);
+    EXPECT_EQ("stage.1.include.in", stats[3].first);
+    EXPECT_EQ(3UL, stats[3].second);
+    EXPECT_EQ(2UL, stats[4].second);
+    EXPECT_EQ(2UL, stats[6].second);
+    EXPECT_EQ(1UL, stats[7].second);
+}
+
+TEST (FilterChainTest, IncludeOnly) {
+    FilterConf conf;
+    conf.stages.push_back(makeStage(true, "ERROR"));
+    conf.stages.push_back(makeStage(false, NULL));
+
+    FilterChain filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    const char *data[] = {"INFO a", "ERROR b", "DEBUG c"};
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < 3; ++i) {
+        lines.push_back(LineSlice(data[i], strlen(data[i]), NULL));
+    }
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ("ERROR b", lines[0].str());
+}
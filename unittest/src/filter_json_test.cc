@@ -0,0 +1,144 @@
+#include "logkafka/filter_json.h"
+#include "logkafka/filter_regex.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+static JsonPredicateConf makePredicate(const char *field, const char *op,
+        const char *value = NULL, const char *value2 = NULL)
+{
+    JsonPredicateConf predicate;
+    predicate.field = field;
+    predicate.op = op;
+    if (NULL != value) predicate.values.push_back(value);
+    if (NULL != value2) predicate.values.push_back(value2);
+    return predicate;
+}
+
+static bool match(const char *field, const char *op, const char *value,
+        const string &line)
+{
+    FilterConf conf;
+    conf.json_predicates.push_back(makePredicate(field, op, value));
+    FilterJson filter(conf);
+    EXPECT_TRUE(filter.init(NULL));
+    return filter.match(line.data(), line.length());
+}
+
+TEST (FilterJsonTest, Ops) {
+    string line = "{\"level\": \"INFO\", \"ms\": 120, \"ok\": true,"
+        " \"user\": {\"id\": \"u1\", \"tags\": [\"a\", {\"id\": \"u2\"}]}}";
+
+    EXPECT_TRUE(match("level", "eq", "\"INFO\"", line));
+    EXPECT_FALSE(match("level", "eq", "\"DEBUG\"", line));
+    EXPECT_TRUE(match("level", "ne", "\"DEBUG\"", line));
+    EXPECT_TRUE(match("missing", "ne", "\"DEBUG\"", line));
+    EXPECT_FALSE(match("missing", "eq", "\"DEBUG\"", line));
+    EXPECT_TRUE(match("ms", "eq", "120", line));
+    EXPECT_TRUE(match("ms", "gt", "100", line));
+    EXPECT_FALSE(match("ms", "lt", "100", line));
+    EXPECT_TRUE(match("ms", "le", "120", line));
+    EXPECT_TRUE(match("ms", "ge", "120.0", line));
+    EXPECT_FALSE(match("level", "gt", "100", line));
+    EXPECT_TRUE(match("ok", "eq", "true", line));
+    EXPECT_FALSE(match("ok", "eq", "false", line));
+    EXPECT_TRUE(match("user.id", "eq", "\"u1\"", line));
+    EXPECT_TRUE(match("user.tags", "exists", NULL, line));
+    EXPECT_FALSE(match("user.tags.id", "exists", NULL, line));
+    EXPECT_FALSE(match("user.id", "eq", "\"u2\"", line));
+
+    FilterConf conf;
+    conf.json_predicates.push_back(makePredicate("level", "in", "\"WARN\"", "\"INFO\""));
+    FilterJson filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+    EXPECT_TRUE(filter.match(line.data(), line.length()));
+}
+
+TEST (FilterJsonTest, Filter) {
+    FilterConf inner_conf;
+    inner_conf.regex_filter_pattern = "health";
+    FilterRegex *inner = new FilterRegex(inner_conf);
+    ASSERT_TRUE(inner->init(NULL));
+
+    FilterConf conf;
+    conf.json_predicates.push_back(makePredicate("level", "ne", "\"DEBUG\""));
+    conf.json_predicates.push_back(makePredicate("ms", "ge", "10"));
+    FilterJson filter(conf);
+    ASSERT_TRUE(filter.init(inner));
+
+    const char *data[] = {
+        "{\"level\": \"DEBUG\", \"ms\": 50}",
+        "{\"level\": \"INFO\", \"ms\": 50, \"path\": \"/health\"}",
+        "{\"level\": \"INFO\", \"ms\": 5}",
+        "{\"ms\": 15}",
+        "plain text",
+        "[1, 2]",
+        "{\"level\": \"ERROR\", \"ms\": 99, \"trunc",
+        "{\"ms\": 20, \"level\": \"WARN\"} ",
+    };
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); ++i) {
+        lines.push_back(LineSlice(data[i], strlen(data[i]), NULL));
+    }
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(5U, lines.size());
+    EXPECT_EQ("{\"ms\": 15}", lines[0].str());
+    EXPECT_EQ("plain text", lines[1].str());
+    EXPECT_EQ("[1, 2]", lines[2].str());
+    /* decided before the broken tail */
+    EXPECT_EQ(data[6], lines[3].str());
+    EXPECT_EQ(data[7], lines[4].str());
+
+    FilterStats stats;
+    filter.getStats(stats);
+    ASSERT_EQ(3U, stats.size());
+    EXPECT_EQ("json.in", stats[0].first);
+    EXPECT_EQ(7UL, stats[0].second);
+    EXPECT_EQ(2UL, stats[1].second);
+    EXPECT_EQ(2UL, stats[2].second);
+}
+
+/* the inner stage fails and keeps its lines */
+class FailingFilter: public Filter
+{
+    public:
+        bool init(void *arg) { return true; };
+        bool filter(void *arg, vector<LineSlice> &lines) { return false; };
+};
+
+TEST (FilterJsonTest, InnerFailure) {
+    FilterConf conf;
+    conf.json_predicates.push_back(makePredicate("ms", "ge", "10"));
+    FilterJson filter(conf);
+    ASSERT_TRUE(filter.init(new FailingFilter()));
+
+    const char *data[] = {"{\"ms\": 5}", "{\"ms\": 50}"};
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); ++i) {
+        lines.push_back(LineSlice(data[i], strlen(data[i]), NULL));
+    }
+
+    /* the json stage still applies */
+    EXPECT_FALSE(filter.filter(&filter, lines));
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ(data[1], lines[0].str());
+}
+
+TEST (FilterJsonTest, InvalidConf) {
+    FilterConf conf;
+    FilterJson empty(conf);
+    EXPECT_FALSE(empty.init(NULL));
+
+    conf.json_predicates.push_back(makePredicate("ms", "gt", "\"a\""));
+    FilterJson not_number(conf);
+    EXPECT_FALSE(not_number.init(NULL));
+
+    conf.json_predicates[0] = makePredicate("ms", "like", "1");
+    FilterJson unknown(conf);
+    EXPECT_FALSE(unknown.init(NULL));
+
+    conf.json_predicates[0] = makePredicate("ms", "eq", "{}");
+    FilterJson not_scalar(conf);
+    EXPECT_FALSE(not_scalar.init(NULL));
+}
@@ -0,0 +1,51 @@
+#include "logkafka/filter_multi_regex.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+TEST (FilterMultiRegexTest, Filter) {
+    FilterConf conf;
+    conf.regex_filter_pattern = "^GET /health(z)? ";
+    conf.regex_filter_patterns.push_back("Googlebot/\\d");
+    conf.regex_filter_patterns.push_back("\\s500$");
+    conf.regex_filter_patterns.push_back("[Bb]ot");
+
+    FilterMultiRegex filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    const char *data[] = {
+        "GET /healthz 200",
+        "GET /index.html 200",
+        "GET /health 200 Googlebot/2.1",
+        "GET / 200 Googlebot/x",
+        "POST /api 500",
+        "GET /healthy 200",
+    };
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); ++i) {
+        lines.push_back(LineSlice(data[i], strlen(data[i]), NULL));
+    }
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(2U, lines.size());
+    EXPECT_EQ("GET /index.html 200", lines[0].str());
+    EXPECT_EQ("GET /healthy 200", lines[1].str());
+
+    /* the hit goes to the first matching pattern */
+    FilterStats stats;
+    filter.getStats(stats);
+    ASSERT_EQ(4U, stats.size());
+    EXPECT_EQ("regex.0.^GET /health(z)? ", stats[0].first);
+    EXPECT_EQ(2UL, stats[0].second);
+    EXPECT_EQ(0UL, stats[1].second);
+    EXPECT_EQ(1UL, stats[2].second);
+    EXPECT_EQ(1UL, stats[3].second);
+}
+
+TEST (FilterMultiRegexTest, InvalidPattern) {
+    FilterConf conf;
+    conf.regex_filter_patterns.push_back("(abc");
+
+    FilterMultiRegex filter(conf);
+    EXPECT_FALSE(filter.init(NULL));
+}
@@ -0,0 +1,94 @@
+#include "logkafka/filter_plugin.h"
+#include "logkafka/filter_regex.h"
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace logkafka;
+
+static string toString(const LineSlice &line)
+{
+    return string(line.data(), line.length());
+}
+
+TEST (FilterPluginTest, NotLoaded) {
+    FilterPluginConf conf;
+    FilterPlugin filter(conf);
+    EXPECT_FALSE(filter.init(NULL));
+
+    conf.path = "/nonexistent/logkafka_plugin.so";
+    FilterPlugin missing(conf);
+    EXPECT_FALSE(missing.init(NULL));
+}
+
+#ifdef LOGKAFKA_PLUGIN_DIR
+TEST (FilterPluginTest, MaskDigits) {
+    FilterConf filter_conf;
+    filter_conf.regex_filter_pattern = "^DEBUG";
+    FilterRegex *inner = new FilterRegex(filter_conf);
+    ASSERT_TRUE(inner->init(NULL));
+
+    FilterPluginConf conf;
+    conf.path = string(LOGKAFKA_PLUGIN_DIR) + "/logkafka_mask_digits.so";
+    conf.args = "#";
+    FilterPlugin filter(conf);
+    ASSERT_TRUE(filter.init(inner));
+
+    string content = "phone 13800138000DEBUG 42no digits";
+    vector<LineSlice> lines;
+    lines.push_back(LineSlice(content.data(), 17, NULL, 0));
+    lines.push_back(LineSlice(content.data() + 17, 8, NULL, 17));
+    lines.push_back(LineSlice(content.data() + 25, 0, NULL, 25));
+    lines.push_back(LineSlice(content.data() + 25, 9, NULL, 25));
+
+    EXPECT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(2U, lines.size());
+    EXPECT_EQ(string("phone ###########"), toString(lines[0]));
+    EXPECT_EQ(0, lines[0].offset());
+    EXPECT_TRUE(content.data() != lines[0].data());
+    EXPECT_EQ(string("no digits"), toString(lines[1]));
+    EXPECT_EQ(content.data() + 25, lines[1].data());
+
+    /* the rewritten lines outlive the buffer of plugin */
+    vector<LineSlice> next;
+    next.push_back(LineSlice(content.data() + 23, 2, NULL, 23));
+    EXPECT_TRUE(filter.filter(&filter, next));
+    EXPECT_EQ(string("phone ###########"), toString(lines[0]));
+    EXPECT_EQ(string("##"), toString(next[0]));
+
+    FilterStats stats;
+    filter.getStats(stats);
+    ASSERT_EQ(4U, stats.size());
+    EXPECT_EQ(string("plugin.mask_digits.in"), stats[0].first);
+    EXPECT_EQ(4UL, stats[0].second);
+    EXPECT_EQ(1UL, stats[1].second);
+    EXPECT_EQ(2UL, stats[2].second);
+    EXPECT_EQ(0UL, stats[3].second);
+}
+
+/* the inner stage fails and keeps its lines */
+class FailingPluginInner: public Filter
+{
+    public:
+        bool init(void *arg) { return true; };
+        bool filter(void *arg, vector<LineSlice> &lines) { return false; };
+};
+
+TEST (FilterPluginTest, InnerFailure) {
+    FilterPluginConf conf;
+    conf.path = string(LOGKAFKA_PLUGIN_DIR) + "/logkafka_mask_digits.so";
+    conf.args = "#";
+    FilterPlugin filter(conf);
+    ASSERT_TRUE(filter.init(new FailingPluginInner()));
+
+    string content = "id 42";
+    vector<LineSlice> lines;
+    lines.push_back(LineSlice(content.data(), content.size(), NULL, 0));
+
+    /* the plugin still applies */
+    EXPECT_FALSE(filter.filter(&filter, lines));
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ(string("id ##"), toString(lines[0]));
+}
+#endif
@@ -0,0 +1,201 @@
+#include "logkafka/filter_pool.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace logkafka;
+
+/* drops the lines starting with '#', remembers the filtering thread */
+class FilterComment: public Filter
+{
+    public:
+        FilterComment(): m_thread(pthread_self()) {};
+        bool init(void *arg) { return true; };
+        bool filter(void *arg, vector<LineSlice> &lines)
+        {
+            m_thread = pthread_self();
+            size_t kept = 0;
+            for (size_t i = 0; i < lines.size(); ++i) {
+                if (lines[i].length() > 0 && '#' == lines[i].data()[0]) continue;
+                lines[kept++] = lines[i];
+            }
+            lines.resize(kept);
+            return true;
+        };
+
+    public:
+        pthread_t m_thread;
+};
+
+struct Collector
+{
+    FilterPool *pool;
+    FilterComment *filter;
+    FilterJob *job;
+    int batches;
+    int next;
+    vector<string> received;
+};
+
+static void makeLines(int from, int count, vector<LineSlice> &lines)
+{
+    static vector<string> storage;
+    if (storage.empty()) {
+        for (int i = 0; i < 1000; ++i) {
+            char buf[16];
+            snprintf(buf, sizeof(buf), i % 3? "%d": "#%d", i);
+            storage.push_back(buf);
+        }
+    }
+    for (int i = from; i < from + count; ++i) {
+        lines.push_back(LineSlice(storage[i].data(), storage[i].length(), NULL));
+    }
+}
+
+static void onComplete(void *arg, vector<LineSlice> &lines)
+{
+    Collector *c = reinterpret_cast<Collector *>(arg);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        c->received.push_back(string(lines[i].data(), lines[i].length()));
+    }
+    c->job->unref();
+    c->job = NULL;
+
+    /* one batch in flight, the next one is submitted on completion */
+    if (++c->batches < 10) {
+        vector<LineSlice> next;
+        makeLines(c->batches * 100, 100, next);
+        c->job = c->pool->submit(c->filter, next, onComplete, c);
+    }
+}
+
+class FilterPoolTest: public ::testing::Test {
+protected:
+    FilterPoolTest() {
+    }
+
+    virtual ~FilterPoolTest() {
+    }
+
+    virtual void SetUp() {
+        uv_loop_init(&m_loop);
+    }
+
+    virtual void TearDown() {
+        uv_run(&m_loop, UV_RUN_DEFAULT);
+        uv_loop_close(&m_loop);
+    }
+
+    uv_loop_t m_loop;
+};
+
+TEST_F (FilterPoolTest, Order) {
+    FilterPool pool;
+    ASSERT_TRUE(pool.init(&m_loop, 4, 16));
+
+    vector<FilterComment> filters(8);
+    vector<Collector> collectors(filters.size());
+    for (size_t i = 0; i < filters.size(); ++i) {
+        Collector &c = collectors[i];
+        c.pool = &pool;
+        c.filter = &filters[i];
+        c.batches = 0;
+        vector<LineSlice> lines;
+        makeLines(0, 100, lines);
+        c.job = pool.submit(c.filter, lines, onComplete, &c);
+        ASSERT_TRUE(NULL != c.job);
+        EXPECT_TRUE(lines.empty());
+    }
+
+    bool done = false;
+    while (!done) {
+        uv_run(&m_loop, UV_RUN_ONCE);
+        done = true;
+        for (size_t i = 0; i < collectors.size(); ++i) {
+            if (NULL != collectors[i].job) done = false;
+        }
+    }
+
+    for (size_t i = 0; i < collectors.size(); ++i) {
+        ASSERT_EQ(666U, collectors[i].received.size());
+        int k = 0;
+        for (int n = 0; n < 1000; ++n) {
+            if (0 == n % 3) continue;
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%d", n);
+            EXPECT_EQ(string(buf), collectors[i].received[k++]);
+        }
+        EXPECT_FALSE(pthread_equal(pthread_self(), filters[i].m_thread));
+    }
+
+    pool.close();
+}
+
+TEST_F (FilterPoolTest, FinishAndCancel) {
+    FilterPool pool;
+    ASSERT_TRUE(pool.init(&m_loop, 1, 4));
+
+    FilterComment filter;
+    Collector c;
+    c.batches = 10;
+
+    vector<LineSlice> lines;
+    makeLines(0, 9, lines);
+    FilterJob *job = pool.submit(&filter, lines, onComplete, &c);
+    ASSERT_TRUE(NULL != job);
+
+    /* the lines are handed back here, the callback is not called */
+    pool.finish(job, lines);
+    job->unref();
+    ASSERT_EQ(6U, lines.size());
+    EXPECT_EQ(string("1"), string(lines[0].data(), lines[0].length()));
+
+    lines.clear();
+    makeLines(0, 9, lines);
+    job = pool.submit(&filter, lines, onComplete, &c);
+    ASSERT_TRUE(NULL != job);
+    pool.cancel(job);
+    job->unref();
+
+    uv_run(&m_loop, UV_RUN_NOWAIT);
+    EXPECT_TRUE(c.received.empty());
+
+    pool.close();
+
+    /* no pool, the caller filters the lines itself */
+    lines.clear();
+    makeLines(0, 9, lines);
+    EXPECT_TRUE(NULL == pool.submit(&filter, lines, onComplete, &c));
+    EXPECT_EQ(9U, lines.size());
+}
+
+TEST_F (FilterPoolTest, Full) {
+    FilterPool pool;
+    ASSERT_TRUE(pool.init(&m_loop, 1, 2));
+
+    FilterComment filter;
+    Collector c;
+    c.batches = 10;
+    vector<FilterJob *> jobs;
+
+    for (int i = 0; i < 3; ++i) {
+        vector<LineSlice> lines;
+        makeLines(0, 9, lines);
+        FilterJob *job = pool.submit(&filter, lines, onComplete, &c);
+        if (i < 2) {
+            ASSERT_TRUE(NULL != job);
+            jobs.push_back(job);
+        } else {
+            EXPECT_TRUE(NULL == job);
+            EXPECT_EQ(9U, lines.size());
+        }
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        pool.cancel(jobs[i]);
+        jobs[i]->unref();
+    }
+    pool.close();
+}
@@ -0,0 +1,39 @@
+#include "logkafka/filter_regex.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+TEST (FilterRegexTest, Compact) {
+    FilterConf conf;
+    conf.regex_filter_pattern = "DEBUG";
+    FilterRegex filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    /* most lines are dropped, the kept ones stay in order */
+    vector<string> data;
+    for (int i = 0; i < 10000; ++i) {
+        data.push_back(string(i % 10? "DEBUG ": "INFO ") + int2Str(i));
+    }
+    vector<LineSlice> lines;
+    for (size_t i = 0; i < data.size(); ++i) {
+        lines.push_back(LineSlice(data[i].data(), data[i].length(), NULL));
+    }
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(1000U, lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        EXPECT_EQ("INFO " + int2Str(i * 10), lines[i].str());
+    }
+}
+
+TEST (FilterRegexTest, DropAll) {
+    FilterConf conf;
+    conf.regex_filter_pattern = ".";
+    FilterRegex filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    string line = "abc";
+    vector<LineSlice> lines(3, LineSlice(line.data(), line.length(), NULL));
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    EXPECT_TRUE(lines.empty());
+}
@@ -0,0 +1,191 @@
+#include "logkafka/filter_sample.h"
+#include "logkafka/filter_regex.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace logkafka;
+
+static void makeLines(vector<string> &data, vector<LineSlice> &lines)
+{
+    lines.clear();
+    for (size_t i = 0; i < data.size(); ++i) {
+        lines.push_back(LineSlice(data[i].data(), data[i].length(), NULL));
+    }
+}
+
+TEST (FilterSampleTest, FixedRate) {
+    SampleConf conf;
+    conf.rate = 0.25;
+
+    FilterSample filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    vector<string> data;
+    for (int i = 0; i < 1000; ++i) data.push_back("line " + int2Str(i));
+    vector<LineSlice> lines;
+    makeLines(data, lines);
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(250U, lines.size());
+    EXPECT_EQ("line 3", lines[0].str());
+    EXPECT_EQ("line 7", lines[1].str());
+
+    FilterStats stats;
+    filter.getStats(stats);
+    ASSERT_EQ(3U, stats.size());
+    EXPECT_EQ("sample.in", stats[0].first);
+    EXPECT_EQ(1000UL, stats[0].second);
+    EXPECT_EQ("sample.sampled_out", stats[1].first);
+    EXPECT_EQ(750UL, stats[1].second);
+    EXPECT_EQ("sample.rate_ppm", stats[2].first);
+    EXPECT_EQ(250000UL, stats[2].second);
+}
+
+TEST (FilterSampleTest, HashOfKey) {
+    SampleConf conf;
+    conf.rate = 0.3;
+    conf.key_pattern = "req=(\\w+)";
+
+    FilterSample filter(conf), other(conf);
+    ASSERT_TRUE(filter.init(NULL));
+    ASSERT_TRUE(other.init(NULL));
+
+    vector<string> data;
+    for (int i = 0; i < 3000; ++i) {
+        data.push_back("step " + int2Str(i % 3) + " req=" + int2Str(i / 3));
+    }
+    vector<LineSlice> lines;
+    makeLines(data, lines);
+    ASSERT_TRUE(filter.filter(&filter, lines));
+
+    /* the lines of a request are kept together */
+    ASSERT_EQ(0U, lines.size() % 3);
+    for (size_t i = 0; i < lines.size(); i += 3) {
+        string key = lines[i].str().substr(7);
+        EXPECT_EQ(key, lines[i + 1].str().substr(7));
+        EXPECT_EQ(key, lines[i + 2].str().substr(7));
+    }
+    EXPECT_NEAR(900, (int)lines.size(), 150);
+
+    /* the same keys are kept by another instance */
+    vector<LineSlice> other_lines;
+    makeLines(data, other_lines);
+    ASSERT_TRUE(other.filter(&other, other_lines));
+    ASSERT_EQ(lines.size(), other_lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        EXPECT_EQ(lines[i].str(), other_lines[i].str());
+    }
+}
+
+TEST (FilterSampleTest, InnerFilter) {
+    FilterConf filter_conf;
+    filter_conf.regex_filter_pattern = "^DEBUG";
+    FilterRegex *inner = new FilterRegex(filter_conf);
+    ASSERT_TRUE(inner->init(NULL));
+
+    SampleConf conf;
+    conf.rate = 0.5;
+    FilterSample filter(conf);
+    ASSERT_TRUE(filter.init(inner));
+
+    vector<string> data;
+    data.push_back("DEBUG a");
+    data.push_back("INFO b");
+    data.push_back("DEBUG c");
+    data.push_back("INFO d");
+    vector<LineSlice> lines;
+    makeLines(data, lines);
+
+    ASSERT_TRUE(filter.filter(&filter, lines));
+    ASSERT_EQ(1U, lines.size());
+    EXPECT_EQ("INFO d", lines[0].str());
+}
+
+/* the inner stage fails and keeps its lines */
+class FailingInner: public Filter
+{
+    public:
+        bool init(void *arg) { return true; };
+        bool filter(void *arg, vector<LineSlice> &lines) { return false; };
+};
+
+TEST (FilterSampleTest, InnerFailure) {
+    SampleConf conf;
+    conf.rate = 0.5;
+    FilterSample filter(conf);
+    ASSERT_TRUE(filter.init(new FailingInner()));
+
+    vector<string> data;
+    data.push_back("a");
+    data.push_back("b");
+    data.push_back("c");
+    data.push_back("d");
+    vector<LineSlice> lines;
+    makeLines(data, lines);
+
+    /* sampled all the same */
+    EXPECT_FALSE(filter.filter(&filter, lines));
+    EXPECT_EQ(2U, lines.size());
+}
+
+TEST (FilterSampleTest, LinesBudget) {
+    SampleConf conf;
+    conf.max_lines_per_sec = 100;
+
+    FilterSample filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    vector<string> data(1000, "line");
+    vector<LineSlice> lines;
+
+    /* the first second is cut at the budget */
+    makeLines(data, lines);
+    filter.sample(lines, 1000);
+    EXPECT_EQ(100U, lines.size());
+
+    /* then the rate follows the input */
+    makeLines(data, lines);
+    filter.sample(lines, 2000);
+    EXPECT_DOUBLE_EQ(0.1, filter.getRate());
+    EXPECT_NEAR(100, (int)lines.size(), 1);
+
+    /* and recovers when the input drops */
+    data.resize(10);
+    for (unsigned long now = 3000; now < 20000; now += 1000) {
+        makeLines(data, lines);
+        filter.sample(lines, now);
+    }
+    EXPECT_GT(filter.getRate(), 0.99);
+}
+
+TEST (FilterSampleTest, BytesBudget) {
+    SampleConf conf;
+    conf.max_bytes_per_sec = 1000;
+
+    FilterSample filter(conf);
+    ASSERT_TRUE(filter.init(NULL));
+
+    vector<string> data(100, string(100, 'a'));
+    vector<LineSlice> lines;
+    makeLines(data, lines);
+    filter.sample(lines, 1000);
+    EXPECT_EQ(10U, lines.size());
+
+    makeLines(data, lines);
+    filter.sample(lines, 3000);
+    /* 10000 bytes in 2 seconds */
+    EXPECT_DOUBLE_EQ(0.2, filter.getRate());
+}
+
+TEST (FilterSampleTest, InvalidConf) {
+    SampleConf conf;
+    conf.rate = 1.5;
+    FilterSample filter(conf);
+    EXPECT_FALSE(filter.init(NULL));
+
+    conf.rate = 0.5;
+    conf.key_pattern = "(";
+    FilterSample other(conf);
+    EXPECT_FALSE(other.init(NULL));
+}
@@ -0,0 +1,100 @@
+#include "logkafka/io_handler.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace logkafka;
+
+class TestPositionEntry: public PositionEntry
+{
+    public:
+        TestPositionEntry(): pos(0) {};
+        bool update(ino_t inode, off_t p) { pos = p; return true; };
+        bool updatePos(off_t p) { pos = p; return true; };
+        ino_t readInode() { return 0; };
+        off_t readPos() { return pos; };
+
+    public:
+        off_t pos;
+};
+
+/* counts the lines it sees, drops the ones starting with '#' */
+class CountingFilter: public Filter
+{
+    public:
+        CountingFilter(): seen(0) {};
+        bool init(void *arg) { return true; };
+        bool filter(void *arg, vector<LineSlice> &lines)
+        {
+            seen += lines.size();
+            compactLines(lines, [](size_t i, LineSlice &line) {
+                return 0 == line.length() || '#' != line.data()[0];
+            });
+            return true;
+        };
+
+    public:
+        size_t seen;
+};
+
+static string received;
+static int calls = 0;
+
+/* the output takes half of the lines of every other call */
+static bool receiveLines(void *filter, void *output,
+        vector<LineSlice> &lines, vector<LineSlice> &unsent_lines,
+        DeliveryBatch *batch)
+{
+    Filter *flt = reinterpret_cast<Filter *>(filter);
+    if (NULL != flt) {
+        flt->filter(flt, lines);
+    }
+
+    if (0 == calls++ % 2 && lines.size() > 1) {
+        unsent_lines.assign(lines.begin() + lines.size() / 2, lines.end());
+        lines.resize(lines.size() / 2);
+    }
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        received.append(lines[i].data(), lines[i].length());
+        received += '|';
+    }
+
+    return true;
+}
+
+TEST(IOHandlerTest, UnsentLinesAreNotFilteredAgain)
+{
+    string content, expected;
+    for (int i = 0; i < 100; ++i) {
+        string line = (0 == i % 3? "#": "") + string("line") + char('a' + i % 26);
+        content += line + "\n";
+        if ('#' != line[0]) expected += line + "|";
+    }
+
+    FILE *file = tmpfile();
+    ASSERT_TRUE(NULL != file);
+    fwrite(content.data(), 1, content.size(), file);
+    rewind(file);
+
+    received.clear();
+    calls = 0;
+    TestPositionEntry pe;
+    CountingFilter filter;
+    IOHandler *ioh = new IOHandler();
+    ASSERT_TRUE(ioh->init(file, &pe, 8, 1, 8, 1024, 4096, 0, 0, false,
+                "\n", true, 0, MultilineConf(), &filter, NULL, receiveLines));
+
+    for (int i = 0; i < 100 && received.size() < expected.size(); ++i) {
+        IOHandler::onNotify(ioh);
+    }
+
+    EXPECT_EQ(expected, received);
+    EXPECT_EQ(100U, filter.seen);
+    EXPECT_EQ((off_t)content.size(), pe.pos);
+
+    ioh->close();
+    delete ioh;
+}
@@ -0,0 +1,59 @@
+#include "base/io_uring.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+
+class IOUringTest: public ::testing::Test {
+protected:
+    IOUringTest() {
+    }
+
+    virtual ~IOUringTest() {
+    }
+
+    virtual void SetUp() {
+        m_file = tmpfile();
+        fputs("hello io_uring\n", m_file);
+        fflush(m_file);
+    }
+
+    virtual void TearDown() {
+        fclose(m_file);
+    }
+
+    FILE *m_file;
+};
+
+#ifdef BASE_HAVE_IO_URING
+TEST_F (IOUringTest, Read) {
+    IOUring ring;
+    /* no io_uring in this kernel, nothing to test */
+    if (!ring.init(8) || !ring.isOpSupported(IORING_OP_READ)) return;
+
+    char buf[64] = {'\0'};
+    struct io_uring_sqe *sqe = ring.getSqe();
+    ASSERT_TRUE(NULL != sqe);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fileno(m_file);
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = sizeof(buf);
+    sqe->off = 6;
+    sqe->user_data = 42;
+    EXPECT_EQ(1U, ring.getPending());
+
+    EXPECT_EQ(1, ring.submit(1));
+    EXPECT_EQ(0U, ring.getPending());
+
+    uint64_t user_data = 0;
+    int res = 0;
+    ASSERT_TRUE(ring.popCqe(user_data, res));
+    EXPECT_EQ(42U, user_data);
+    EXPECT_EQ(9, res);
+    EXPECT_EQ(string("io_uring\n"), string(buf, res));
+    EXPECT_FALSE(ring.popCqe(user_data, res));
+}
+#endif
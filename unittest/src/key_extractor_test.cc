@@ -0,0 +1,79 @@
+#include "logkafka/key_extractor.h"
+#include "gtest/gtest.h"
+
+using namespace logkafka;
+
+static string extract(KeyExtractor &extractor, const string &line)
+{
+    const char *key = NULL;
+    size_t key_len = 0;
+    if (!extractor.extract(line.data(), line.length(), &key, &key_len)) {
+        return "<none>";
+    }
+
+    /* the key points into the line */
+    EXPECT_TRUE(key >= line.data() && key + key_len <= line.data() + line.length());
+    return string(key, key_len);
+}
+
+TEST (KeyExtractorTest, Disabled) {
+    KafkaTopicConf conf;
+    conf.key = "fixed";
+
+    KeyExtractor extractor;
+    ASSERT_TRUE(extractor.init(conf));
+    EXPECT_FALSE(extractor.isEnabled());
+    EXPECT_EQ("<none>", extract(extractor, "a b c"));
+}
+
+TEST (KeyExtractorTest, Pattern) {
+    KafkaTopicConf conf;
+    conf.key_pattern = "session=(\\w+)";
+
+    KeyExtractor extractor;
+    ASSERT_TRUE(extractor.init(conf));
+    EXPECT_TRUE(extractor.isEnabled());
+    EXPECT_EQ("s42", extract(extractor, "GET / session=s42 200"));
+    EXPECT_EQ("<none>", extract(extractor, "GET / 200"));
+
+    conf.key_pattern = "(";
+    EXPECT_FALSE(extractor.init(conf));
+    EXPECT_FALSE(extractor.isEnabled());
+}
+
+TEST (KeyExtractorTest, Field) {
+    KafkaTopicConf conf;
+    conf.key_field = 3;
+    conf.key_field_delimiter = "\t";
+
+    KeyExtractor extractor;
+    ASSERT_TRUE(extractor.init(conf));
+    EXPECT_EQ("user1", extract(extractor, "2026-10-17\tINFO\tuser1\tlogin"));
+    EXPECT_EQ("user2", extract(extractor, "2026-10-17\tINFO\tuser2"));
+    EXPECT_EQ("<none>", extract(extractor, "2026-10-17\tINFO\t\tlogin"));
+    EXPECT_EQ("<none>", extract(extractor, "2026-10-17\tINFO"));
+
+    conf.key_field = 2;
+    conf.key_field_delimiter = " | ";
+    ASSERT_TRUE(extractor.init(conf));
+    EXPECT_EQ("b c", extract(extractor, "a | b c | d"));
+}
+
+TEST (KeyExtractorTest, JsonField) {
+    KafkaTopicConf conf;
+    conf.key_json_field = "user.id";
+
+    KeyExtractor extractor;
+    ASSERT_TRUE(extractor.init(conf));
+    EXPECT_EQ("u1", extract(extractor,
+                "{\"msg\": \"a \\\"user\\\" {x}\", \"tags\": [1, {\"id\": 2}],"
+                " \"user\": {\"name\": \"n\", \"id\": \"u1\"}}"));
+    EXPECT_EQ("1024", extract(extractor, "{\"user\":{\"id\":1024}}"));
+    EXPECT_EQ("<none>", extract(extractor, "{\"user\": \"u1\"}"));
+    EXPECT_EQ("<none>", extract(extractor, "{\"id\": \"u1\"}"));
+    EXPECT_EQ("<none>", extract(extractor, "not json"));
+    EXPECT_EQ("<none>", extract(extractor, "{\"user\": {\"id\": \"u1"));
+
+    conf.key_json_field = "user..id";
+    EXPECT_FALSE(extractor.init(conf));
+}
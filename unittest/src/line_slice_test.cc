@@ -0,0 +1,94 @@
+#include "logkafka/line_slice.h"
+#include "base/ring_buffer.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+using namespace logkafka;
+
+class LineSliceTest: public ::testing::Test {
+protected:
+    LineSliceTest() {
+    }
+
+    virtual ~LineSliceTest() {
+    }
+
+    virtual void SetUp() {
+        m_ring = RingBuffer::create(4096);
+        memcpy(m_ring->at(0), "line1\nline2\n", 12);
+        m_ring->produce(12);
+        m_chunk = m_ring->acquire(12);
+    }
+
+    virtual void TearDown() {
+        if (NULL != m_chunk) m_chunk->unref();
+        m_ring->unref();
+    }
+
+    RingBuffer *m_ring;
+    RingBuffer::Segment *m_chunk;
+};
+
+TEST_F (LineSliceTest, Slice) {
+    LineSlice ls(m_ring->at(0) + 6, 5, m_chunk);
+    EXPECT_EQ(string("line2"), ls.str());
+    EXPECT_EQ(5U, ls.length());
+    EXPECT_TRUE(m_chunk->isShared());
+}
+
+TEST_F (LineSliceTest, Reference) {
+    vector<LineSlice> lines;
+    lines.push_back(LineSlice(m_ring->at(0), 5, m_chunk));
+    lines.push_back(LineSlice(m_ring->at(0) + 6, 5, m_chunk));
+
+    vector<LineSlice> copied = lines;
+    lines.clear();
+    EXPECT_TRUE(m_chunk->isShared());
+
+    RefCounted *owner = copied[0].refOwner();
+    copied.clear();
+    EXPECT_TRUE(m_chunk->isShared());
+
+    owner->unref();
+    EXPECT_FALSE(m_chunk->isShared());
+
+    m_chunk->unref(); m_chunk = NULL;
+    m_ring->reclaim();
+    EXPECT_EQ(12U, m_ring->tail());
+}
+
+TEST_F (LineSliceTest, Wraparound) {
+    size_t size = m_ring->size();
+
+    /* release the first segment and fill up the ring */
+    m_chunk->unref(); m_chunk = NULL;
+    m_ring->reclaim();
+    m_ring->produce(size - 12 - 4);
+    RingBuffer::Segment *segment = m_ring->acquire(m_ring->head());
+    segment->unref();
+    m_ring->reclaim();
+    EXPECT_EQ(size, m_ring->room());
+
+    /* a line crossing the end of the ring is still contiguous */
+    memcpy(m_ring->at(m_ring->head()), "wrapped", 7);
+    EXPECT_EQ(0, memcmp(m_ring->at(0), "ped", 3));
+    LineSlice ls(m_ring->at(m_ring->head()), 7, NULL);
+    EXPECT_EQ(string("wrapped"), ls.str());
+}
+
+TEST_F (LineSliceTest, Offset) {
+    LineSlice ls(m_ring->at(0) + 6, 5, m_chunk, 1030);
+    EXPECT_EQ(1030, ls.offset());
+
+    LineSlice copied = ls;
+    EXPECT_EQ(1030, copied.offset());
+
+    LineSlice moved(std::move(ls));
+    EXPECT_EQ(1030, moved.offset());
+
+    EXPECT_EQ(-1, LineSlice(m_ring->at(0), 5, m_chunk).offset());
+}
@@ -0,0 +1,125 @@
+#include "base/lock_free_queue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+
+class LockFreeQueueTest: public ::testing::Test {
+protected:
+    LockFreeQueueTest() {
+    }
+
+    virtual ~LockFreeQueueTest() {
+    }
+
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+static const size_t ITEMS_PER_PRODUCER = 10000;
+
+struct QueueArg
+{
+    LockFreeQueue<size_t> *queue;
+    size_t producer;
+    vector<size_t> *seen;
+};
+
+static void *produce(void *arg)
+{
+    QueueArg *qa = reinterpret_cast<QueueArg *>(arg);
+    for (size_t i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+        size_t value = qa->producer * ITEMS_PER_PRODUCER + i;
+        while (!qa->queue->push(value)) sched_yield();
+    }
+    return NULL;
+}
+
+static void *consume(void *arg)
+{
+    QueueArg *qa = reinterpret_cast<QueueArg *>(arg);
+    size_t value = 0;
+    while (true) {
+        if (!qa->queue->pop(value)) {
+            sched_yield();
+            continue;
+        }
+        if ((size_t)-1 == value) break;
+        qa->seen->push_back(value);
+    }
+    return NULL;
+}
+
+TEST_F (LockFreeQueueTest, Bounded) {
+    LockFreeQueue<int> queue(3);
+    EXPECT_EQ(4U, queue.capacity());
+
+    int value = 0;
+    EXPECT_FALSE(queue.pop(value));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(queue.push(4));
+
+    for (int i = 1; i <= 4; ++i) {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST_F (LockFreeQueueTest, Concurrent) {
+    const size_t producers = 4, consumers = 4;
+    LockFreeQueue<size_t> queue(64);
+    vector<vector<size_t> > seen(consumers);
+    vector<QueueArg> args(producers + consumers);
+    vector<pthread_t> threads(producers + consumers);
+
+    for (size_t i = 0; i < consumers; ++i) {
+        args[i].queue = &queue;
+        args[i].seen = &seen[i];
+        pthread_create(&threads[i], NULL, consume, &args[i]);
+    }
+    for (size_t i = 0; i < producers; ++i) {
+        args[consumers + i].queue = &queue;
+        args[consumers + i].producer = i;
+        pthread_create(&threads[consumers + i], NULL, produce,
+                &args[consumers + i]);
+    }
+
+    for (size_t i = 0; i < producers; ++i) {
+        pthread_join(threads[consumers + i], NULL);
+    }
+    for (size_t i = 0; i < consumers; ++i) {
+        while (!queue.push((size_t)-1)) sched_yield();
+    }
+    for (size_t i = 0; i < consumers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* every item is popped once, in the order of its producer */
+    vector<size_t> count(producers * ITEMS_PER_PRODUCER, 0);
+    for (size_t i = 0; i < consumers; ++i) {
+        vector<size_t> last(producers, 0);
+        for (size_t k = 0; k < seen[i].size(); ++k) {
+            size_t value = seen[i][k];
+            size_t producer = value / ITEMS_PER_PRODUCER;
+            EXPECT_LE(last[producer], value % ITEMS_PER_PRODUCER);
+            last[producer] = value % ITEMS_PER_PRODUCER + 1;
+            ++count[value];
+        }
+    }
+    for (size_t i = 0; i < count.size(); ++i) {
+        ASSERT_EQ(1U, count[i]);
+    }
+}
@@ -0,0 +1,55 @@
+#include "base/mmap_window.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+
+class MmapWindowTest: public ::testing::Test {
+protected:
+    MmapWindowTest() {
+    }
+
+    virtual ~MmapWindowTest() {
+    }
+
+    virtual void SetUp() {
+        m_file = tmpfile();
+        for (int i = 0; i < 10000; ++i) {
+            fputs("line\n", m_file);
+        }
+        fflush(m_file);
+    }
+
+    virtual void TearDown() {
+        fclose(m_file);
+    }
+
+    FILE *m_file;
+};
+
+TEST_F (MmapWindowTest, Map) {
+    size_t page_size = MmapWindow::getPageSize();
+    MmapWindow *window = MmapWindow::create(fileno(m_file), page_size, 5000);
+    ASSERT_TRUE(NULL != window);
+    EXPECT_EQ(5000U, window->length());
+    EXPECT_EQ(0, memcmp(window->data() + (5 - page_size % 5) % 5, "line\n", 5));
+    window->unref();
+}
+
+TEST_F (MmapWindowTest, Truncate) {
+    MmapWindow *window = MmapWindow::create(fileno(m_file), 0, 50000);
+    ASSERT_TRUE(NULL != window);
+    ASSERT_EQ(0, ftruncate(fileno(m_file), 0));
+
+    /* the truncated pages read as zeros */
+    size_t zeros = 0;
+    for (size_t i = 0; i < window->length(); ++i) {
+        if ('\0' == window->data()[i]) ++zeros;
+    }
+    EXPECT_EQ(window->length(), zeros);
+    window->unref();
+}
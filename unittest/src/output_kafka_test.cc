@@ -0,0 +1,122 @@
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+#define private public
+#define protected public
+#include "logkafka/output_kafka.h"
+#include "logkafka/zookeeper.h"
+#undef private
+#undef protected
+
+using namespace std;
+using namespace logkafka;
+
+class OutputKafkaTest: public ::testing::Test
+{
+    protected:
+        virtual void SetUp()
+        {
+            /* the producers never connect, the pools are only counted */
+            m_zookeeper.m_broker_urls = "127.0.0.1:1";
+
+            KafkaConf kafka_conf = {1048576, 0, 1000, 1048576, 524288};
+            OutputKafka::setKafkaConf(kafka_conf);
+            OutputKafka::setPoolKafkaConfs(KafkaConfMap());
+        }
+
+        virtual void TearDown()
+        {
+            OutputKafka::stopProducers();
+        }
+
+        static bool hasPool(const string &pool_key)
+        {
+            return OutputKafka::m_producer_map.count(pool_key) > 0;
+        }
+
+        static KafkaTopicConf makeConf(const string &topic, const string &pool)
+        {
+            KafkaTopicConf conf;
+            conf.topic = topic;
+            conf.producer_pool = pool;
+            return conf;
+        }
+
+        Zookeeper m_zookeeper;
+};
+
+TEST_F(OutputKafkaTest, PoolKeys)
+{
+    EXPECT_EQ("none", OutputKafka::getPoolKey(makeConf("a", "")));
+    EXPECT_EQ("none", OutputKafka::getPoolKey(makeConf("a", "shared")));
+    EXPECT_EQ("none/topic/a", OutputKafka::getPoolKey(makeConf("a", "topic")));
+    EXPECT_EQ("none/group/slow", OutputKafka::getPoolKey(makeConf("a", "slow")));
+}
+
+TEST_F(OutputKafkaTest, SharedPool)
+{
+    OutputKafka *a = new OutputKafka();
+    OutputKafka *b = new OutputKafka();
+    ASSERT_TRUE(a->init(&m_zookeeper, makeConf("a", "")));
+    ASSERT_TRUE(b->init(&m_zookeeper, makeConf("b", "shared")));
+    EXPECT_EQ(a->m_producer, b->m_producer);
+    EXPECT_EQ(2, OutputKafka::m_producer_map["none"].users);
+
+    delete a;
+    EXPECT_TRUE(hasPool("none"));
+
+    delete b;
+    OutputKafka::reapProducers();
+    EXPECT_FALSE(hasPool("none"));
+}
+
+/* the watcher of a changed task is rebuilt with a new output */
+TEST_F(OutputKafkaTest, ReapOldPoolOnChange)
+{
+    OutputKafka *old_output = new OutputKafka();
+    ASSERT_TRUE(old_output->init(&m_zookeeper, makeConf("a", "topic")));
+    EXPECT_TRUE(hasPool("none/topic/a"));
+
+    OutputKafka *new_output = new OutputKafka();
+    ASSERT_TRUE(new_output->init(&m_zookeeper, makeConf("a", "slow")));
+    EXPECT_NE(old_output->m_producer, new_output->m_producer);
+
+    delete old_output;
+    OutputKafka::reapProducers();
+    EXPECT_FALSE(hasPool("none/topic/a"));
+    EXPECT_TRUE(hasPool("none/group/slow"));
+
+    delete new_output;
+    OutputKafka::reapProducers();
+    EXPECT_TRUE(OutputKafka::m_producer_map.empty());
+}
+
+TEST_F(OutputKafkaTest, CloseDrainedPoolOnly)
+{
+    OutputKafka *output = new OutputKafka();
+    ASSERT_TRUE(output->init(&m_zookeeper, makeConf("a", "topic")));
+
+    /* no broker, the message times out */
+    string payload = "line";
+    vector<LineSlice> messages(1, LineSlice(payload.data(), payload.size(), NULL));
+    vector<MessageKey> keys;
+    vector<LineSlice> unsent;
+    Producer *producer = output->m_producer;
+    producer->send(messages, keys, unsent, "", "a", "", 1, -1, 100);
+    EXPECT_EQ(1, producer->getQueuedMessages());
+
+    delete output;
+    OutputKafka::reapProducers();
+    EXPECT_TRUE(hasPool("none/topic/a"));
+
+    for (int i = 0; i < 50 && producer->getQueuedMessages() > 0; ++i) {
+        usleep(100000);
+        producer->poll();
+    }
+    EXPECT_EQ(1UL, producer->getFailedMessages());
+
+    OutputKafka::reapProducers();
+    EXPECT_FALSE(hasPool("none/topic/a"));
+}
@@ -0,0 +1,111 @@
+#include "logkafka/record_assembler.h"
+#include "base/ring_buffer.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace base;
+using namespace logkafka;
+
+class RecordAssemblerTest: public ::testing::Test {
+protected:
+    RecordAssemblerTest() {
+    }
+
+    virtual ~RecordAssemblerTest() {
+    }
+
+    virtual void SetUp() {
+        m_conf.start_pattern = "^[0-9]";
+        m_conf.max_lines = 3;
+
+        const char *data = "1 a\n  b\n  c\n2 d\n3 e\n  f\n  g\n  h\n";
+        m_len = strlen(data);
+        m_ring = RingBuffer::create(4096);
+        memcpy(m_ring->at(0), data, m_len);
+        m_ring->produce(m_len);
+        m_chunk = m_ring->acquire(m_len);
+    }
+
+    virtual void TearDown() {
+        m_chunk->unref();
+        m_ring->unref();
+    }
+
+    void split(size_t begin, size_t end,
+            vector<LineSlice> &lines, vector<off_t> &offsets) {
+        const char *buf = m_ring->at(0);
+        size_t cur = begin;
+        for (size_t i = begin; i < end; ++i) {
+            if (buf[i] == '\n') {
+                lines.push_back(LineSlice(buf + cur, i - cur, m_chunk));
+                offsets.push_back(cur);
+                cur = i + 1;
+            }
+        }
+    }
+
+    MultilineConf m_conf;
+    RingBuffer *m_ring;
+    RingBuffer::Segment *m_chunk;
+    size_t m_len;
+};
+
+TEST_F (RecordAssemblerTest, Join) {
+    RecordAssembler assembler;
+    ASSERT_TRUE(assembler.init(m_conf, "\n", true));
+
+    vector<LineSlice> lines;
+    vector<off_t> offsets;
+    split(0, m_len, lines, offsets);
+    assembler.assemble(lines, offsets, 0);
+
+    ASSERT_EQ(3U, lines.size());
+    EXPECT_EQ(string("1 a\n  b\n  c"), lines[0].str());
+    EXPECT_EQ(string("2 d"), lines[1].str());
+    /* max lines reached */
+    EXPECT_EQ(string("3 e\n  f\n  g"), lines[2].str());
+    /* contiguous lines are joined in place */
+    EXPECT_EQ(m_ring->at(0), lines[0].data());
+
+    EXPECT_TRUE(assembler.hasPending());
+    EXPECT_EQ(28, assembler.getPendingOffset());
+
+    EXPECT_FALSE(assembler.flush(lines, false));
+    EXPECT_TRUE(assembler.flush(lines, true));
+    ASSERT_EQ(4U, lines.size());
+    EXPECT_EQ(string("  h"), lines[3].str());
+    EXPECT_FALSE(assembler.hasPending());
+}
+
+TEST_F (RecordAssemblerTest, Batches) {
+    RecordAssembler assembler;
+    ASSERT_TRUE(assembler.init(m_conf, "\n", true));
+
+    vector<LineSlice> lines;
+    vector<off_t> offsets;
+
+    /* the record is split by batches, then detached from the buffer */
+    split(0, 8, lines, offsets);
+    assembler.assemble(lines, offsets, 0);
+    EXPECT_TRUE(lines.empty());
+    EXPECT_EQ(0, assembler.getPendingOffset());
+    assembler.detach();
+
+    offsets.clear();
+    split(8, m_len, lines, offsets);
+    assembler.assemble(lines, offsets, 0);
+
+    ASSERT_EQ(3U, lines.size());
+    EXPECT_EQ(string("1 a\n  b\n  c"), lines[0].str());
+    EXPECT_NE(m_ring->at(0), lines[0].data());
+    EXPECT_EQ(string("2 d"), lines[1].str());
+    EXPECT_EQ(string("3 e\n  f\n  g"), lines[2].str());
+}
+
+TEST_F (RecordAssemblerTest, Disabled) {
+    RecordAssembler assembler;
+    EXPECT_FALSE(assembler.init(MultilineConf(), "\n", true));
+}
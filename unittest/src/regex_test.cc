@@ -0,0 +1,75 @@
+#include "logkafka/regex.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+using namespace logkafka;
+
+TEST (RegexTest, Invalid) {
+    Regex regex;
+    EXPECT_FALSE(regex.init("(abc"));
+    EXPECT_FALSE(regex.isValid());
+}
+
+TEST (RegexTest, ExplicitLength) {
+    Regex regex;
+    ASSERT_TRUE(regex.init("ERROR$"));
+
+    /* the data is not NUL-terminated */
+    const char *line = "level=ERROR, level=INFO";
+    EXPECT_TRUE(regex.match(line, strlen("level=ERROR")));
+    EXPECT_FALSE(regex.match(line, strlen(line)));
+    EXPECT_FALSE(regex.match(NULL, 0));
+}
+
+TEST (RegexTest, EmbeddedNul) {
+    Regex regex;
+    ASSERT_TRUE(regex.init("GET"));
+
+    const char line[] = "\0\0GET /";
+    EXPECT_TRUE(regex.match(line, sizeof(line) - 1));
+    EXPECT_FALSE(regex.match(line, 2));
+}
+
+TEST (RegexTest, Reuse) {
+    Regex regex;
+    ASSERT_TRUE(regex.init("\" (4|5)\\d\\d "));
+
+    /* the match data and JIT stack are reused across lines */
+    for (int i = 0; i < 1000; ++i) {
+        string line = (i % 2)? "\"GET / HTTP/1.1\" 404 12": "\"GET / HTTP/1.1\" 200 12";
+        EXPECT_EQ(i % 2 == 1, regex.match(line.data(), line.length()));
+    }
+}
+
+TEST (RegexTest, RequiredLiteral) {
+    EXPECT_EQ("GET /health", Regex::requiredLiteral("^GET /health(z)?$"));
+    EXPECT_EQ("ooglebot", Regex::requiredLiteral("[Gg]ooglebot"));
+    EXPECT_EQ("/wp-", Regex::requiredLiteral("/wp-\\w+\\.php"));
+    EXPECT_EQ("cSpider", Regex::requiredLiteral("ab?cSpiders?"));
+    EXPECT_EQ("abc", Regex::requiredLiteral("x{0,3}abc{1}"));
+    EXPECT_EQ("sta", Regex::requiredLiteral("[[:alpha:]]+sta]?"));
+    EXPECT_EQ("", Regex::requiredLiteral("googlebot|bingbot"));
+    EXPECT_EQ("", Regex::requiredLiteral("(?i)googlebot"));
+    EXPECT_EQ("", Regex::requiredLiteral("\\Qa.b\\E"));
+    EXPECT_EQ("", Regex::requiredLiteral("\\d+\\s*"));
+}
+
+TEST (RegexTest, Capture) {
+    Regex regex;
+    ASSERT_TRUE(regex.init("uid=(\\d+)|anonymous"));
+
+    const char *begin = NULL;
+    size_t length = 0;
+    string line = "GET / uid=1024 200";
+    ASSERT_TRUE(regex.capture(line.data(), line.length(), &begin, &length));
+    EXPECT_EQ("1024", string(begin, length));
+
+    /* the group is unset, the whole match is returned */
+    line = "GET / anonymous 200";
+    ASSERT_TRUE(regex.capture(line.data(), line.length(), &begin, &length));
+    EXPECT_EQ("anonymous", string(begin, length));
+
+    line = "GET / 200";
+    EXPECT_FALSE(regex.capture(line.data(), line.length(), &begin, &length));
+}
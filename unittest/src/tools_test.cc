@@ -75,3 +75,15 @@ TEST_F (ToolsTest, Rtrim) {
     rtrim(str_raw);
     EXPECT_STREQ(str_rtrimed, str_raw);
 }
+
+TEST_F (ToolsTest, HexStr2Bytes) {
+    string bytes;
+    EXPECT_TRUE(hexstr2bytes("0d0A", bytes));
+    EXPECT_EQ("\r\n", bytes);
+
+    EXPECT_TRUE(hexstr2bytes("00ff", bytes));
+    EXPECT_EQ(string("\0\xff", 2), bytes);
+
+    EXPECT_FALSE(hexstr2bytes("0d0", bytes));
+    EXPECT_FALSE(hexstr2bytes("0g", bytes));
+}